@@ -2404,7 +2404,8 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
   new_client->mpd_base_uri = g_strdup (demux->manifest_base_uri);
   gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
 
-  if (gst_mpd_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
+  if (gst_mpd_parse_update (new_client, dashdemux->client,
+          (gchar *) mapinfo.data, mapinfo.size)) {
     const gchar *period_id;
     guint period_idx;
     GList *iter;
@@ -2414,7 +2415,8 @@ gst_dash_demux_update_manifest_data (GstAdaptiveDemux * demux,
     /* prepare the new manifest and try to transfer the stream position
      * status from the old manifest client  */
 
-    GST_DEBUG_OBJECT (demux, "Updating manifest");
+    GST_DEBUG_OBJECT (demux, "Updating manifest, %u nodes reused, %u parsed",
+        new_client->reused_nodes, new_client->parsed_nodes);
 
     period_id = gst_mpd_client_get_period_id (dashdemux->client);
     period_idx = gst_mpd_client_get_period_index (dashdemux->client);
@@ -98,9 +98,10 @@ static void gst_mpdparser_parse_url_type_node (GstURLType ** pointer,
     xmlNode * a_node);
 static void gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType **
     pointer, xmlNode * a_node, GstSegmentBaseType * parent);
-static void gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node);
+static void gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node,
+    gboolean merge_runs, guint64 * end);
 static void gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode **
-    pointer, xmlNode * a_node);
+    pointer, xmlNode * a_node, gboolean merge_runs);
 static gboolean
 gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
     xmlNode * a_node, GstMultSegmentBaseType * parent);
@@ -113,20 +114,21 @@ static gboolean gst_mpdparser_parse_representation_node (GList ** list,
     xmlNode * a_node, GstAdaptationSetNode * parent,
     GstPeriodNode * period_node);
 static gboolean gst_mpdparser_parse_adaptation_set_node (GList ** list,
-    xmlNode * a_node, GstPeriodNode * parent);
+    xmlNode * a_node, GstPeriodNode * parent, GstMpdClient * client,
+    GstAdaptationSetNode * previous);
 static void gst_mpdparser_parse_subset_node (GList ** list, xmlNode * a_node);
 static gboolean
 gst_mpdparser_parse_segment_template_node (GstSegmentTemplateNode ** pointer,
     xmlNode * a_node, GstSegmentTemplateNode * parent);
 static gboolean gst_mpdparser_parse_period_node (GList ** list,
-    xmlNode * a_node);
+    xmlNode * a_node, GstMpdClient * client, GstPeriodNode * previous);
 static void gst_mpdparser_parse_program_info_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_range_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
 static gboolean gst_mpdparser_parse_root_node (GstMPDNode ** pointer,
-    xmlNode * a_node);
+    xmlNode * a_node, GstMpdClient * client, GstMPDNode * previous);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
     xmlNode * a_node);
 
@@ -134,9 +136,8 @@ static void gst_mpdparser_parse_utctiming_node (GList ** list,
 static guint convert_to_millisecs (guint decimals, gint pos);
 static int strncmp_ext (const char *s1, const char *s2);
 static GstStreamPeriod *gst_mpdparser_get_stream_period (GstMpdClient * client);
-static GstSNode *gst_mpdparser_clone_s_node (GstSNode * pointer);
 static GstSegmentTimelineNode
-    * gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer);
+    * gst_mpdparser_segment_timeline_node_ref (GstSegmentTimelineNode * pointer);
 static GstRange *gst_mpdparser_clone_range (GstRange * range);
 static GstURLType *gst_mpdparser_clone_URL (GstURLType * url);
 static gchar *gst_mpdparser_parse_baseURL (GstMpdClient * client,
@@ -1546,68 +1547,65 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
   }
 }
 
-static GstSNode *
-gst_mpdparser_clone_s_node (GstSNode * pointer)
+/* @end is the end of the timeline so far, in timescale units */
+static void
+gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node,
+    gboolean merge_runs, guint64 * end)
 {
-  GstSNode *clone = NULL;
+  GstSNode *new_s_node, *prev;
+  gboolean has_t;
+  guint64 t, d;
+  gint r;
 
-  if (pointer) {
-    clone = g_slice_new0 (GstSNode);
-    clone->t = pointer->t;
-    clone->d = pointer->d;
-    clone->r = pointer->r;
+  GST_LOG ("attributes of S node:");
+  has_t = gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "t", 0, &t);
+  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0, &d);
+  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &r);
+
+  /* With a SegmentTemplate, back to back S nodes with the same duration
+   * describe the same segments as a single one with a larger repeat count,
+   * so store them that way. The segments of a run are only computed from the
+   * repeat count when needed, which keeps long live timelines small. In a
+   * SegmentList each S node has its own SegmentURL, so keep them apart */
+  prev = merge_runs ? g_queue_peek_tail (queue) : NULL;
+  if (prev && prev->r >= 0 && r >= 0 && d > 0 && prev->d == d
+      && prev->r < G_MAXINT - r - 1 && (!has_t || t == *end)) {
+    prev->r += r + 1;
+    *end += d * (r + 1);
+    return;
   }
 
-  return clone;
-}
-
-static void
-gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
-{
-  GstSNode *new_s_node;
-
   new_s_node = g_slice_new0 (GstSNode);
+  new_s_node->t = t;
+  new_s_node->d = d;
+  new_s_node->r = r;
   g_queue_push_tail (queue, new_s_node);
 
-  GST_LOG ("attributes of S node:");
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "t", 0,
-      &new_s_node->t);
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0,
-      &new_s_node->d);
-  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &new_s_node->r);
+  if (has_t)
+    *end = t;
+  if (r >= 0)
+    *end += d * (r + 1);
 }
 
+/* The S nodes are never modified after parsing, so a SegmentTimeline
+ * inherited from a parent SegmentTemplate or SegmentList is shared instead
+ * of copied into every Representation */
 static GstSegmentTimelineNode *
-gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer)
-{
-  GstSegmentTimelineNode *clone = NULL;
-
-  if (pointer) {
-    clone = gst_mpdparser_segment_timeline_node_new ();
-    if (clone) {
-      GList *list;
-      for (list = g_queue_peek_head_link (&pointer->S); list;
-          list = g_list_next (list)) {
-        GstSNode *s_node;
-        s_node = (GstSNode *) list->data;
-        if (s_node) {
-          g_queue_push_tail (&clone->S, gst_mpdparser_clone_s_node (s_node));
-        }
-      }
-    } else {
-      GST_WARNING ("Allocation of SegmentTimeline node failed!");
-    }
-  }
+gst_mpdparser_segment_timeline_node_ref (GstSegmentTimelineNode * pointer)
+{
+  if (pointer)
+    g_atomic_int_inc (&pointer->ref_count);
 
-  return clone;
+  return pointer;
 }
 
 static void
 gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode ** pointer,
-    xmlNode * a_node)
+    xmlNode * a_node, gboolean merge_runs)
 {
   xmlNode *cur_node;
   GstSegmentTimelineNode *new_seg_timeline;
+  guint64 end = 0;
 
   gst_mpdparser_free_segment_timeline_node (*pointer);
   *pointer = new_seg_timeline = gst_mpdparser_segment_timeline_node_new ();
@@ -1620,7 +1618,8 @@ gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode ** pointer,
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "S") == 0) {
-        gst_mpdparser_parse_s_node (&new_seg_timeline->S, cur_node);
+        gst_mpdparser_parse_s_node (&new_seg_timeline->S, cur_node,
+            merge_runs, &end);
       }
     }
   }
@@ -1646,7 +1645,7 @@ gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
     mult_seg_base_type->duration = parent->duration;
     mult_seg_base_type->startNumber = parent->startNumber;
     mult_seg_base_type->SegmentTimeline =
-        gst_mpdparser_clone_segment_timeline (parent->SegmentTimeline);
+        gst_mpdparser_segment_timeline_node_ref (parent->SegmentTimeline);
     mult_seg_base_type->BitstreamSwitching =
         gst_mpdparser_clone_URL (parent->BitstreamSwitching);
   }
@@ -1676,7 +1675,8 @@ gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
       if (xmlStrcmp (cur_node->name, (xmlChar *) "SegmentTimeline") == 0) {
         /* parse frees the segmenttimeline if any */
         gst_mpdparser_parse_segment_timeline_node
-            (&mult_seg_base_type->SegmentTimeline, cur_node);
+            (&mult_seg_base_type->SegmentTimeline, cur_node,
+            xmlStrcmp (a_node->name, (xmlChar *) "SegmentTemplate") == 0);
       } else if (xmlStrcmp (cur_node->name,
               (xmlChar *) "BitstreamSwitching") == 0) {
         /* parse frees the old url before setting the new one */
@@ -1876,6 +1876,108 @@ gst_mpdparser_parse_representation_base_type (GstRepresentationBaseType **
   }
 }
 
+#define FNV_OFFSET_BASIS G_GUINT64_CONSTANT (14695981039346656037)
+#define FNV_PRIME G_GUINT64_CONSTANT (1099511628211)
+
+static guint64
+gst_mpdparser_hash_string (guint64 hash, const xmlChar * str)
+{
+  if (str) {
+    for (; *str; str++)
+      hash = (hash ^ *str) * FNV_PRIME;
+  }
+
+  /* terminate, so that "ab" "c" and "a" "bc" differ */
+  return (hash ^ 0xff) * FNV_PRIME;
+}
+
+static guint64
+gst_mpdparser_hash_xml_node_internal (guint64 hash, xmlNode * a_node,
+    const gchar * skip)
+{
+  xmlAttr *attr;
+  xmlNode *cur_node;
+
+  hash = gst_mpdparser_hash_string (hash, a_node->name);
+  if (a_node->ns)
+    hash = gst_mpdparser_hash_string (hash, a_node->ns->href);
+
+  for (attr = a_node->properties; attr; attr = attr->next) {
+    hash = gst_mpdparser_hash_string (hash, attr->name);
+    if (attr->ns)
+      hash = gst_mpdparser_hash_string (hash, attr->ns->href);
+    for (cur_node = attr->children; cur_node; cur_node = cur_node->next)
+      hash = gst_mpdparser_hash_string (hash, cur_node->content ?
+          cur_node->content : cur_node->name);
+  }
+
+  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
+    if (cur_node->type == XML_ELEMENT_NODE) {
+      if (skip && xmlStrcmp (cur_node->name, (xmlChar *) skip) == 0)
+        continue;
+      hash = gst_mpdparser_hash_xml_node_internal (hash, cur_node, NULL);
+    } else {
+      hash = (hash ^ cur_node->type) * FNV_PRIME;
+      hash = gst_mpdparser_hash_string (hash, cur_node->content ?
+          cur_node->content : cur_node->name);
+    }
+  }
+
+  /* and close the element */
+  return (hash ^ 0xfe) * FNV_PRIME;
+}
+
+/* Hash of the XML element @a_node and its content, leaving out the children
+ * elements named @skip. Two elements with the same hash parse to the same
+ * node, as long as what they inherit from their parents is the same too. */
+static guint64
+gst_mpdparser_hash_xml_node (xmlNode * a_node, const gchar * skip)
+{
+  return gst_mpdparser_hash_xml_node_internal (FNV_OFFSET_BASIS, a_node, skip);
+}
+
+/* Looks in @previous for a node whose guint64 at @offset is @fingerprint.
+ * Nodes usually keep their position between manifest updates, so the one at
+ * @index is tried first */
+static gpointer
+gst_mpdparser_find_previous_node (GList * previous, guint index,
+    gsize offset, guint64 fingerprint)
+{
+  GList *l;
+
+  l = g_list_nth (previous, index);
+  if (l && G_STRUCT_MEMBER (guint64, l->data, offset) == fingerprint)
+    return l->data;
+
+  for (l = previous; l; l = l->next) {
+    if (G_STRUCT_MEMBER (guint64, l->data, offset) == fingerprint)
+      return l->data;
+  }
+
+  return NULL;
+}
+
+static GstRepresentationNode *
+gst_mpdparser_representation_node_ref (GstRepresentationNode * node)
+{
+  g_atomic_int_inc (&node->ref_count);
+  return node;
+}
+
+static GstAdaptationSetNode *
+gst_mpdparser_adaptation_set_node_ref (GstAdaptationSetNode * node)
+{
+  g_atomic_int_inc (&node->ref_count);
+  return node;
+}
+
+static GstPeriodNode *
+gst_mpdparser_period_node_ref (GstPeriodNode * node)
+{
+  g_atomic_int_inc (&node->ref_count);
+  return node;
+}
+
 static gboolean
 gst_mpdparser_parse_representation_node (GList ** list, xmlNode * a_node,
     GstAdaptationSetNode * parent, GstPeriodNode * period_node)
@@ -1884,6 +1986,8 @@ gst_mpdparser_parse_representation_node (GList ** list, xmlNode * a_node,
   GstRepresentationNode *new_representation;
 
   new_representation = g_slice_new0 (GstRepresentationNode);
+  new_representation->ref_count = 1;
+  new_representation->fingerprint = gst_mpdparser_hash_xml_node (a_node, NULL);
 
   GST_LOG ("attributes of Representation node:");
   if (!gst_mpdparser_get_xml_prop_string_no_whitespace (a_node, "id",
@@ -1949,13 +2053,25 @@ error:
 
 static gboolean
 gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
-    GstPeriodNode * parent)
+    GstPeriodNode * parent, GstMpdClient * client,
+    GstAdaptationSetNode * previous)
 {
   xmlNode *cur_node;
   GstAdaptationSetNode *new_adap_set;
   gchar *actuate;
+  guint index = 0;
 
   new_adap_set = g_slice_new0 (GstAdaptationSetNode);
+  new_adap_set->ref_count = 1;
+  new_adap_set->fingerprint = gst_mpdparser_hash_xml_node (a_node, NULL);
+  new_adap_set->inherit_fingerprint =
+      gst_mpdparser_hash_xml_node (a_node, "Representation");
+
+  /* Representations of the previous manifest can only be taken over if they
+   * inherit the same values */
+  if (previous && previous->inherit_fingerprint !=
+      new_adap_set->inherit_fingerprint)
+    previous = NULL;
 
   GST_LOG ("attributes of AdaptationSet node:");
 
@@ -2054,9 +2170,29 @@ gst_mpdparser_parse_adaptation_set_node (GList ** list, xmlNode * a_node,
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "Representation") == 0) {
+        GstRepresentationNode *representation = NULL;
+
+        if (previous) {
+          representation =
+              gst_mpdparser_find_previous_node (previous->Representations,
+              index, G_STRUCT_OFFSET (GstRepresentationNode, fingerprint),
+              gst_mpdparser_hash_xml_node (cur_node, NULL));
+        }
+        index++;
+
+        if (representation) {
+          new_adap_set->Representations =
+              g_list_append (new_adap_set->Representations,
+              gst_mpdparser_representation_node_ref (representation));
+          client->reused_nodes++;
+          continue;
+        }
+
         if (!gst_mpdparser_parse_representation_node
             (&new_adap_set->Representations, cur_node, new_adap_set, parent))
           goto error;
+        if (client)
+          client->parsed_nodes++;
       }
     }
   }
@@ -2135,13 +2271,25 @@ error:
 }
 
 static gboolean
-gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
+gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node,
+    GstMpdClient * client, GstPeriodNode * previous)
 {
   xmlNode *cur_node;
   GstPeriodNode *new_period;
   gchar *actuate;
+  guint index = 0;
 
   new_period = g_slice_new0 (GstPeriodNode);
+  new_period->ref_count = 1;
+  new_period->fingerprint = gst_mpdparser_hash_xml_node (a_node, NULL);
+  new_period->inherit_fingerprint =
+      gst_mpdparser_hash_xml_node (a_node, "AdaptationSet");
+
+  /* AdaptationSets of the previous manifest can only be taken over if they
+   * inherit the same values */
+  if (previous && previous->inherit_fingerprint !=
+      new_period->inherit_fingerprint)
+    previous = NULL;
 
   GST_LOG ("attributes of Period node:");
 
@@ -2192,9 +2340,38 @@ gst_mpdparser_parse_period_node (GList ** list, xmlNode * a_node)
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "AdaptationSet") == 0) {
+        GstAdaptationSetNode *adapt_set = NULL, *parent_set = NULL;
+
+        if (previous) {
+          adapt_set =
+              gst_mpdparser_find_previous_node (previous->AdaptationSets,
+              index, G_STRUCT_OFFSET (GstAdaptationSetNode, fingerprint),
+              gst_mpdparser_hash_xml_node (cur_node, NULL));
+          if (!adapt_set) {
+            parent_set =
+                gst_mpdparser_find_previous_node (previous->AdaptationSets,
+                index, G_STRUCT_OFFSET (GstAdaptationSetNode,
+                    inherit_fingerprint),
+                gst_mpdparser_hash_xml_node (cur_node, "Representation"));
+          }
+        }
+        index++;
+
+        if (adapt_set) {
+          new_period->AdaptationSets =
+              g_list_append (new_period->AdaptationSets,
+              gst_mpdparser_adaptation_set_node_ref (adapt_set));
+          client->reused_nodes +=
+              1 + g_list_length (adapt_set->Representations);
+          continue;
+        }
+
         if (!gst_mpdparser_parse_adaptation_set_node
-            (&new_period->AdaptationSets, cur_node, new_period))
+            (&new_period->AdaptationSets, cur_node, new_period, client,
+                parent_set))
           goto error;
+        if (client)
+          client->parsed_nodes++;
       }
     }
   }
@@ -2329,10 +2506,12 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
 }
 
 static gboolean
-gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
+gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node,
+    GstMpdClient * client, GstMPDNode * previous)
 {
   xmlNode *cur_node;
   GstMPDNode *new_mpd;
+  guint index = 0;
 
   gst_mpdparser_free_mpd_node (*pointer);
   *pointer = NULL;
@@ -2373,8 +2552,41 @@ gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
       if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node))
+        GstPeriodNode *period = NULL, *parent_period = NULL;
+
+        if (previous) {
+          period = gst_mpdparser_find_previous_node (previous->Periods, index,
+              G_STRUCT_OFFSET (GstPeriodNode, fingerprint),
+              gst_mpdparser_hash_xml_node (cur_node, NULL));
+          if (!period) {
+            parent_period =
+                gst_mpdparser_find_previous_node (previous->Periods, index,
+                G_STRUCT_OFFSET (GstPeriodNode, inherit_fingerprint),
+                gst_mpdparser_hash_xml_node (cur_node, "AdaptationSet"));
+          }
+        }
+        index++;
+
+        if (period) {
+          GList *l;
+
+          new_mpd->Periods = g_list_append (new_mpd->Periods,
+              gst_mpdparser_period_node_ref (period));
+          client->reused_nodes++;
+          for (l = period->AdaptationSets; l; l = l->next) {
+            GstAdaptationSetNode *adapt_set = l->data;
+
+            client->reused_nodes +=
+                1 + g_list_length (adapt_set->Representations);
+          }
+          continue;
+        }
+
+        if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node,
+                client, parent_period))
           goto error;
+        if (client)
+          client->parsed_nodes++;
       } else if (xmlStrcmp (cur_node->name,
               (xmlChar *) "ProgramInformation") == 0) {
         gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, cur_node);
@@ -2828,7 +3040,7 @@ gst_mpdparser_free_metrics_range_node (GstMetricsRangeNode * metrics_range_node)
 static void
 gst_mpdparser_free_period_node (GstPeriodNode * period_node)
 {
-  if (period_node) {
+  if (period_node && g_atomic_int_dec_and_test (&period_node->ref_count)) {
     if (period_node->id)
       xmlFree (period_node->id);
     gst_mpdparser_free_seg_base_type_ext (period_node->SegmentBase);
@@ -2911,7 +3123,8 @@ static void
 gst_mpdparser_free_adaptation_set_node (GstAdaptationSetNode *
     adaptation_set_node)
 {
-  if (adaptation_set_node) {
+  if (adaptation_set_node
+      && g_atomic_int_dec_and_test (&adaptation_set_node->ref_count)) {
     if (adaptation_set_node->lang)
       xmlFree (adaptation_set_node->lang);
     if (adaptation_set_node->contentType)
@@ -2951,7 +3164,8 @@ static void
 gst_mpdparser_free_representation_node (GstRepresentationNode *
     representation_node)
 {
-  if (representation_node) {
+  if (representation_node
+      && g_atomic_int_dec_and_test (&representation_node->ref_count)) {
     if (representation_node->id)
       xmlFree (representation_node->id);
     g_strfreev (representation_node->dependencyId);
@@ -2998,6 +3212,7 @@ gst_mpdparser_segment_timeline_node_new (void)
   GstSegmentTimelineNode *node = g_slice_new0 (GstSegmentTimelineNode);
 
   g_queue_init (&node->S);
+  node->ref_count = 1;
 
   return node;
 }
@@ -3005,7 +3220,7 @@ gst_mpdparser_segment_timeline_node_new (void)
 static void
 gst_mpdparser_free_segment_timeline_node (GstSegmentTimelineNode * seg_timeline)
 {
-  if (seg_timeline) {
+  if (seg_timeline && g_atomic_int_dec_and_test (&seg_timeline->ref_count)) {
     g_queue_foreach (&seg_timeline->S, (GFunc) gst_mpdparser_free_s_node, NULL);
     g_queue_clear (&seg_timeline->S);
     g_slice_free (GstSegmentTimelineNode, seg_timeline);
@@ -3820,8 +4035,9 @@ gst_mpd_client_fetch_on_load_external_resources (GstMpdClient * client)
   }
 }
 
-gboolean
-gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
+static gboolean
+gst_mpd_parse_internal (GstMpdClient * client, GstMpdClient * previous,
+    const gchar * data, gint size)
 {
   gboolean ret = FALSE;
 
@@ -3840,7 +4056,10 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
     LIBXML_TEST_VERSION;
 
     /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
+    /* XML_PARSE_COMPACT stores short text nodes inside the node itself, which
+     * saves an allocation for most attribute values of a manifest */
+    doc = xmlReadMemory (data, size, "noname.xml", NULL,
+        XML_PARSE_NONET | XML_PARSE_COMPACT);
     if (doc == NULL) {
       GST_ERROR ("failed to parse the MPD file");
       ret = FALSE;
@@ -3855,7 +4074,8 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
         ret = FALSE;            /* used to return TRUE before, but this seems wrong */
       } else {
         /* now we can parse the MPD root node and all children nodes, recursively */
-        ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
+        ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element,
+            client, previous ? previous->mpd_node : NULL);
       }
       /* free the document */
       xmlFreeDoc (doc);
@@ -3870,6 +4090,31 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
   return ret;
 }
 
+gboolean
+gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
+{
+  return gst_mpd_parse_internal (client, NULL, data, size);
+}
+
+/* Like gst_mpd_parse(), but takes over the Period, AdaptationSet and
+ * Representation nodes of @previous that did not change in the new manifest
+ * instead of parsing them again */
+gboolean
+gst_mpd_parse_update (GstMpdClient * client, GstMpdClient * previous,
+    const gchar * data, gint size)
+{
+  gboolean ret;
+
+  client->reused_nodes = client->parsed_nodes = 0;
+
+  ret = gst_mpd_parse_internal (client, previous, data, size);
+
+  GST_DEBUG ("reused %u and parsed %u nodes of the updated MPD",
+      client->reused_nodes, client->parsed_nodes);
+
+  return ret;
+}
+
 const gchar *
 gst_mpdparser_get_baseURL (GstMpdClient * client, guint indexStream)
 {
@@ -4170,7 +4415,10 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
         GstMediaSegment *media_segment =
             g_ptr_array_index (stream->segments, n);
         if (media_segment) {
-          if (media_segment->start + media_segment->duration >
+          guint repeat = MAX (media_segment->repeat, 0);
+
+          /* a run of segments ends after all its repetitions */
+          if (media_segment->start + media_segment->duration * (repeat + 1) >
               PeriodEnd - PeriodStart) {
             GstClockTime stop = PeriodEnd - PeriodStart;
             if (n < stream->segments->len - 1) {
@@ -4179,6 +4427,33 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
               if (next_segment && next_segment->start < PeriodEnd - PeriodStart)
                 stop = next_segment->start;
             }
+
+            /* Keep the repetitions that end before @stop, and clip the one
+             * crossing it as a segment of its own */
+            if (repeat > 0 && media_segment->duration > 0
+                && media_segment->start + media_segment->duration <= stop) {
+              guint n_full = MIN ((stop - media_segment->start) /
+                  media_segment->duration, repeat + 1);
+              GstClockTime end = media_segment->start +
+                  media_segment->duration * n_full;
+
+              media_segment->repeat = n_full - 1;
+              GST_LOG ("Fixed repeat of segment %u: %d", n,
+                  media_segment->repeat);
+              if (end < stop) {
+                GstMediaSegment *last = g_slice_dup (GstMediaSegment,
+                    media_segment);
+
+                last->number += n_full;
+                last->repeat = 0;
+                last->scale_start += last->scale_duration * n_full;
+                last->start = end;
+                g_ptr_array_insert (stream->segments, n + 1, last);
+              }
+              continue;
+            }
+
+            media_segment->repeat = MIN (media_segment->repeat, 0);
             media_segment->duration =
                 media_segment->start > stop ? 0 : stop - media_segment->start;
             GST_LOG ("Fixed duration of segment %u: %" GST_TIME_FORMAT, n,
@@ -4316,7 +4591,7 @@ gst_mpd_client_fetch_external_period (GstMpdClient * client,
     for (iter = root_element->children; iter; iter = iter->next) {
       if (iter->type == XML_ELEMENT_NODE) {
         if (xmlStrcmp (iter->name, (xmlChar *) "Period") == 0) {
-          gst_mpdparser_parse_period_node (&new_periods, iter);
+          gst_mpdparser_parse_period_node (&new_periods, iter, NULL, NULL);
         } else {
           goto error;
         }
@@ -4661,7 +4936,7 @@ gst_mpd_client_fetch_external_adaptation_set (GstMpdClient * client,
     }
 
     gst_mpdparser_parse_adaptation_set_node (&new_adapt_sets, root_element,
-        period);
+        period, NULL, NULL);
   } else {
     goto error;
   }
@@ -4853,7 +5128,7 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
           repeat_index--;
 
         if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
-          if (repeat_index + 1 < segment->repeat) {
+          if (repeat_index < segment->repeat) {
             if (ts - chunk_time > chunk_time + segment->duration - ts)
               repeat_index++;
           } else if (index + 1 < stream->segments->len) {
@@ -4870,7 +5145,7 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
                 (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
             ts != chunk_time) {
 
-          if (repeat_index + 1 < segment->repeat) {
+          if (repeat_index < segment->repeat) {
             repeat_index++;
           } else {
             repeat_index = 0;
@@ -155,6 +155,8 @@ struct _GstSegmentTimelineNode
 {
   /* list of S nodes */
   GQueue S;
+  /* shared by the segment bases that inherit it */
+  gint ref_count;
 };
 
 struct _GstURLType
@@ -272,6 +274,9 @@ struct _GstRepresentationNode
   GstSegmentTemplateNode *SegmentTemplate;
   /* SegmentList node */
   GstSegmentListNode *SegmentList;
+
+  guint64 fingerprint;
+  gint ref_count;
 };
 
 struct _GstDescriptorType
@@ -338,6 +343,10 @@ struct _GstAdaptationSetNode
 
   gchar *xlink_href;
   GstXLinkActuate actuate;
+
+  guint64 fingerprint;
+  guint64 inherit_fingerprint;
+  gint ref_count;
 };
 
 struct _GstSubsetNode
@@ -367,6 +376,13 @@ struct _GstPeriodNode
 
   gchar *xlink_href;
   GstXLinkActuate actuate;
+
+  /* hash of the XML element, and of the XML element without its
+   * AdaptationSet children. Nodes whose hashes did not change are shared
+   * between the manifests of consecutive updates */
+  guint64 fingerprint;
+  guint64 inherit_fingerprint;
+  gint ref_count;
 };
 
 struct _GstProgramInformationNode
@@ -520,6 +536,11 @@ struct _GstMpdClient
   gboolean profile_isoff_ondemand;
 
   GstUriDownloader * downloader;
+
+  /* Period, AdaptationSet and Representation nodes taken over from the
+   * previous manifest, or parsed, on the last update */
+  guint reused_nodes;
+  guint parsed_nodes;
 };
 
 /* Basic initialization/deinitialization functions */
@@ -532,6 +553,7 @@ void gst_mpd_client_set_uri_downloader (GstMpdClient * client, GstUriDownloader
 
 /* MPD file parsing */
 gboolean gst_mpd_parse (GstMpdClient *client, const gchar *data, gint size);
+gboolean gst_mpd_parse_update (GstMpdClient *client, GstMpdClient *previous, const gchar *data, gint size);
 
 /* Streaming management */
 gboolean gst_mpd_client_setup_media_presentation (GstMpdClient *client, GstClockTime time, gint period_index, const gchar *period_id);
@@ -107,6 +107,8 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint n, gchar ** uri, gint64 * range_start, gint64 * range_end);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
@@ -174,6 +176,8 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment =
+      gst_hls_demux_stream_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
@@ -417,8 +421,24 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   snap_after = ! !(flags & GST_SEEK_FLAG_SNAP_AFTER);
 
   GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  walk = hls_stream->playlist->files;
+
+  /* Start looking right before the fragment containing ts, the target can
+   * only be before that one when snapping backwards */
+  if ((forward || !snap_after) && ts > current_pos) {
+    GstClockTime file_start;
+    GList *l;
+
+    l = gst_m3u8_find_file_at_time (hls_stream->playlist, ts - current_pos,
+        &file_start);
+    if (l && l->prev) {
+      walk = l->prev;
+      current_pos += file_start - GST_M3U8_MEDIA_FILE (walk->data)->duration;
+    }
+  }
+
   /* FIXME: Here we need proper discont handling */
-  for (walk = hls_stream->playlist->files; walk; walk = walk->next) {
+  for (; walk; walk = walk->next) {
     file = walk->data;
 
     current_sequence = file->sequence;
@@ -1124,6 +1144,31 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream, guint n,
+    gchar ** uri, gint64 * range_start, gint64 * range_end)
+{
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (GST_HLS_DEMUX_STREAM_CAST (stream));
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0, n);
+  if (file == NULL)
+    return FALSE;
+
+  *uri = g_strdup (file->uri);
+  *range_start = file->offset;
+  if (file->size != -1)
+    *range_end = file->offset + file->size - 1;
+  else
+    *range_end = -1;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1536,20 +1581,18 @@ retry:
     GST_LOG_OBJECT (demux, "Looking for sequence position %"
         GST_TIME_FORMAT " in updated playlist", GST_TIME_ARGS (target_pos));
 
-    current_pos = 0;
-    for (walk = m3u8->files; walk; walk = walk->next) {
-      GstM3U8MediaFile *file = walk->data;
-
-      sequence = file->sequence;
-      if (current_pos <= target_pos
-          && target_pos < current_pos + file->duration) {
-        break;
-      }
-      current_pos += file->duration;
+    walk = gst_m3u8_find_file_at_time (m3u8, target_pos, &current_pos);
+    if (walk) {
+      sequence = GST_M3U8_MEDIA_FILE (walk->data)->sequence;
+    } else if (m3u8->files) {
+      /* End of playlist */
+      sequence =
+          GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence + 1;
+      current_pos = gst_m3u8_get_duration (m3u8);
+    } else {
+      sequence = 0;
+      current_pos = 0;
     }
-    /* End of playlist */
-    if (!walk)
-      sequence++;
     m3u8->sequence = sequence;
     m3u8->sequence_position = current_pos;
     GST_M3U8_CLIENT_UNLOCK (demux->client);
@@ -35,6 +35,20 @@ static GstM3U8MediaFile *gst_m3u8_media_file_new (gchar * uri,
     gchar * title, GstClockTime duration, guint sequence);
 static gchar *uri_join (const gchar * uri, const gchar * path);
 
+/* Random access into GstM3U8::files. @start is the sum of the durations of
+ * all files before this one since the index was last rebuilt, so it stays
+ * valid when files are dropped from the front of a live playlist. */
+typedef struct
+{
+  GList *link;
+  GstClockTime start;
+} GstM3U8FileIndex;
+
+#define M3U8_INDEX(m3u8, i) \
+    (&g_array_index ((m3u8)->index, GstM3U8FileIndex, (i)))
+#define M3U8_INDEX_FILE(m3u8, i) \
+    GST_M3U8_MEDIA_FILE (M3U8_INDEX (m3u8, i)->link->data)
+
 GstM3U8 *
 gst_m3u8_new (void)
 {
@@ -48,6 +62,7 @@ gst_m3u8_new (void)
   m3u8->sequence_position = 0;
   m3u8->highest_sequence_number = -1;
   m3u8->duration = GST_CLOCK_TIME_NONE;
+  m3u8->index = g_array_new (FALSE, FALSE, sizeof (GstM3U8FileIndex));
 
   g_mutex_init (&m3u8->lock);
   m3u8->ref_count = 1;
@@ -106,6 +121,7 @@ gst_m3u8_unref (GstM3U8 * self)
 
     g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_unref, NULL);
     g_list_free (self->files);
+    g_array_free (self->index, TRUE);
 
     g_free (self->last_data);
     g_mutex_clear (&self->lock);
@@ -441,6 +457,120 @@ generate_media_seqnums (GstM3U8 * self, GList * previous_files)
   }
 }
 
+/* call with M3U8_LOCK held */
+static void
+m3u8_index_append (GstM3U8 * self, GList * link)
+{
+  GstM3U8FileIndex entry;
+
+  entry.link = link;
+  entry.start = 0;
+  if (self->index->len > 0) {
+    GstM3U8FileIndex *last = M3U8_INDEX (self, self->index->len - 1);
+
+    entry.start =
+        last->start + GST_M3U8_MEDIA_FILE (last->link->data)->duration;
+  }
+  g_array_append_val (self->index, entry);
+}
+
+/* call with M3U8_LOCK held */
+static void
+m3u8_index_rebuild (GstM3U8 * self)
+{
+  GList *l;
+
+  g_array_set_size (self->index, 0);
+  for (l = self->files; l; l = l->next)
+    m3u8_index_append (self, l);
+}
+
+/* call with M3U8_LOCK held. Returns the start of the @i-th file relative to
+ * the start of the first one, or the playlist duration if @i is the number
+ * of files */
+static GstClockTime
+m3u8_index_position (GstM3U8 * self, guint i)
+{
+  GstM3U8FileIndex *first = M3U8_INDEX (self, 0);
+  GstM3U8FileIndex *last;
+
+  if (i < self->index->len)
+    return M3U8_INDEX (self, i)->start - first->start;
+
+  last = M3U8_INDEX (self, self->index->len - 1);
+  return last->start + GST_M3U8_MEDIA_FILE (last->link->data)->duration -
+      first->start;
+}
+
+/* call with M3U8_LOCK held. Returns the position of the first file with a
+ * sequence number >= @sequence, or the number of files if there is none */
+static guint
+m3u8_index_lower_bound (GstM3U8 * self, gint64 sequence)
+{
+  guint lo = 0, hi = self->index->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (M3U8_INDEX_FILE (self, mid)->sequence < sequence)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/* call with M3U8_LOCK held */
+static GList *
+m3u8_find_file_by_sequence (GstM3U8 * self, gint64 sequence)
+{
+  guint i = m3u8_index_lower_bound (self, sequence);
+
+  if (i < self->index->len && M3U8_INDEX_FILE (self, i)->sequence == sequence)
+    return M3U8_INDEX (self, i)->link;
+
+  return NULL;
+}
+
+/* call with M3U8_LOCK held. If there are no holes in the sequence numbers,
+ * a sequence number maps directly to the position of its file */
+static gboolean
+m3u8_index_is_contiguous (GstM3U8 * self)
+{
+  guint len = self->index->len;
+
+  return len > 0 && M3U8_INDEX_FILE (self, len - 1)->sequence -
+      M3U8_INDEX_FILE (self, 0)->sequence + 1 == len;
+}
+
+/* call with M3U8_LOCK held */
+static gboolean
+m3u8_file_has_uri (GstM3U8 * self, GstM3U8MediaFile * file, const gchar * uri)
+{
+  gsize len = strlen (file->uri), uri_len = strlen (uri);
+  gchar *joined;
+  gboolean ret;
+
+  /* Relative URIs resolve to the same file as long as the base stays the
+   * same, which is the common case and spares the uri_join() */
+  if (len >= uri_len && strcmp (file->uri + len - uri_len, uri) == 0
+      && (len == uri_len || file->uri[len - uri_len - 1] == '/'))
+    return TRUE;
+
+  joined = uri_join (self->base_uri ? self->base_uri : self->uri, uri);
+  ret = g_strcmp0 (joined, file->uri) == 0;
+  g_free (joined);
+
+  return ret;
+}
+
+static void
+m3u8_files_free (GList * files)
+{
+  g_list_free_full (files, (GDestroyNotify) gst_m3u8_media_file_unref);
+}
+
 /*
  * @data: a m3u8 playlist text data, taking ownership
  */
@@ -458,6 +588,12 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   gint64 mediasequence;
   GList *previous_files = NULL;
   gboolean have_mediasequence = FALSE;
+  GstM3U8MediaFile *last_file = NULL;
+  gint64 known_first = -1, known_last = -2;
+  gint incremental = -1;
+  GList *first_reused = NULL, *last_reused = NULL;
+  gboolean consistent = TRUE;
+  gchar *buf;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -487,8 +623,11 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 
   GST_TRACE ("data:\n%s", data);
 
+  /* parse a copy, the parser writes into it and last_data has to stay
+   * intact for the comparison above */
   g_free (self->last_data);
   self->last_data = data;
+  data = buf = g_strdup (data);
 
   self->current_file = NULL;
   previous_files = self->files;
@@ -496,6 +635,14 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   self->duration = GST_CLOCK_TIME_NONE;
   mediasequence = 0;
 
+  /* With MEDIA-SEQUENCE, files that were already in the previous playlist
+   * are taken over from it instead of being parsed again. This needs the
+   * previous sequence numbers to map directly to positions in the index */
+  if (previous_files && m3u8_index_is_contiguous (self)) {
+    known_first = M3U8_INDEX_FILE (self, 0)->sequence;
+    known_last = M3U8_INDEX_FILE (self, self->index->len - 1)->sequence;
+  }
+
   /* By default, allow caching */
   self->allowcache = TRUE;
 
@@ -514,11 +661,42 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
       *r = '\0';
 
     if (data[0] != '#' && data[0] != '\0') {
+      gboolean known;
+
       if (duration <= 0) {
         GST_LOG ("%s: got line without EXTINF, dropping", data);
         goto next_line;
       }
 
+      known = have_mediasequence && mediasequence >= known_first
+          && mediasequence <= known_last;
+      if (incremental == -1)
+        incremental = known;
+
+      if (incremental && known) {
+        GList *link = M3U8_INDEX (self, mediasequence - known_first)->link;
+        GstM3U8MediaFile *file = link->data;
+
+        if (!m3u8_file_has_uri (self, file, data)) {
+          /* Same sequence, different URI. This is bad! */
+          GST_ERROR ("Media URIs inconsistent (sequence %" G_GINT64_FORMAT
+              "): had '%s', got '%s'", file->sequence, file->uri, data);
+          consistent = FALSE;
+          break;
+        }
+
+        if (!first_reused)
+          first_reused = link;
+        last_reused = link;
+        last_file = file;
+        mediasequence++;
+
+        duration = 0;
+        discontinuity = FALSE;
+        size = offset = -1;
+        goto next_line;
+      }
+
       data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
       if (data != NULL) {
         GstM3U8MediaFile *file;
@@ -540,12 +718,10 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
           if (offset != -1) {
             file->offset = offset;
           } else {
-            GstM3U8MediaFile *prev = self->files ? self->files->data : NULL;
-
-            if (!prev) {
+            if (!last_file) {
               offset = 0;
             } else {
-              offset = prev->offset + prev->size;
+              offset = last_file->offset + last_file->size;
             }
             file->offset = offset;
           }
@@ -560,11 +736,20 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         title = NULL;
         discontinuity = FALSE;
         size = offset = -1;
+        last_file = file;
         self->files = g_list_prepend (self->files, file);
       }
 
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
       gdouble fval;
+
+      if (incremental != 0 && have_mediasequence
+          && mediasequence >= known_first && mediasequence <= known_last) {
+        duration =
+            M3U8_INDEX_FILE (self, mediasequence - known_first)->duration;
+        goto next_line;
+      }
+
       if (!double_from_string (data + 8, &data, &fval)) {
         GST_WARNING ("Can't read EXTINF duration");
         goto next_line;
@@ -687,22 +872,67 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 
   g_free (current_key);
   current_key = NULL;
+  g_free (buf);
 
   self->files = g_list_reverse (self->files);
 
-  if (previous_files) {
-    gboolean consistent = TRUE;
+  if (incremental == 1) {
+    GList *new_files = self->files, *l;
+    guint first_pos, last_pos;
 
-    if (have_mediasequence) {
-      consistent = check_media_seqnums (self, previous_files);
-    } else {
-      generate_media_seqnums (self, previous_files);
+    /* error was reported above already, keep the previous playlist */
+    if (!consistent) {
+      m3u8_files_free (new_files);
+      self->files = previous_files;
+      GST_M3U8_UNLOCK (self);
+      return FALSE;
     }
 
-    g_list_foreach (previous_files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (previous_files);
+    first_pos =
+        GST_M3U8_MEDIA_FILE (first_reused->data)->sequence - known_first;
+    last_pos = GST_M3U8_MEDIA_FILE (last_reused->data)->sequence - known_first;
+
+    /* Drop the files that are not in the playlist anymore ... */
+    if (first_reused->prev) {
+      first_reused->prev->next = NULL;
+      first_reused->prev = NULL;
+      m3u8_files_free (previous_files);
+    }
+    if (last_reused->next) {
+      last_reused->next->prev = NULL;
+      m3u8_files_free (last_reused->next);
+      last_reused->next = NULL;
+    }
+    g_array_set_size (self->index, last_pos + 1);
+    g_array_remove_range (self->index, 0, first_pos);
+
+    /* ... and append the new ones */
+    if (new_files) {
+      last_reused->next = new_files;
+      new_files->prev = last_reused;
+    }
+    for (l = new_files; l; l = l->next)
+      m3u8_index_append (self, l);
+
+    self->files = first_reused;
     previous_files = NULL;
 
+    GST_DEBUG ("Kept %u files, %u new", last_pos - first_pos + 1,
+        self->index->len - (last_pos - first_pos + 1));
+  } else {
+    if (previous_files) {
+      if (have_mediasequence) {
+        consistent = check_media_seqnums (self, previous_files);
+      } else {
+        generate_media_seqnums (self, previous_files);
+      }
+
+      m3u8_files_free (previous_files);
+      previous_files = NULL;
+    }
+
+    m3u8_index_rebuild (self);
+
     /* error was reported above already */
     if (!consistent) {
       GST_M3U8_UNLOCK (self);
@@ -720,11 +950,17 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   {
     GList *walk;
     GstM3U8MediaFile *file;
-    GstClockTime duration = 0;
 
-    mediasequence = -1;
+    /* files taken over from the previous playlist were checked already */
+    if (incremental == 1) {
+      walk = last_reused->next;
+      mediasequence = GST_M3U8_MEDIA_FILE (last_reused->data)->sequence;
+    } else {
+      walk = self->files;
+      mediasequence = -1;
+    }
 
-    for (walk = self->files; walk; walk = walk->next) {
+    for (; walk; walk = walk->next) {
       file = walk->data;
 
       if (mediasequence == -1) {
@@ -737,7 +973,6 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         mediasequence = file->sequence;
       }
 
-      duration += file->duration;
       if (file->sequence > self->highest_sequence_number) {
         if (self->highest_sequence_number >= 0) {
           /* if an update of the media playlist has been missed, there
@@ -753,6 +988,8 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         self->highest_sequence_number = file->sequence;
       }
     }
+
+    duration = m3u8_index_position (self, self->index->len);
     if (GST_M3U8_IS_LIVE (self)) {
       self->first_file_start = self->last_file_end - duration;
       GST_DEBUG ("Live playlist range %" GST_TIME_FORMAT " -> %"
@@ -796,7 +1033,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   }
 
   GST_LOG ("processed media playlist %s, %u fragments", self->name,
-      g_list_length (self->files));
+      self->index->len);
 
   GST_M3U8_UNLOCK (self);
 
@@ -807,32 +1044,20 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 static GList *
 m3u8_find_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
-  GstM3U8MediaFile *file;
-  GList *l = m3u8->files;
+  guint i = m3u8_index_lower_bound (m3u8, m3u8->sequence);
 
   if (forward) {
-    while (l) {
-      file = l->data;
-
-      if (file->sequence >= m3u8->sequence)
-        break;
-
-      l = l->next;
-    }
+    if (i < m3u8->index->len)
+      return M3U8_INDEX (m3u8, i)->link;
   } else {
-    l = g_list_last (l);
-
-    while (l) {
-      file = l->data;
-
-      if (file->sequence <= m3u8->sequence)
-        break;
-
-      l = l->prev;
-    }
+    if (i < m3u8->index->len
+        && M3U8_INDEX_FILE (m3u8, i)->sequence == m3u8->sequence)
+      return M3U8_INDEX (m3u8, i)->link;
+    if (i > 0)
+      return M3U8_INDEX (m3u8, i - 1)->link;
   }
 
-  return l;
+  return NULL;
 }
 
 GstM3U8MediaFile *
@@ -902,13 +1127,40 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   return have_next;
 }
 
+/* Returns the @n-th fragment after the current one without advancing */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint n)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *cur;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->current_file) {
+    cur = m3u8->current_file;
+  } else {
+    cur = m3u8_find_next_fragment (m3u8, forward);
+  }
+
+  for (; cur && n > 0; n--)
+    cur = forward ? cur->next : cur->prev;
+
+  if (cur)
+    file = gst_m3u8_media_file_ref (cur->data);
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 /* call with M3U8_LOCK held */
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
 {
   gint targetnum = m3u8->sequence;
   GList *tmp;
-  GstM3U8MediaFile *mf;
 
   /* figure out the target seqnum */
   if (forward)
@@ -916,11 +1168,7 @@ m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
   else
     targetnum -= 1;
 
-  for (tmp = m3u8->files; tmp; tmp = tmp->next) {
-    mf = (GstM3U8MediaFile *) tmp->data;
-    if (mf->sequence == targetnum)
-      break;
-  }
+  tmp = m3u8_find_file_by_sequence (m3u8, targetnum);
   if (tmp == NULL) {
     GST_WARNING ("Can't find next fragment");
     return;
@@ -954,15 +1202,8 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
         GST_TIME_ARGS (m3u8->sequence_position));
   }
   if (!m3u8->current_file) {
-    GList *l;
-
     GST_DEBUG ("Looking for fragment %" G_GINT64_FORMAT, m3u8->sequence);
-    for (l = m3u8->files; l != NULL; l = l->next) {
-      if (GST_M3U8_MEDIA_FILE (l->data)->sequence == m3u8->sequence) {
-        m3u8->current_file = l;
-        break;
-      }
-    }
+    m3u8->current_file = m3u8_find_file_by_sequence (m3u8, m3u8->sequence);
     if (m3u8->current_file == NULL) {
       GST_DEBUG
           ("Could not find current fragment, trying next fragment directly");
@@ -973,8 +1214,8 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
         /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
            the end of the playlist. See section 6.3.3 of HLS draft */
         gint pos =
-            g_list_length (m3u8->files) - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-        m3u8->current_file = g_list_nth (m3u8->files, pos >= 0 ? pos : 0);
+            (gint) m3u8->index->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+        m3u8->current_file = M3U8_INDEX (m3u8, pos >= 0 ? pos : 0)->link;
         m3u8->current_file_duration =
             GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
 
@@ -1026,13 +1267,8 @@ gst_m3u8_get_duration (GstM3U8 * m3u8)
   if (!m3u8->endlist)
     goto out;
 
-  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files != NULL) {
-    GList *f;
-
-    m3u8->duration = 0;
-    for (f = m3u8->files; f != NULL; f = f->next)
-      m3u8->duration += GST_M3U8_MEDIA_FILE (f)->duration;
-  }
+  if (!GST_CLOCK_TIME_IS_VALID (m3u8->duration) && m3u8->files != NULL)
+    m3u8->duration = m3u8_index_position (m3u8, m3u8->index->len);
   duration = m3u8->duration;
 
 out:
@@ -1138,12 +1374,50 @@ out:
   return ret;
 }
 
+/* Returns the file that contains @ts, counted from the start of the first
+ * file of the playlist, and the position at which that file starts */
+GList *
+gst_m3u8_find_file_at_time (GstM3U8 * m3u8, GstClockTime ts,
+    GstClockTime * file_start)
+{
+  GList *link = NULL;
+  guint lo, hi;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->index->len == 0 || ts >= m3u8_index_position (m3u8,
+          m3u8->index->len))
+    goto out;
+
+  /* last file starting at or before ts */
+  lo = 0;
+  hi = m3u8->index->len;
+  while (hi - lo > 1) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (m3u8_index_position (m3u8, mid) <= ts)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  link = M3U8_INDEX (m3u8, lo)->link;
+  if (file_start)
+    *file_start = m3u8_index_position (m3u8, lo);
+
+out:
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return link;
+}
+
 gboolean
 gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
 {
   GstClockTime duration = 0;
-  GList *walk;
-  GstM3U8MediaFile *file;
   guint count;
   guint min_distance = 0;
 
@@ -1160,13 +1434,10 @@ gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
        playlist - see 6.3.3. "Playing the Playlist file" of the HLS draft */
     min_distance = GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
   }
-  count = g_list_length (m3u8->files);
+  count = m3u8->index->len;
 
-  for (walk = m3u8->files; walk && count > min_distance; walk = walk->next) {
-    file = walk->data;
-    --count;
-    duration += file->duration;
-  }
+  if (count > min_distance)
+    duration = m3u8_index_position (m3u8, count - min_distance);
 
   if (duration <= 0)
     goto out;
@@ -78,6 +78,7 @@ struct _GstM3U8
 
   /*< private > */
   gchar *last_data;
+  GArray *index;                /* GstM3U8FileIndex per entry in files */
   GMutex lock;
 
   gint ref_count;               /* ATOMIC */
@@ -123,6 +124,10 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  gboolean  forward,
+                                                  guint     n);
+
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
@@ -138,6 +143,10 @@ gboolean           gst_m3u8_get_seek_range       (GstM3U8 * m3u8,
                                                   gint64  * start,
                                                   gint64  * stop);
 
+GList *            gst_m3u8_find_file_at_time    (GstM3U8      * m3u8,
+                                                  GstClockTime   ts,
+                                                  GstClockTime * file_start);
+
 typedef enum
 {
   GST_HLS_MEDIA_TYPE_INVALID = -1,
@@ -1137,11 +1137,15 @@ gst_srtp_dec_push_early_events (GstSrtpDec * filter, GstPad * pad,
 
 /*
  * This function should be called while holding the filter lock
+ *
+ * The buffer is unprotected in place, *buf_ptr is replaced by a copy if
+ * it was not writable.
  */
 static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
-    gboolean is_rtcp, guint32 ssrc)
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad,
+    GstBuffer ** buf_ptr, gboolean is_rtcp, guint32 ssrc)
 {
+  GstBuffer *buf = *buf_ptr;
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
@@ -1151,7 +1155,7 @@ gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
       ssrc);
 
   /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
+  buf = *buf_ptr = gst_buffer_make_writable (buf);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   size = map.size;
@@ -1268,7 +1272,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     goto push_out;
   }
 
-  if (!gst_srtp_dec_decode_buffer (filter, pad, buf, is_rtcp, ssrc)) {
+  if (!gst_srtp_dec_decode_buffer (filter, pad, &buf, is_rtcp, ssrc)) {
     GST_OBJECT_UNLOCK (filter);
     goto drop_buffer;
   }
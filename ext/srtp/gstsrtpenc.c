@@ -127,6 +127,14 @@ GST_DEBUG_CATEGORY_STATIC (gst_srtp_enc_debug);
 #define DEFAULT_RANDOM_KEY      FALSE
 #define DEFAULT_REPLAY_WINDOW_SIZE 128
 #define DEFAULT_ALLOW_REPEAT_TX FALSE
+#define DEFAULT_N_THREADS       1
+
+/* Room needed after the packet for any SRTP or SRTCP trailer */
+#define MAX_TRAILER_SIZE (SRTP_MAX_TRAILER_LEN + 10)
+
+/* Size of the buffers used for packets that can't be protected in place,
+ * larger packets are allocated separately */
+#define POOL_BUFFER_SIZE (1500 + MAX_TRAILER_SIZE)
 
 #define HAS_CRYPTO(filter) (filter->rtp_cipher != GST_SRTP_CIPHER_NULL || \
       filter->rtcp_cipher != GST_SRTP_CIPHER_NULL ||                      \
@@ -152,17 +160,51 @@ enum
   PROP_RANDOM_KEY,
   PROP_REPLAY_WINDOW_SIZE,
   PROP_ALLOW_REPEAT_TX,
-  PROP_STATS
+  PROP_STATS,
+  PROP_N_THREADS
 };
 
-typedef struct ProcessBufferItData
+/* Every SSRC gets its own libsrtp session, so that packets of different
+ * streams can be protected concurrently. libsrtp sessions are not
+ * thread-safe, all uses of a session happen with its lock held.
+ * session is NULL once the element was reset. */
+typedef struct
+{
+  gint refcount;
+  GMutex lock;
+  guint32 ssrc;
+  srtp_t session;
+
+  /* Room needed after RTP and RTCP packets for the trailer */
+  guint rtp_trailer_size;
+  guint rtcp_trailer_size;
+} GstSrtpEncSession;
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint n_pending;
+} GstSrtpEncBatchWait;
+
+/* The packets of one SSRC from a buffer list, protected in order by a
+ * single thread */
+typedef struct
 {
   GstSrtpEnc *filter;
   GstPad *pad;
-  GstBufferList *out_list;
-  GstFlowReturn flowret;
   gboolean is_rtcp;
-} ProcessBufferItData;
+  guint32 ssrc;
+
+  /* Indices into buffers */
+  GstBuffer **buffers;
+  GArray *indices;
+
+  GstFlowReturn ret;
+  gboolean soft_limit_reached;
+
+  GstSrtpEncBatchWait *wait;
+} GstSrtpEncBatch;
 
 /* the capabilities of the inputs and outputs.
  *
@@ -319,6 +361,21 @@ gst_srtp_enc_class_init (GstSrtpEncClass * klass)
       g_param_spec_boxed ("stats", "Statistics", "Various statistics",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSrtpEnc:n-threads:
+   *
+   * Number of threads used to protect buffer lists that contain packets
+   * of several SSRCs. The packets of each SSRC are protected by a single
+   * thread, in order. 0 uses as many threads as there are processors.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads used to protect buffer lists "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstSrtpEnc::soft-limit:
    * @gstsrtpenc: the element on which the signal is emitted
@@ -333,6 +390,36 @@ gst_srtp_enc_class_init (GstSrtpEncClass * klass)
 }
 
 
+static GstSrtpEncSession *
+gst_srtp_enc_session_ref (GstSrtpEncSession * session)
+{
+  g_atomic_int_inc (&session->refcount);
+
+  return session;
+}
+
+static void
+gst_srtp_enc_session_unref (GstSrtpEncSession * session)
+{
+  if (g_atomic_int_dec_and_test (&session->refcount)) {
+    g_mutex_clear (&session->lock);
+    g_slice_free (GstSrtpEncSession, session);
+  }
+}
+
+/* Called when a session is removed from the sessions table, other
+ * threads might still be holding a reference to it */
+static void
+gst_srtp_enc_session_free (GstSrtpEncSession * session)
+{
+  g_mutex_lock (&session->lock);
+  srtp_dealloc (session->session);
+  session->session = NULL;
+  g_mutex_unlock (&session->lock);
+
+  gst_srtp_enc_session_unref (session);
+}
+
 /* initialize the new element
  */
 static void
@@ -347,7 +434,9 @@ gst_srtp_enc_init (GstSrtpEnc * filter)
   filter->rtcp_auth = DEFAULT_RTCP_AUTH;
   filter->replay_window_size = DEFAULT_REPLAY_WINDOW_SIZE;
   filter->allow_repeat_tx = DEFAULT_ALLOW_REPEAT_TX;
-  filter->ssrcs_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+  filter->n_threads = DEFAULT_N_THREADS;
+  filter->sessions = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) gst_srtp_enc_session_free);
 }
 
 static guint
@@ -361,12 +450,50 @@ max_cipher_key_size (GstSrtpEnc * filter)
   return (rtp_size > rtcp_size) ? rtp_size : rtcp_size;
 }
 
-/* Create stream
+/* Check that a key is set and matches the ciphers
+ *
+ * Should be called with the filter locked
+ */
+static gboolean
+gst_srtp_enc_check_key (GstSrtpEnc * filter)
+{
+  guint expected;
+  gsize keysize;
+
+  if (!HAS_CRYPTO (filter))
+    return TRUE;
+
+  if (filter->key == NULL) {
+    GST_OBJECT_UNLOCK (filter);
+    GST_ELEMENT_ERROR (filter, LIBRARY, SETTINGS,
+        ("Cipher is not NULL, key must be set"),
+        ("Cipher is not NULL, key must be set"));
+    GST_OBJECT_LOCK (filter);
+    return FALSE;
+  }
+
+  expected = max_cipher_key_size (filter);
+  keysize = gst_buffer_get_size (filter->key);
+
+  if (expected != keysize) {
+    GST_OBJECT_UNLOCK (filter);
+    GST_ELEMENT_ERROR (filter, LIBRARY, SETTINGS,
+        ("Master key size is wrong"),
+        ("Expected master key of %d bytes, but received %" G_GSIZE_FORMAT
+            " bytes", expected, keysize));
+    GST_OBJECT_LOCK (filter);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Create session
  *
  * Should be called with the filter locked
  */
 static srtp_err_status_t
-gst_srtp_enc_create_session (GstSrtpEnc * filter)
+gst_srtp_enc_create_session (GstSrtpEnc * filter, srtp_t * session)
 {
   srtp_err_status_t ret;
   srtp_policy_t policy;
@@ -375,32 +502,10 @@ gst_srtp_enc_create_session (GstSrtpEnc * filter)
 
   memset (&policy, 0, sizeof (srtp_policy_t));
 
-  if (HAS_CRYPTO (filter)) {
-    guint expected;
-    gsize keysize;
-
-    if (filter->key == NULL) {
-      GST_OBJECT_UNLOCK (filter);
-      GST_ELEMENT_ERROR (filter, LIBRARY, SETTINGS,
-          ("Cipher is not NULL, key must be set"),
-          ("Cipher is not NULL, key must be set"));
-      GST_OBJECT_LOCK (filter);
-      return srtp_err_status_fail;
-    }
-
-    expected = max_cipher_key_size (filter);
-    keysize = gst_buffer_get_size (filter->key);
-
-    if (expected != keysize) {
-      GST_OBJECT_UNLOCK (filter);
-      GST_ELEMENT_ERROR (filter, LIBRARY, SETTINGS,
-          ("Master key size is wrong"),
-          ("Expected master key of %d bytes, but received %" G_GSIZE_FORMAT
-              " bytes", expected, keysize));
-      GST_OBJECT_LOCK (filter);
-      return srtp_err_status_fail;
-    }
-  }
+  /* The key might have changed since it was checked */
+  if (HAS_CRYPTO (filter) && (filter->key == NULL ||
+          gst_buffer_get_size (filter->key) != max_cipher_key_size (filter)))
+    return srtp_err_status_bad_param;
 
   GST_DEBUG_OBJECT (filter, "Setting RTP/RTCP policy to %d / %d",
       filter->rtp_cipher, filter->rtcp_cipher);
@@ -423,11 +528,7 @@ gst_srtp_enc_create_session (GstSrtpEnc * filter)
   policy.window_size = filter->replay_window_size;
   policy.allow_repeat_tx = filter->allow_repeat_tx;
 
-  /* If it is the first stream, create the session
-   * If not, add the stream to the session
-   */
-  ret = srtp_create (&filter->session, &policy);
-  filter->first_session = FALSE;
+  ret = srtp_create (session, &policy);
 
   if (HAS_CRYPTO (filter))
     gst_buffer_unmap (filter->key, &map);
@@ -435,17 +536,119 @@ gst_srtp_enc_create_session (GstSrtpEnc * filter)
   return ret;
 }
 
+/* The trailer sizes only depend on the policy of @session */
+static void
+gst_srtp_enc_get_trailer_sizes (srtp_t session, guint * rtp_size,
+    guint * rtcp_size)
+{
+#ifdef HAVE_SRTP2
+  uint32_t length;
+
+  if (srtp_get_protect_trailer_length (session, 0, 0,
+          &length) == srtp_err_status_ok)
+    *rtp_size = length;
+  else
+    *rtp_size = MAX_TRAILER_SIZE;
+
+  if (srtp_get_protect_rtcp_trailer_length (session, 0, 0,
+          &length) == srtp_err_status_ok)
+    *rtcp_size = length;
+  else
+    *rtcp_size = MAX_TRAILER_SIZE;
+#else
+  *rtp_size = *rtcp_size = MAX_TRAILER_SIZE;
+#endif
+}
+
+/* Returns a new reference to the session for @ssrc, creating it if
+ * needed */
+static GstSrtpEncSession *
+gst_srtp_enc_get_session (GstSrtpEnc * filter, guint32 ssrc,
+    srtp_err_status_t * status)
+{
+  GstSrtpEncSession *session;
+
+  GST_OBJECT_LOCK (filter);
+
+  session = g_hash_table_lookup (filter->sessions, GUINT_TO_POINTER (ssrc));
+  if (session == NULL) {
+    srtp_t srtp_session;
+
+    *status = gst_srtp_enc_create_session (filter, &srtp_session);
+    if (*status != srtp_err_status_ok) {
+      GST_OBJECT_UNLOCK (filter);
+      return NULL;
+    }
+
+    GST_DEBUG_OBJECT (filter, "Created session for SSRC %u", ssrc);
+
+    session = g_slice_new0 (GstSrtpEncSession);
+    session->refcount = 1;
+    g_mutex_init (&session->lock);
+    session->ssrc = ssrc;
+    session->session = srtp_session;
+    gst_srtp_enc_get_trailer_sizes (srtp_session, &session->rtp_trailer_size,
+        &session->rtcp_trailer_size);
+    g_hash_table_insert (filter->sessions, GUINT_TO_POINTER (ssrc), session);
+  }
+  gst_srtp_enc_session_ref (session);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  return session;
+}
+
+static void
+gst_srtp_enc_unlock_session (GstSrtpEncSession ** session)
+{
+  if (*session) {
+    g_mutex_unlock (&(*session)->lock);
+    gst_srtp_enc_session_unref (*session);
+    *session = NULL;
+  }
+}
+
+/* Makes *@session the locked session for @ssrc. The lock of the previous
+ * session is kept when it is for the same SSRC, so that consecutive
+ * packets of one stream only need a single lookup. */
+static gboolean
+gst_srtp_enc_lock_session (GstSrtpEnc * filter, guint32 ssrc,
+    GstSrtpEncSession ** session, srtp_err_status_t * status)
+{
+  GstSrtpEncSession *s;
+
+  if (*session) {
+    if ((*session)->ssrc == ssrc)
+      return TRUE;
+    gst_srtp_enc_unlock_session (session);
+  }
+
+  /* The session is gone if the element was reset in the meantime, a new
+   * one is created then */
+  do {
+    s = gst_srtp_enc_get_session (filter, ssrc, status);
+    if (s == NULL)
+      return FALSE;
+
+    g_mutex_lock (&s->lock);
+    if (s->session)
+      break;
+    g_mutex_unlock (&s->lock);
+    gst_srtp_enc_session_unref (s);
+  } while (TRUE);
+
+  *session = s;
+
+  return TRUE;
+}
+
 /* Release ressources and set default values
  */
 static void
 gst_srtp_enc_reset_no_lock (GstSrtpEnc * filter)
 {
-  if (!filter->first_session) {
-    srtp_dealloc (filter->session);
-    filter->session = NULL;
-
-    g_hash_table_remove_all (filter->ssrcs_set);
-  }
+  if (!filter->first_session)
+    g_hash_table_remove_all (filter->sessions);
 
   filter->first_session = TRUE;
   filter->key_changed = FALSE;
@@ -599,9 +802,9 @@ gst_srtp_enc_dispose (GObject * object)
     gst_buffer_unref (filter->key);
   filter->key = NULL;
 
-  if (filter->ssrcs_set)
-    g_hash_table_unref (filter->ssrcs_set);
-  filter->ssrcs_set = NULL;
+  if (filter->sessions)
+    g_hash_table_unref (filter->sessions);
+  filter->sessions = NULL;
 
   G_OBJECT_CLASS (gst_srtp_enc_parent_class)->dispose (object);
 }
@@ -618,24 +821,26 @@ gst_srtp_enc_create_stats (GstSrtpEnc * filter)
   g_value_init (&va, GST_TYPE_ARRAY);
   g_value_init (&v, GST_TYPE_STRUCTURE);
 
-  if (filter->session) {
+  if (filter->sessions) {
     GHashTableIter iter;
-    gpointer key;
+    gpointer value;
 
-    g_hash_table_iter_init (&iter, filter->ssrcs_set);
-    while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    g_hash_table_iter_init (&iter, filter->sessions);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+      GstSrtpEncSession *session = value;
       GstStructure *ss;
-      guint32 ssrc = GPOINTER_TO_UINT (key);
       srtp_err_status_t status;
       guint32 roc;
 
-      status = srtp_get_stream_roc (filter->session, ssrc, &roc);
+      g_mutex_lock (&session->lock);
+      status = srtp_get_stream_roc (session->session, session->ssrc, &roc);
+      g_mutex_unlock (&session->lock);
       if (status != srtp_err_status_ok) {
         continue;
       }
 
       ss = gst_structure_new ("application/x-srtp-stream",
-          "ssrc", G_TYPE_UINT, ssrc, "roc", G_TYPE_UINT, roc, NULL);
+          "ssrc", G_TYPE_UINT, session->ssrc, "roc", G_TYPE_UINT, roc, NULL);
 
       g_value_take_boxed (&v, ss);
       gst_value_array_append_value (&va, &v);
@@ -648,6 +853,21 @@ gst_srtp_enc_create_stats (GstSrtpEnc * filter)
   return s;
 }
 
+/* The thread pushing a buffer list protects one batch itself
+ *
+ * Should be called with the filter locked
+ */
+static gint
+gst_srtp_enc_get_max_pool_threads (GstSrtpEnc * filter)
+{
+  guint n_threads = filter->n_threads;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  return MAX (n_threads, 2) - 1;
+}
+
 static void
 gst_srtp_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -698,6 +918,13 @@ gst_srtp_enc_set_property (GObject * object, guint prop_id,
       filter->allow_repeat_tx = g_value_get_boolean (value);
       break;
 
+    case PROP_N_THREADS:
+      filter->n_threads = g_value_get_uint (value);
+      if (filter->thread_pool)
+        g_thread_pool_set_max_threads (filter->thread_pool,
+            gst_srtp_enc_get_max_pool_threads (filter), NULL);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -742,6 +969,9 @@ gst_srtp_enc_get_property (GObject * object, guint prop_id,
     case PROP_STATS:
       g_value_take_boxed (value, gst_srtp_enc_create_stats (filter));
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -807,12 +1037,6 @@ gst_srtp_enc_sink_setcaps (GstPad * pad, GstSrtpEnc * filter,
 
   GST_OBJECT_LOCK (filter);
 
-  if (gst_structure_has_field_typed (ps, "ssrc", G_TYPE_UINT)) {
-    guint ssrc;
-    gst_structure_get_uint (ps, "ssrc", &ssrc);
-    g_hash_table_add (filter->ssrcs_set, GUINT_TO_POINTER (ssrc));
-  }
-
   if (HAS_CRYPTO (filter))
     gst_structure_set (ps, "srtp-key", GST_TYPE_BUFFER, filter->key, NULL);
 
@@ -1001,16 +1225,13 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
     do_setcaps = TRUE;
   }
 
+  /* Sessions are created for each SSRC when its first packet arrives */
   if (filter->first_session) {
-    srtp_err_status_t status = gst_srtp_enc_create_session (filter);
-
-    if (status != srtp_err_status_ok) {
+    if (!gst_srtp_enc_check_key (filter)) {
       GST_OBJECT_UNLOCK (filter);
-      GST_ELEMENT_ERROR (filter, LIBRARY, INIT,
-          ("Could not initialize SRTP encoder"),
-          ("Failed to add stream to SRTP encoder (err: %d)", status));
       return GST_FLOW_ERROR;
     }
+    filter->first_session = FALSE;
   }
 
   GST_OBJECT_UNLOCK (filter);
@@ -1030,55 +1251,113 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
+static guint32
+gst_srtp_enc_get_ssrc (GstBuffer * buf, gboolean is_rtcp)
+{
+  guint8 data[4];
+
+  /* The SSRC libsrtp looks up the stream with: the one of the RTP header
+   * or the sender SSRC of the first RTCP packet */
+  if (gst_buffer_extract (buf, is_rtcp ? 4 : 8, data, 4) != 4)
+    return 0;
+
+  return GST_READ_UINT32_BE (data);
+}
+
+static gboolean
+gst_srtp_enc_can_protect_in_place (GstBuffer * buf, gsize size_max)
+{
+  GstMemory *mem;
+  gsize offset, maxsize;
+
+  if (!gst_buffer_is_writable (buf) || gst_buffer_n_memory (buf) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buf, 0);
+  if (!gst_memory_is_writable (mem))
+    return FALSE;
+
+  gst_memory_get_sizes (mem, &offset, &maxsize);
+
+  return maxsize - offset >= size_max;
+}
+
+static GstBuffer *
+gst_srtp_enc_alloc_buffer (GstSrtpEnc * filter, gsize size)
+{
+  GstBuffer *buf = NULL;
+
+  if (filter->pool && size <= POOL_BUFFER_SIZE &&
+      gst_buffer_pool_acquire_buffer (filter->pool, &buf,
+          NULL) == GST_FLOW_OK)
+    return buf;
+
+  return gst_buffer_new_allocate (NULL, size, NULL);
+}
+
+/* Protects @buf in place if it is writable and has enough room for the
+ * trailer, in which case *@outbuf_ptr is set to @buf. Otherwise the
+ * protected packet is written to a new buffer.
+ *
+ * *@session is the session used for the previous packet. It is kept
+ * locked for the next call and has to be released with
+ * gst_srtp_enc_unlock_session() afterwards. */
 static GstFlowReturn
 gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
-    GstBuffer * buf, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
+    GstBuffer * buf, gboolean is_rtcp, GstSrtpEncSession ** session,
+    GstBuffer ** outbuf_ptr)
 {
   GstFlowReturn ret = GST_FLOW_OK;
   gint size_max, size;
   GstBuffer *bufout = NULL;
   GstMapInfo mapout;
   srtp_err_status_t err;
+  guint32 ssrc;
 
-  /* Create a bigger buffer to add protection */
   size = gst_buffer_get_size (buf);
-  size_max = size + SRTP_MAX_TRAILER_LEN + 10;
-  bufout = gst_buffer_new_allocate (NULL, size_max, NULL);
+  ssrc = gst_srtp_enc_get_ssrc (buf, is_rtcp);
 
-  gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  if (!gst_srtp_enc_lock_session (filter, ssrc, session, &err)) {
+    GST_ELEMENT_ERROR (filter, LIBRARY, INIT,
+        ("Could not initialize SRTP encoder"),
+        ("Failed to add stream to SRTP encoder (err: %d)", err));
+    return GST_FLOW_ERROR;
+  }
 
-  gst_buffer_extract (buf, 0, mapout.data, size);
+  size_max = size + (is_rtcp ? (*session)->rtcp_trailer_size :
+      (*session)->rtp_trailer_size);
 
-  GST_OBJECT_LOCK (filter);
+  if (gst_srtp_enc_can_protect_in_place (buf, size_max)) {
+    bufout = buf;
+    gst_buffer_resize (bufout, 0, size_max);
+    gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  } else {
+    bufout = gst_srtp_enc_alloc_buffer (filter, size_max);
+    gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+    gst_buffer_extract (buf, 0, mapout.data, size);
+  }
 
   gst_srtp_init_event_reporter ();
 
-  if (filter->session == NULL) {
-    /* The rtcp session disappeared (element shutting down) */
-    GST_OBJECT_UNLOCK (filter);
-    ret = GST_FLOW_FLUSHING;
-    goto fail;
-  }
-
   if (is_rtcp)
-    err = srtp_protect_rtcp (filter->session, mapout.data, &size);
+    err = srtp_protect_rtcp ((*session)->session, mapout.data, &size);
   else
-    err = srtp_protect (filter->session, mapout.data, &size);
-
-  GST_OBJECT_UNLOCK (filter);
+    err = srtp_protect ((*session)->session, mapout.data, &size);
 
   gst_buffer_unmap (bufout, &mapout);
 
   if (err == srtp_err_status_ok) {
     /* Buffer protected */
     gst_buffer_set_size (bufout, size);
-    gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    if (bufout != buf)
+      gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
 
-    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
+    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d%s",
+        is_rtcp ? "RTCP" : "RTP", size, bufout == buf ? " in place" : "");
 
   } else if (err == srtp_err_status_key_expired) {
 
+    gst_srtp_enc_unlock_session (session);
     GST_ELEMENT_ERROR (GST_ELEMENT_CAST (filter), STREAM, ENCODE,
         ("Key usage limit has been reached"),
         ("Unable to protect buffer (hard key usage limit reached)"));
@@ -1087,6 +1366,7 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
 
   } else {
     /* srtp_protect failed */
+    gst_srtp_enc_unlock_session (session);
     GST_ELEMENT_ERROR (filter, LIBRARY, FAILED, (NULL),
         ("Unable to protect buffer (protect failed) code %d", err));
     ret = GST_FLOW_ERROR;
@@ -1097,7 +1377,8 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
   return ret;
 
 fail:
-  gst_buffer_unref (bufout);
+  if (bufout != buf)
+    gst_buffer_unref (bufout);
   return ret;
 }
 
@@ -1109,6 +1390,7 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
   GstBuffer *bufout = NULL;
+  GstSrtpEncSession *session = NULL;
 
   if ((ret = gst_srtp_enc_check_set_caps (filter, pad, is_rtcp)) != GST_FLOW_OK) {
     goto out;
@@ -1124,10 +1406,16 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
   GST_OBJECT_UNLOCK (filter);
 
-  ret = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp, &bufout);
+  ret = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp, &session,
+      &bufout);
+  gst_srtp_enc_unlock_session (&session);
   if (ret != GST_FLOW_OK)
     goto out;
 
+  /* Protected in place, the reference is passed on */
+  if (bufout == buf)
+    buf = NULL;
+
   /* Push buffer to source pad */
   otherpad = get_rtp_other_pad (pad);
   ret = gst_pad_push (otherpad, bufout);
@@ -1149,27 +1437,52 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GST_OBJECT_UNLOCK (filter);
 
 out:
-  gst_buffer_unref (buf);
+  if (buf)
+    gst_buffer_unref (buf);
   return ret;
 }
 
-static gboolean
-process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+static void
+gst_srtp_enc_process_batch (GstSrtpEncBatch * batch)
 {
-  ProcessBufferItData *data = user_data;
-  GstBuffer *bufout;
-  GstFlowReturn ret;
+  GstSrtpEncSession *session = NULL;
+  guint i;
 
-  ret = gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
-      data->is_rtcp, &bufout);
-  if (ret != GST_FLOW_OK) {
-    data->flowret = ret;
-    return FALSE;
+  /* The session stays locked for all packets of the batch */
+  for (i = 0; i < batch->indices->len; i++) {
+    guint idx = g_array_index (batch->indices, guint, i);
+    GstBuffer *buf = batch->buffers[idx];
+    GstBuffer *bufout;
+
+    batch->ret = gst_srtp_enc_process_buffer (batch->filter, batch->pad, buf,
+        batch->is_rtcp, &session, &bufout);
+    if (batch->ret != GST_FLOW_OK)
+      break;
+
+    /* Only known to the thread that protected the packet */
+    if (gst_srtp_get_soft_limit_reached ())
+      batch->soft_limit_reached = TRUE;
+
+    if (bufout != buf) {
+      gst_buffer_unref (buf);
+      batch->buffers[idx] = bufout;
+    }
   }
 
-  gst_buffer_list_add (data->out_list, bufout);
+  gst_srtp_enc_unlock_session (&session);
+}
 
-  return TRUE;
+static void
+gst_srtp_enc_batch_thread_func (gpointer data, gpointer user_data)
+{
+  GstSrtpEncBatch *batch = data;
+
+  gst_srtp_enc_process_batch (batch);
+
+  g_mutex_lock (&batch->wait->lock);
+  if (--batch->wait->n_pending == 0)
+    g_cond_signal (&batch->wait->cond);
+  g_mutex_unlock (&batch->wait->lock);
 }
 
 static GstFlowReturn
@@ -1179,8 +1492,13 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstSrtpEnc *filter = GST_SRTP_ENC (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
-  GstBufferList *out_list = NULL;
-  ProcessBufferItData process_data;
+  GThreadPool *thread_pool = NULL;
+  GstBuffer **buffers;
+  GArray *batches;
+  GstSrtpEncBatch *batch = NULL;
+  GstSrtpEncBatchWait wait;
+  gboolean soft_limit_reached = FALSE;
+  guint i, j, len;
 
   GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
       gst_buffer_list_length (buf_list));
@@ -1201,30 +1519,114 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_UNLOCK (filter);
 
-  out_list = gst_buffer_list_new ();
+  /* Split the list into one batch per SSRC. Once the list is released
+   * the buffers can be protected in place if nothing else uses them. */
+  len = gst_buffer_list_length (buf_list);
+  buffers = g_new (GstBuffer *, len);
+  batches = g_array_new (FALSE, TRUE, sizeof (GstSrtpEncBatch));
 
-  process_data.filter = filter;
-  process_data.pad = pad;
-  process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
-  process_data.flowret = GST_FLOW_OK;
+  for (i = 0; i < len; i++) {
+    guint32 ssrc;
 
-  if (!gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data)) {
-    ret = process_data.flowret;
-    goto out;
+    buffers[i] = gst_buffer_ref (gst_buffer_list_get (buf_list, i));
+    ssrc = gst_srtp_enc_get_ssrc (buffers[i], is_rtcp);
+
+    if (batch == NULL || batch->ssrc != ssrc) {
+      for (j = 0; j < batches->len; j++) {
+        batch = &g_array_index (batches, GstSrtpEncBatch, j);
+        if (batch->ssrc == ssrc)
+          break;
+      }
+
+      if (j == batches->len) {
+        g_array_set_size (batches, j + 1);
+        batch = &g_array_index (batches, GstSrtpEncBatch, j);
+        batch->filter = filter;
+        batch->pad = pad;
+        batch->is_rtcp = is_rtcp;
+        batch->ssrc = ssrc;
+        batch->buffers = buffers;
+        batch->indices = g_array_new (FALSE, FALSE, sizeof (guint));
+        batch->ret = GST_FLOW_OK;
+        batch->wait = &wait;
+      }
+    }
+
+    g_array_append_val (batch->indices, i);
   }
 
-  if (!gst_buffer_list_length (out_list)) {
-    gst_buffer_list_unref (out_list);
-    ret = GST_FLOW_OK;
-    goto out;
+  gst_buffer_list_unref (buf_list);
+  buf_list = NULL;
+
+  GST_LOG_OBJECT (pad, "Protecting %u batches", batches->len);
+
+  if (batches->len > 1) {
+    GST_OBJECT_LOCK (filter);
+    if (filter->n_threads != 1) {
+      if (filter->thread_pool == NULL)
+        filter->thread_pool =
+            g_thread_pool_new (gst_srtp_enc_batch_thread_func, NULL,
+            gst_srtp_enc_get_max_pool_threads (filter), FALSE, NULL);
+      thread_pool = filter->thread_pool;
+    }
+    GST_OBJECT_UNLOCK (filter);
   }
 
+  if (thread_pool) {
+    g_mutex_init (&wait.lock);
+    g_cond_init (&wait.cond);
+    wait.n_pending = batches->len - 1;
+
+    for (i = 1; i < batches->len; i++)
+      g_thread_pool_push (thread_pool,
+          &g_array_index (batches, GstSrtpEncBatch, i), NULL);
+
+    gst_srtp_enc_process_batch (&g_array_index (batches, GstSrtpEncBatch, 0));
+
+    g_mutex_lock (&wait.lock);
+    while (wait.n_pending > 0)
+      g_cond_wait (&wait.cond, &wait.lock);
+    g_mutex_unlock (&wait.lock);
+
+    g_cond_clear (&wait.cond);
+    g_mutex_clear (&wait.lock);
+  } else {
+    for (i = 0; i < batches->len; i++) {
+      batch = &g_array_index (batches, GstSrtpEncBatch, i);
+      gst_srtp_enc_process_batch (batch);
+      if (batch->ret != GST_FLOW_OK)
+        break;
+    }
+  }
+
+  for (i = 0; i < batches->len; i++) {
+    batch = &g_array_index (batches, GstSrtpEncBatch, i);
+    if (ret == GST_FLOW_OK)
+      ret = batch->ret;
+    soft_limit_reached |= batch->soft_limit_reached;
+    g_array_free (batch->indices, TRUE);
+  }
+  g_array_free (batches, TRUE);
+
+  /* The original order of the packets is kept */
+  if (ret == GST_FLOW_OK) {
+    buf_list = gst_buffer_list_new_sized (len);
+    for (i = 0; i < len; i++)
+      gst_buffer_list_add (buf_list, buffers[i]);
+  } else {
+    for (i = 0; i < len; i++)
+      gst_buffer_unref (buffers[i]);
+  }
+  g_free (buffers);
+
+  if (ret != GST_FLOW_OK)
+    goto out;
+
   /* Push buffer to source pad */
   otherpad = get_rtp_other_pad (pad);
-  GST_LOG_OBJECT (pad, "Pushing buffer chain of %d",
-      gst_buffer_list_length (buf_list));
-  ret = gst_pad_push_list (otherpad, out_list);
+  GST_LOG_OBJECT (pad, "Pushing buffer chain of %d", len);
+  ret = gst_pad_push_list (otherpad, buf_list);
+  buf_list = NULL;
 
   if (ret != GST_FLOW_OK) {
     goto out;
@@ -1232,7 +1634,7 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_LOCK (filter);
 
-  if (gst_srtp_get_soft_limit_reached ()) {
+  if (soft_limit_reached) {
     GST_OBJECT_UNLOCK (filter);
     g_signal_emit (filter, gst_srtp_enc_signals[SIGNAL_SOFT_LIMIT], 0);
     GST_OBJECT_LOCK (filter);
@@ -1244,7 +1646,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
 out:
 
-  gst_buffer_list_unref (buf_list);
+  if (buf_list)
+    gst_buffer_list_unref (buf_list);
 
   return ret;
 }
@@ -1313,7 +1716,20 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       GST_OBJECT_UNLOCK (filter);
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+      GstStructure *config;
+
+      filter->pool = gst_buffer_pool_new ();
+      config = gst_buffer_pool_get_config (filter->pool);
+      gst_buffer_pool_config_set_params (config, NULL, POOL_BUFFER_SIZE, 0, 0);
+      if (!gst_buffer_pool_set_config (filter->pool, config) ||
+          !gst_buffer_pool_set_active (filter->pool, TRUE)) {
+        GST_WARNING_OBJECT (filter, "Failed to activate buffer pool");
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
       break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
     default:
@@ -1328,6 +1744,15 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_srtp_enc_reset (filter);
+      if (filter->thread_pool) {
+        g_thread_pool_free (filter->thread_pool, FALSE, TRUE);
+        filter->thread_pool = NULL;
+      }
+      if (filter->pool) {
+        gst_buffer_pool_set_active (filter->pool, FALSE);
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
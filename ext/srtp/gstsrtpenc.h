@@ -77,14 +77,19 @@ struct _GstSrtpEnc
   guint rtcp_cipher;
   guint rtcp_auth;
 
-  srtp_t session;
   gboolean first_session;
   gboolean key_changed;
 
   guint replay_window_size;
   gboolean allow_repeat_tx;
 
-  GHashTable *ssrcs_set;
+  /* SSRC -> GstSrtpEncSession */
+  GHashTable *sessions;
+
+  GstBufferPool *pool;
+
+  guint n_threads;
+  GThreadPool *thread_pool;
 };
 
 struct _GstSrtpEncClass
@@ -123,6 +123,8 @@ that the demux object and its streams are not changed by anybody else.
 #include "gst/gst-i18n-plugin.h"
 #include <gst/base/gstadapter.h>
 
+#include <math.h>
+
 GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define GST_CAT_DEFAULT adaptivedemux_debug
 
@@ -130,8 +132,19 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_BITRATE_LIMIT 0.8f
+#define DEFAULT_PREFETCH_FRAGMENTS 0
+#define MAX_PREFETCH_FRAGMENTS 16
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+#define DEFAULT_BANDWIDTH_ESTIMATOR GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_AVERAGE
+/* number of fragments the harmonic mean is taken over */
+#define BANDWIDTH_WINDOW_SIZE 10
+/* half-lives of the moving averages, in seconds of download time */
+#define EWMA_FAST_HALF_LIFE 2.0
+#define EWMA_SLOW_HALF_LIFE 5.0
+/* downloads smaller than this mostly measure latency and are not used by
+ * the harmonic and EWMA estimators */
+#define MIN_BANDWIDTH_SAMPLE_BYTES 16000
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -158,6 +171,8 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_FRAGMENTS,
+  PROP_BANDWIDTH_ESTIMATOR,
   PROP_LAST
 };
 
@@ -206,8 +221,28 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* Downloads upcoming fragments of all streams */
+  GThreadPool *prefetch_pool;   /* protected by manifest_lock */
 };
 
+/* An upcoming fragment downloaded ahead of time over its own connection */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  GstAdaptiveDemuxStream *stream;
+  GstUriDownloader *downloader;
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  /* protected by the stream's prefetch_lock */
+  gboolean done;
+  /* no longer queued, freed by the prefetch thread when done */
+  gboolean dropped;
+  GstFragment *download;
+  GError *error;
+} GstAdaptiveDemuxPrefetch;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -305,6 +340,35 @@ static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
 static gboolean
 gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
     * demux);
+static void gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream *
+    stream);
+static void gst_adaptive_demux_stream_flush_prefetch (GstAdaptiveDemuxStream *
+    stream, guint keep);
+static void gst_adaptive_demux_stream_stop_prefetch (GstAdaptiveDemuxStream *
+    stream);
+
+GType
+gst_adaptive_demux_bandwidth_estimator_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue estimators[] = {
+    {GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_AVERAGE,
+        "Average of the last fragments", "average"},
+    {GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC,
+        "Harmonic mean over a sliding window", "harmonic"},
+    {GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_EWMA,
+        "Fast and slow exponentially weighted moving averages", "ewma"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = g_enum_register_static ("GstAdaptiveDemuxBandwidthEstimator",
+        estimators);
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
  * method to get to the padtemplates */
@@ -362,6 +426,12 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      demux->prefetch_fragments = g_value_get_uint (value);
+      break;
+    case PROP_BANDWIDTH_ESTIMATOR:
+      demux->bandwidth_estimator = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -386,6 +456,12 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      g_value_set_uint (value, demux->prefetch_fragments);
+      break;
+    case PROP_BANDWIDTH_ESTIMATOR:
+      g_value_set_enum (value, demux->bandwidth_estimator);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -431,6 +507,37 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-fragments:
+   *
+   * Number of upcoming fragments of each stream that are downloaded in
+   * parallel with the current one, each over its own connection. This helps
+   * to keep up high bitrates on links with a large round-trip time. Only
+   * used if the subclass can tell where the upcoming fragments are.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_FRAGMENTS,
+      g_param_spec_uint ("prefetch-fragments", "Prefetch fragments",
+          "Number of upcoming fragments to download in parallel (0 = disabled)",
+          0, MAX_PREFETCH_FRAGMENTS, DEFAULT_PREFETCH_FRAGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:bandwidth-estimator:
+   *
+   * The algorithm used to estimate the available bandwidth from the
+   * fragment downloads, which is then used to select the bitrate.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BANDWIDTH_ESTIMATOR,
+      g_param_spec_enum ("bandwidth-estimator", "Bandwidth estimator",
+          "Algorithm used to estimate the available bandwidth",
+          GST_TYPE_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR,
+          DEFAULT_BANDWIDTH_ESTIMATOR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -523,6 +630,8 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->prefetch_fragments = DEFAULT_PREFETCH_FRAGMENTS;
+  demux->bandwidth_estimator = DEFAULT_BANDWIDTH_ESTIMATOR;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -538,6 +647,9 @@ gst_adaptive_demux_finalize (GObject * object)
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
 
+  if (priv->prefetch_pool)
+    g_thread_pool_free (priv->prefetch_pool, TRUE, TRUE);
+
   g_mutex_clear (&priv->updates_timed_lock);
   g_cond_clear (&priv->updates_timed_cond);
   g_mutex_clear (&demux->priv->manifest_update_lock);
@@ -1318,6 +1430,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   stream->demux = demux;
   stream->fragment_bitrates =
       g_malloc0 (sizeof (guint64) * NUM_LOOKBACK_FRAGMENTS);
+  stream->window_bitrates = g_new0 (guint64, BANDWIDTH_WINDOW_SIZE);
   gst_pad_set_element_private (pad, stream);
   stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
 
@@ -1334,6 +1447,9 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_cond_init (&stream->prefetch_cond);
+  g_mutex_init (&stream->prefetch_lock);
+  g_queue_init (&stream->prefetch_queue);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1398,6 +1514,8 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  gst_adaptive_demux_stream_stop_prefetch (stream);
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -1433,7 +1551,10 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   g_cond_clear (&stream->fragment_download_cond);
   g_mutex_clear (&stream->fragment_download_lock);
+  g_cond_clear (&stream->prefetch_cond);
+  g_mutex_clear (&stream->prefetch_lock);
   g_free (stream->fragment_bitrates);
+  g_free (stream->window_bitrates);
 
   if (stream->pad) {
     gst_object_unref (stream->pad);
@@ -2100,6 +2221,8 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      gst_adaptive_demux_stream_cancel_prefetch (stream);
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2156,6 +2279,7 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       stream->download_error_count = 0;
       stream->need_header = TRUE;
       stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
+      gst_adaptive_demux_stream_flush_prefetch (stream, 0);
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2227,6 +2351,85 @@ _update_average_bitrate (GstAdaptiveDemux * demux,
   return stream->moving_bitrate / stream->moving_index;
 }
 
+/* Whether the last download is large enough to tell about the bandwidth */
+static gboolean
+_is_bandwidth_sample (GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+{
+  return new_bitrate > 0
+      && stream->fragment_bytes_downloaded >= MIN_BANDWIDTH_SAMPLE_BYTES;
+}
+
+/* must be called with manifest_lock taken */
+static guint64
+_update_harmonic_bitrate (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+{
+  gdouble sum = 0;
+  guint i, n;
+
+  /* small downloads only count until there is a real sample */
+  if (_is_bandwidth_sample (stream, new_bitrate) || (stream->window_index == 0
+          && new_bitrate > 0)) {
+    stream->window_bitrates[stream->window_index % BANDWIDTH_WINDOW_SIZE] =
+        new_bitrate;
+    stream->window_index++;
+  }
+
+  n = MIN (stream->window_index, BANDWIDTH_WINDOW_SIZE);
+  if (n == 0)
+    return new_bitrate;
+
+  /* The harmonic mean is dominated by the low rates, so drops are taken into
+   * account quickly while a few fast downloads don't matter much */
+  for (i = 0; i < n; i++)
+    sum += 1.0 / stream->window_bitrates[i];
+
+  return (guint64) (n / sum);
+}
+
+static gdouble
+_ewma_update (gdouble estimate, gdouble half_life, gdouble weight,
+    gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / half_life);
+
+  return alpha * estimate + (1.0 - alpha) * value;
+}
+
+/* must be called with manifest_lock taken */
+static guint64
+_update_ewma_bitrate (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+{
+  gdouble weight, fast, slow;
+
+  if (_is_bandwidth_sample (stream, new_bitrate)
+      && GST_CLOCK_TIME_IS_VALID (stream->last_download_time)
+      && stream->last_download_time > 0) {
+    /* Weight by download time, so that long downloads count more */
+    weight = (gdouble) stream->last_download_time / GST_SECOND;
+
+    stream->ewma_fast = _ewma_update (stream->ewma_fast, EWMA_FAST_HALF_LIFE,
+        weight, new_bitrate);
+    stream->ewma_slow = _ewma_update (stream->ewma_slow, EWMA_SLOW_HALF_LIFE,
+        weight, new_bitrate);
+    stream->ewma_weight += weight;
+  }
+
+  if (stream->ewma_weight == 0)
+    return new_bitrate;
+
+  /* Both averages start from 0, correct for that bias */
+  fast = stream->ewma_fast / (1.0 - pow (0.5,
+          stream->ewma_weight / EWMA_FAST_HALF_LIFE));
+  slow = stream->ewma_slow / (1.0 - pow (0.5,
+          stream->ewma_weight / EWMA_SLOW_HALF_LIFE));
+
+  /* the fast average goes down quickly on drops, the slow one keeps it from
+   * going up too fast */
+  return (guint64) MIN (fast, slow);
+}
+
 /* must be called with manifest_lock taken */
 static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
@@ -2246,16 +2449,34 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
   GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
       fragment_bitrate);
 
-  average_bitrate = _update_average_bitrate (demux, stream, fragment_bitrate);
+  switch (demux->bandwidth_estimator) {
+    case GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC:
+      stream->current_download_rate =
+          _update_harmonic_bitrate (demux, stream, fragment_bitrate);
+      GST_INFO_OBJECT (stream, "Harmonic mean bitrate is %" G_GUINT64_FORMAT,
+          stream->current_download_rate);
+      break;
+    case GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_EWMA:
+      stream->current_download_rate =
+          _update_ewma_bitrate (demux, stream, fragment_bitrate);
+      GST_INFO_OBJECT (stream, "EWMA bitrate is %" G_GUINT64_FORMAT,
+          stream->current_download_rate);
+      break;
+    case GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_AVERAGE:
+    default:
+      average_bitrate =
+          _update_average_bitrate (demux, stream, fragment_bitrate);
 
-  GST_INFO_OBJECT (stream, "last fragment bitrate was %" G_GUINT64_FORMAT,
-      fragment_bitrate);
-  GST_INFO_OBJECT (stream,
-      "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
-      NUM_LOOKBACK_FRAGMENTS, average_bitrate);
+      GST_INFO_OBJECT (stream, "last fragment bitrate was %" G_GUINT64_FORMAT,
+          fragment_bitrate);
+      GST_INFO_OBJECT (stream,
+          "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
+          NUM_LOOKBACK_FRAGMENTS, average_bitrate);
 
-  /* Conservative approach, make sure we don't upgrade too fast */
-  stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+      /* Conservative approach, make sure we don't upgrade too fast */
+      stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+      break;
+  }
 
   stream->current_download_rate *= demux->bitrate_limit;
   GST_DEBUG_OBJECT (demux, "Bitrate after bitrate limit (%0.2f): %"
@@ -3323,6 +3544,309 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+static void
+gst_adaptive_demux_prefetch_free (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  gst_object_unref (prefetch->downloader);
+  g_free (prefetch->uri);
+  if (prefetch->download)
+    g_object_unref (prefetch->download);
+  g_clear_error (&prefetch->error);
+  g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+}
+
+static void
+gst_adaptive_demux_prefetch_func (gpointer data, gpointer user_data)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = data;
+  GstAdaptiveDemuxStream *stream = prefetch->stream;
+  GstFragment *download;
+  GError *err = NULL;
+  gboolean dropped;
+
+  GST_DEBUG_OBJECT (stream->pad, "Prefetching %s range:%" G_GINT64_FORMAT
+      " - %" G_GINT64_FORMAT, prefetch->uri, prefetch->range_start,
+      prefetch->range_end);
+
+  download = gst_uri_downloader_fetch_uri_with_range (prefetch->downloader,
+      prefetch->uri, NULL, FALSE, FALSE, TRUE, prefetch->range_start,
+      prefetch->range_end, &err);
+
+  g_mutex_lock (&stream->prefetch_lock);
+  prefetch->download = download;
+  prefetch->error = err;
+  prefetch->done = TRUE;
+  stream->prefetch_running--;
+  dropped = prefetch->dropped;
+  g_cond_broadcast (&stream->prefetch_cond);
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  /* the stream might be gone already, don't touch it anymore */
+  if (dropped)
+    gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+/* Aborts all running prefetches, which then finish with an error */
+static void
+gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GList *iter;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  for (iter = stream->prefetch_queue.head; iter; iter = iter->next) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+
+    if (!prefetch->done)
+      gst_uri_downloader_cancel (prefetch->downloader);
+  }
+  if (stream->prefetch_current) {
+    GstAdaptiveDemuxPrefetch *prefetch = stream->prefetch_current;
+
+    if (!prefetch->done)
+      gst_uri_downloader_cancel (prefetch->downloader);
+  }
+  g_cond_broadcast (&stream->prefetch_cond);
+  g_mutex_unlock (&stream->prefetch_lock);
+}
+
+/* Drops all queued prefetches but the first @keep ones. Running ones are
+ * cancelled and freed by their thread once it notices, so that this never
+ * waits for a download while the manifest_lock is held */
+static void
+gst_adaptive_demux_stream_flush_prefetch (GstAdaptiveDemuxStream * stream,
+    guint keep)
+{
+  GList *finished = NULL;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  while (stream->prefetch_queue.length > keep) {
+    GstAdaptiveDemuxPrefetch *prefetch =
+        g_queue_pop_tail (&stream->prefetch_queue);
+
+    if (prefetch->done) {
+      finished = g_list_prepend (finished, prefetch);
+    } else {
+      gst_uri_downloader_cancel (prefetch->downloader);
+      prefetch->dropped = TRUE;
+    }
+  }
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  g_list_free_full (finished,
+      (GDestroyNotify) gst_adaptive_demux_prefetch_free);
+}
+
+/* Drops all prefetches of @stream and waits until none of them is running
+ * anymore, so that the stream can be freed */
+static void
+gst_adaptive_demux_stream_stop_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  gst_adaptive_demux_stream_cancel_prefetch (stream);
+  gst_adaptive_demux_stream_flush_prefetch (stream, 0);
+
+  g_mutex_lock (&stream->prefetch_lock);
+  while (stream->prefetch_running > 0)
+    g_cond_wait (&stream->prefetch_cond, &stream->prefetch_lock);
+  g_mutex_unlock (&stream->prefetch_lock);
+}
+
+/* must be called with manifest_lock taken.
+ * Starts downloading the upcoming fragments that are not being downloaded
+ * yet, dropping prefetches that don't match them anymore (e.g. after a
+ * bitrate switch) */
+static void
+gst_adaptive_demux_stream_update_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  guint n_prefetch = demux->prefetch_fragments;
+  guint i;
+
+  if (!klass->stream_peek_fragment || n_prefetch == 0) {
+    gst_adaptive_demux_stream_flush_prefetch (stream, 0);
+    return;
+  }
+
+  if (demux->priv->prefetch_pool == NULL) {
+    GError *err = NULL;
+
+    demux->priv->prefetch_pool =
+        g_thread_pool_new (gst_adaptive_demux_prefetch_func, demux, -1, FALSE,
+        &err);
+    if (demux->priv->prefetch_pool == NULL) {
+      GST_WARNING_OBJECT (demux, "Could not create prefetch threads: %s",
+          err->message);
+      g_clear_error (&err);
+      return;
+    }
+  }
+
+  for (i = 0; i < n_prefetch; i++) {
+    GstAdaptiveDemuxPrefetch *prefetch;
+    gchar *uri = NULL;
+    gint64 range_start = 0, range_end = -1;
+
+    if (!klass->stream_peek_fragment (stream, i + 1, &uri, &range_start,
+            &range_end))
+      break;
+
+    g_mutex_lock (&stream->prefetch_lock);
+    prefetch = g_queue_peek_nth (&stream->prefetch_queue, i);
+    if (prefetch && prefetch->range_start == range_start
+        && prefetch->range_end == range_end
+        && g_strcmp0 (prefetch->uri, uri) == 0) {
+      g_mutex_unlock (&stream->prefetch_lock);
+      g_free (uri);
+      continue;
+    }
+    g_mutex_unlock (&stream->prefetch_lock);
+
+    gst_adaptive_demux_stream_flush_prefetch (stream, i);
+
+    prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+    prefetch->stream = stream;
+    prefetch->downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (prefetch->downloader, GST_ELEMENT (demux));
+    prefetch->uri = uri;
+    prefetch->range_start = range_start;
+    prefetch->range_end = range_end;
+
+    g_mutex_lock (&stream->prefetch_lock);
+    g_queue_push_tail (&stream->prefetch_queue, prefetch);
+    stream->prefetch_running++;
+    g_mutex_unlock (&stream->prefetch_lock);
+
+    g_thread_pool_push (demux->priv->prefetch_pool, prefetch, NULL);
+  }
+
+  gst_adaptive_demux_stream_flush_prefetch (stream, i);
+}
+
+/* must be called with manifest_lock taken.
+ * Takes the prefetch of the current fragment, if its download was started
+ * earlier */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_stream_take_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  prefetch = g_queue_peek_head (&stream->prefetch_queue);
+  if (prefetch && stream->internal_pad
+      && prefetch->range_start == stream->fragment.range_start
+      && prefetch->range_end == stream->fragment.range_end
+      && g_strcmp0 (prefetch->uri, stream->fragment.uri) == 0) {
+    g_queue_pop_head (&stream->prefetch_queue);
+    stream->prefetch_current = prefetch;
+  } else {
+    prefetch = NULL;
+  }
+  g_mutex_unlock (&stream->prefetch_lock);
+
+  /* we went somewhere else, none of the prefetches are useful anymore */
+  if (prefetch == NULL)
+    gst_adaptive_demux_stream_flush_prefetch (stream, 0);
+
+  return prefetch;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock.
+ * Waits for @prefetch and passes its data on like the source element would
+ * have. Returns GST_FLOW_CUSTOM_ERROR if the download failed, in which case
+ * the fragment should be downloaded normally */
+static GstFlowReturn
+gst_adaptive_demux_stream_push_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GstFlowReturn ret;
+  GstBuffer *buffer = NULL;
+  GstClockTime download_time = 0;
+  gsize size;
+
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (&stream->prefetch_lock);
+  while (!prefetch->done)
+    g_cond_wait (&stream->prefetch_cond, &stream->prefetch_lock);
+  stream->prefetch_current = NULL;
+  g_mutex_unlock (&stream->prefetch_lock);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_adaptive_demux_prefetch_free (prefetch);
+    return stream->last_ret = GST_FLOW_FLUSHING;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (prefetch->download)
+    buffer = gst_fragment_get_buffer (prefetch->download);
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetch of %s failed: %s", prefetch->uri,
+        prefetch->error ? prefetch->error->message : "no data");
+    gst_adaptive_demux_prefetch_free (prefetch);
+    return GST_FLOW_CUSTOM_ERROR;
+  }
+
+  size = gst_buffer_get_size (buffer);
+  if (prefetch->download->download_stop_time >
+      prefetch->download->download_start_time)
+    download_time = prefetch->download->download_stop_time -
+        prefetch->download->download_start_time;
+  gst_adaptive_demux_prefetch_free (prefetch);
+
+  GST_DEBUG_OBJECT (stream->pad, "Using prefetched fragment %s of size %"
+      G_GSIZE_FORMAT " downloaded in %" GST_TIME_FORMAT, stream->fragment.uri,
+      size, GST_TIME_ARGS (download_time));
+
+  /* Do what _uri_handler_probe() does for downloads through the source. The
+   * bitrate is the one of this connection only */
+  stream->download_start_time =
+      GST_TIME_AS_USECONDS (gst_adaptive_demux_get_monotonic_time (demux) -
+      download_time);
+  stream->fragment_bytes_downloaded = size;
+  stream->last_latency = 0;
+  stream->last_download_time = download_time;
+  stream->last_bitrate = download_time ?
+      gst_util_uint64_scale (size, 8 * GST_SECOND, download_time) : 0;
+
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0)
+    stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+            8 * GST_SECOND, stream->fragment.duration));
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  /* Go through our pad like the source element would, without holding the
+   * manifest_lock as _src_chain() and _src_event() take it */
+  GST_MANIFEST_UNLOCK (demux);
+  ret = gst_pad_chain (stream->internal_pad, buffer);
+  if (ret == GST_FLOW_OK)
+    gst_pad_send_event (stream->internal_pad, gst_event_new_eos ());
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    return stream->last_ret = GST_FLOW_FLUSHING;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  /* clear the EOS for the next fragment, as after a download through the
+   * source element */
+  gst_pad_set_active (stream->internal_pad, FALSE);
+  gst_pad_set_active (stream->internal_pad, TRUE);
+
+  if (ret != GST_FLOW_OK && stream->last_ret == GST_FLOW_OK)
+    stream->last_ret = ret;
+
+  return stream->last_ret;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3441,9 +3965,23 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    GstAdaptiveDemuxPrefetch *prefetch;
+
+    /* Start downloading the next fragments while waiting for this one */
+    prefetch = gst_adaptive_demux_stream_take_prefetch (demux, stream);
+    gst_adaptive_demux_stream_update_prefetch (demux, stream);
+
+    ret = GST_FLOW_CUSTOM_ERROR;
+    if (prefetch)
+      ret = gst_adaptive_demux_stream_push_prefetch (demux, stream, prefetch);
+
+    if (ret == GST_FLOW_CUSTOM_ERROR) {
+      stream->last_ret = GST_FLOW_OK;
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
@@ -4165,6 +4703,8 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
 {
   GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret;
+  GstClockTime fragment_stop_time;
+  guint64 bitrate;
 
   g_return_val_if_fail (klass->stream_advance_fragment != NULL, GST_FLOW_ERROR);
 
@@ -4175,21 +4715,7 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
   stream->download_error_count = 0;
   g_clear_error (&stream->last_error);
 
-  /* FIXME - url has no indication of byte ranges for subsegments */
-  /* FIXME : All those time statistics are biased, since they are calculated
-   * *AFTER* the queue2, which might be blocking. They should ideally be
-   * calculated *before* queue2 in the uri_handler_probe */
-  gst_element_post_message (GST_ELEMENT_CAST (demux),
-      gst_message_new_element (GST_OBJECT_CAST (demux),
-          gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
-              "manifest-uri", G_TYPE_STRING,
-              demux->manifest_uri, "uri", G_TYPE_STRING,
-              stream->fragment.uri, "fragment-start-time",
-              GST_TYPE_CLOCK_TIME, stream->download_start_time,
-              "fragment-stop-time", GST_TYPE_CLOCK_TIME,
-              gst_util_get_timestamp (), "fragment-size", G_TYPE_UINT64,
-              stream->download_total_bytes, "fragment-download-time",
-              GST_TYPE_CLOCK_TIME, stream->last_download_time, NULL)));
+  fragment_stop_time = gst_util_get_timestamp ();
 
   /* Don't update to the end of the segment if in reverse playback */
   GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
@@ -4225,12 +4751,38 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
     ret = GST_FLOW_EOS;
   }
 
+  /* Only fragments that were fully downloaded tell about the bandwidth, the
+   * last estimate is reported otherwise */
+  if (ret == GST_FLOW_OK)
+    bitrate = gst_adaptive_demux_stream_update_current_bitrate (demux, stream);
+  else
+    bitrate = stream->current_download_rate;
+
+  /* FIXME - url has no indication of byte ranges for subsegments */
+  /* FIXME : All those time statistics are biased, since they are calculated
+   * *AFTER* the queue2, which might be blocking. They should ideally be
+   * calculated *before* queue2 in the uri_handler_probe */
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_element (GST_OBJECT_CAST (demux),
+          gst_structure_new (GST_ADAPTIVE_DEMUX_STATISTICS_MESSAGE_NAME,
+              "manifest-uri", G_TYPE_STRING,
+              demux->manifest_uri, "uri", G_TYPE_STRING,
+              stream->fragment.uri, "fragment-start-time",
+              GST_TYPE_CLOCK_TIME, stream->download_start_time,
+              "fragment-stop-time", GST_TYPE_CLOCK_TIME,
+              fragment_stop_time, "fragment-size", G_TYPE_UINT64,
+              stream->download_total_bytes, "fragment-download-time",
+              GST_TYPE_CLOCK_TIME, stream->last_download_time,
+              "fragment-bitrate", G_TYPE_UINT64, stream->last_bitrate,
+              "bandwidth-estimate", G_TYPE_UINT64, bitrate,
+              "bandwidth-estimator", GST_TYPE_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR,
+              demux->bandwidth_estimator, NULL)));
+
   stream->download_start_time =
       GST_TIME_AS_USECONDS (gst_adaptive_demux_get_monotonic_time (demux));
 
   if (ret == GST_FLOW_OK) {
-    if (gst_adaptive_demux_stream_select_bitrate (demux, stream,
-            gst_adaptive_demux_stream_update_current_bitrate (demux, stream))) {
+    if (gst_adaptive_demux_stream_select_bitrate (demux, stream, bitrate)) {
       stream->need_header = TRUE;
       ret = (GstFlowReturn) GST_ADAPTIVE_DEMUX_FLOW_SWITCH;
     }
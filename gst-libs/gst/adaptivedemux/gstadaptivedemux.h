@@ -84,6 +84,29 @@ G_BEGIN_DECLS
   g_clear_error (&err); \
 } G_STMT_END
 
+/**
+ * GstAdaptiveDemuxBandwidthEstimator:
+ * @GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_AVERAGE: average download rate of
+ *     the last fragments, capped by the rate of the last one
+ * @GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC: harmonic mean of the
+ *     download rates over a sliding window of fragments
+ * @GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_EWMA: the lower of a fast and a
+ *     slow exponentially weighted moving average, weighted by download time
+ *
+ * How the available bandwidth is estimated from fragment downloads.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_AVERAGE,
+  GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC,
+  GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_EWMA
+} GstAdaptiveDemuxBandwidthEstimator;
+
+#define GST_TYPE_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR \
+  (gst_adaptive_demux_bandwidth_estimator_get_type())
+
 /* DEPRECATED */
 #define GST_ADAPTIVE_DEMUX_FLOW_END_OF_FRAGMENT GST_FLOW_CUSTOM_SUCCESS_1
 
@@ -184,6 +207,13 @@ struct _GstAdaptiveDemuxStream
   guint moving_index;
   guint64 *fragment_bitrates;
 
+  /* State of the other bandwidth estimators */
+  guint64 *window_bitrates;
+  guint window_index;
+  gdouble ewma_fast;
+  gdouble ewma_slow;
+  gdouble ewma_weight;
+
   /* QoS data */
   GstClockTime qos_earliest_time;
 
@@ -195,6 +225,14 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* upcoming fragments downloaded ahead of time, see
+   * GstAdaptiveDemux:prefetch-fragments */
+  GMutex prefetch_lock;
+  GCond prefetch_cond;
+  GQueue prefetch_queue;        /* protected by prefetch_lock */
+  gpointer prefetch_current;    /* protected by prefetch_lock */
+  guint prefetch_running;       /* protected by prefetch_lock */
 };
 
 /**
@@ -228,6 +266,8 @@ struct _GstAdaptiveDemux
   /* Properties */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;
+  guint prefetch_fragments;
+  GstAdaptiveDemuxBandwidthEstimator bandwidth_estimator;
 
   gboolean have_group_id;
   guint group_id;
@@ -482,11 +522,31 @@ struct _GstAdaptiveDemuxClass
    * Return: %TRUE if the playlist needs to be refreshed periodically by the demuxer.
    */
   gboolean (*requires_periodical_playlist_update) (GstAdaptiveDemux * demux);
+
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @n: which fragment after the current one to look at, starting at 1
+   * @uri: (out): the URI of that fragment
+   * @range_start: (out): the start of its byte range
+   * @range_end: (out): the inclusive end of its byte range, or -1
+   *
+   * Optional. Gets the location of an upcoming fragment without changing
+   * the state of the stream, so that it can be downloaded ahead of time.
+   *
+   * Return: %TRUE if the fragment is known
+   *
+   * Since: 1.16
+   */
+  gboolean (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint n, gchar ** uri, gint64 * range_start, gint64 * range_end);
 };
 
 GST_ADAPTIVE_DEMUX_API
 GType    gst_adaptive_demux_get_type (void);
 
+GST_ADAPTIVE_DEMUX_API
+GType    gst_adaptive_demux_bandwidth_estimator_get_type (void);
+
 GST_ADAPTIVE_DEMUX_API
 void     gst_adaptive_demux_set_stream_struct_size (GstAdaptiveDemux * demux,
                                                     gsize struct_size);
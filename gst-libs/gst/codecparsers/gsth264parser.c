@@ -2041,22 +2041,9 @@ gst_h264_pps_clear (GstH264PPS * pps)
   pps->slice_group_id = NULL;
 }
 
-/**
- * gst_h264_parser_parse_slice_hdr:
- * @nalparser: a #GstH264NalParser
- * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
- * @slice: The #GstH264SliceHdr to fill.
- * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
- * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
- *
- * Parses @nalu containing a coded slice, and fills @slice.
- *
- * Returns: a #GstH264ParserResult
- */
-GstH264ParserResult
-gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
-    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
-    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+static GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_internal (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice, gboolean light)
 {
   NalReader nr;
   gint pps_id;
@@ -2124,6 +2111,11 @@ gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
   else
     slice->max_pic_num = sps->max_frame_num;
 
+  /* the rest of the header is about picture order counts, reference lists
+   * and weights, which only decoders need */
+  if (light)
+    return GST_H264_PARSER_OK;
+
   if (nalu->idr_pic_flag)
     READ_UE_MAX (&nr, slice->idr_pic_id, G_MAXUINT16);
 
@@ -2220,6 +2212,53 @@ error:
   return GST_H264_PARSER_ERROR;
 }
 
+/**
+ * gst_h264_parser_parse_slice_hdr:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
+ * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
+ *
+ * Parses @nalu containing a coded slice, and fills @slice.
+ *
+ * Returns: a #GstH264ParserResult
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
+    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      FALSE);
+}
+
+/**
+ * gst_h264_parser_parse_slice_hdr_light:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ *
+ * Parses the start of the slice header of @nalu, up to and including
+ * field_pic_flag and bottom_field_flag, and fills those fields of @slice.
+ * The later fields are not parsed and keep their default values,
+ * header_size is 0.
+ *
+ * This is much cheaper than gst_h264_parser_parse_slice_hdr() and enough to
+ * find the picture boundaries and the slice type.
+ *
+ * Returns: a #GstH264ParserResult
+ *
+ * Since: 1.16
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_light (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      TRUE);
+}
+
 /* Free MVC-specific data from subset SPS header */
 static void
 gst_h264_sps_mvc_clear (GstH264SPS * sps)
@@ -1055,6 +1055,10 @@ GstH264ParserResult gst_h264_parser_parse_slice_hdr   (GstH264NalParser *nalpars
                                                        GstH264SliceHdr *slice, gboolean parse_pred_weight_table,
                                                        gboolean parse_dec_ref_pic_marking);
 
+GST_CODEC_PARSERS_API
+GstH264ParserResult gst_h264_parser_parse_slice_hdr_light (GstH264NalParser *nalparser, GstH264NalUnit *nalu,
+                                                           GstH264SliceHdr *slice);
+
 GST_CODEC_PARSERS_API
 GstH264ParserResult gst_h264_parser_parse_subset_sps  (GstH264NalParser *nalparser, GstH264NalUnit *nalu,
                                                        GstH264SPS *sps, gboolean parse_vui_params);
@@ -1886,21 +1886,9 @@ gst_h265_parser_parse_pps (GstH265Parser * parser,
   return res;
 }
 
-/**
- * gst_h265_parser_parse_slice_hdr:
- * @parser: a #GstH265Parser
- * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
- * @slice: The #GstH265SliceHdr to fill.
- *
- * Parses @data, and fills the @slice structure.
- * The resulting @slice_hdr structure shall be deallocated with
- * gst_h265_slice_hdr_free() when it is no longer needed
- *
- * Returns: a #GstH265ParserResult
- */
-GstH265ParserResult
-gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
-    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+static GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_internal (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice, gboolean light)
 {
   NalReader nr;
   gint pps_id;
@@ -1971,8 +1959,14 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     for (i = 0; i < pps->num_extra_slice_header_bits; i++)
       nal_reader_skip (&nr, 1);
     READ_UE_MAX (&nr, slice->type, 63);
+  }
 
+  /* the rest of the header is about picture order counts, reference picture
+   * sets and the decoding tools, which only decoders need */
+  if (light)
+    return GST_H265_PARSER_OK;
 
+  if (!slice->dependent_slice_segment_flag) {
     if (pps->output_flag_present_flag)
       READ_UINT8 (&nr, slice->pic_output_flag, 1);
     if (sps->separate_colour_plane_flag == 1)
@@ -2185,6 +2179,50 @@ error:
   return GST_H265_PARSER_ERROR;
 }
 
+/**
+ * gst_h265_parser_parse_slice_hdr:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses @data, and fills the @slice structure.
+ * The resulting @slice_hdr structure shall be deallocated with
+ * gst_h265_slice_hdr_free() when it is no longer needed
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, FALSE);
+}
+
+/**
+ * gst_h265_parser_parse_slice_hdr_light:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses the start of the slice header of @nalu, up to and including
+ * slice_type, and fills those fields of @slice. The later fields are not
+ * parsed and keep their default values, header_size is 0. Nothing is
+ * allocated, so @slice does not need gst_h265_slice_hdr_free().
+ *
+ * This is much cheaper than gst_h265_parser_parse_slice_hdr() and enough to
+ * find the picture boundaries and the slice type.
+ *
+ * Returns: a #GstH265ParserResult
+ *
+ * Since: 1.16
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_light (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, TRUE);
+}
+
 static gboolean
 nal_reader_has_more_data_in_payload (NalReader * nr,
     guint32 payload_start_pos_bit, guint32 payloadSize)
@@ -61,6 +61,61 @@ ceil_log2 (guint32 v)
   return r + 1;
 }
 
+/* Number of bytes looked at for the next emulation_prevention_three_byte at
+ * once. Parsers mostly read a few header bytes out of large NALs, so the
+ * rest of them is never scanned */
+#define NAL_EPB_SCAN_WINDOW 64
+
+/* Non-zero if one of the 8 bytes of @v is zero */
+#define HAS_ZERO_BYTE(v) (((v) - G_GUINT64_CONSTANT (0x0101010101010101)) & \
+    ~(v) & G_GUINT64_CONSTANT (0x8080808080808080))
+
+/* Returns the position of the first emulation_prevention_three_byte in
+ * @data whose leading 0x0000 starts at @pos or later, if it is within
+ * NAL_EPB_SCAN_WINDOW bytes. Otherwise returns the position scanning stopped
+ * at, which is @size at the end of the data.
+ *
+ * Most of the bitstream has no zero bytes at all: it is skipped a word at a
+ * time, and otherwise by 3 bytes whenever a byte bigger than 3 rules out any
+ * 0x000003 ending on it or on the next two bytes. */
+static guint
+nal_find_epb (const guint8 * data, guint pos, guint size)
+{
+  guint i = pos + 2, end, limit;
+  guint64 word;
+
+  limit = MIN (size, pos + NAL_EPB_SCAN_WINDOW);
+  while (i < limit) {
+    /* any 0x000003 ending in [i, i + 8) starts in [i - 2, i + 6) */
+    if (i + 6 <= size) {
+      memcpy (&word, data + i - 2, sizeof (word));
+      if (!HAS_ZERO_BYTE (word)) {
+        i += 8;
+        continue;
+      }
+    }
+
+    end = MIN (i + 8, limit);
+    while (i < end) {
+      if (data[i] > 0x03)
+        i += 3;
+      else if (data[i] == 0x03 && data[i - 1] == 0x00 && data[i - 2] == 0x00)
+        return i;
+      else
+        i++;
+    }
+  }
+
+  return limit;
+}
+
+static inline gboolean
+nal_is_epb (const guint8 * data, guint pos)
+{
+  return pos >= 2 && data[pos] == 0x03 && data[pos - 1] == 0x00
+      && data[pos - 2] == 0x00;
+}
+
 /****** Nal parser ******/
 
 void
@@ -69,6 +124,7 @@ nal_reader_init (NalReader * nr, const guint8 * data, guint size)
   nr->data = data;
   nr->size = size;
   nr->n_epb = 0;
+  nr->epb_pos = nal_find_epb (data, 0, size);
 
   nr->byte = 0;
   nr->bits_in_cache = 0;
@@ -88,23 +144,25 @@ nal_reader_read (NalReader * nr, guint nbits)
 
   while (nr->bits_in_cache < nbits) {
     guint8 byte;
-    gboolean check_three_byte;
 
-    check_three_byte = TRUE;
-  next_byte:
     if (G_UNLIKELY (nr->byte >= nr->size))
       return FALSE;
 
-    byte = nr->data[nr->byte++];
-
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
-      nr->n_epb++;
-      goto next_byte;
+    if (G_UNLIKELY (nr->byte == nr->epb_pos)) {
+      /* skip the emulation_prevention_three_byte and look for the next one,
+       * the bytes after it start a new 0x0000 run */
+      if (nal_is_epb (nr->data, nr->byte)) {
+        nr->n_epb++;
+        nr->byte++;
+        nr->epb_pos = nal_find_epb (nr->data, nr->byte, nr->size);
+        continue;
+      }
+
+      /* end of the scanned window, go on including a 0x0000 ending it */
+      nr->epb_pos = nal_find_epb (nr->data, nr->byte - 2, nr->size);
     }
+
+    byte = nr->data[nr->byte++];
     nr->cache = (nr->cache << 8) | nr->first_byte;
     nr->first_byte = byte;
     nr->bits_in_cache += 8;
@@ -300,10 +358,30 @@ nal_reader_has_more_data (NalReader * nr)
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  guint i = 0, end;
+  guint64 word;
 
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  while (i + 4 <= size) {
+    /* any start code starting in [i, i + 8) has a zero byte in there */
+    if (i + 8 <= size) {
+      memcpy (&word, data + i, sizeof (word));
+      if (!HAS_ZERO_BYTE (word)) {
+        i += 8;
+        continue;
+      }
+    }
+
+    end = MIN (i + 8, size - 3);
+    while (i < end) {
+      if (data[i + 2] > 0x01)
+        i += 3;
+      else if (data[i + 2] == 0x01 && data[i + 1] == 0x00 && data[i] == 0x00)
+        return i;
+      else
+        i++;
+    }
+  }
+
+  return -1;
 }
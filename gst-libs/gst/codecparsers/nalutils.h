@@ -47,6 +47,8 @@ typedef struct
   guint size;
 
   guint n_epb;                  /* Number of emulation prevention bytes */
+  guint epb_pos;                /* Byte position of the next one, or up
+                                 * to where there is none */
   guint byte;                   /* Byte position */
   guint bits_in_cache;          /* bitpos in the cache of next bit */
   guint8 first_byte;
@@ -348,6 +348,15 @@ struct _GstVideoAggregatorConvertPadPrivate
 
   GstStructure *converter_config;
   gboolean converter_config_changed;
+  /* converter-config was set, the converter has to be recreated */
+  gboolean converter_config_updated;
+  /* Number of threads given to the converter if converter-config doesn't
+   * set it, 0 otherwise */
+  guint n_threads;
+
+  /* Mapped frames of a conversion queued by prepare_frame() */
+  GstVideoFrame input_frame;
+  GstVideoFrame converted_frame;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GstVideoAggregatorConvertPad,
@@ -369,6 +378,41 @@ gst_video_aggregator_convert_pad_finalize (GObject * o)
   G_OBJECT_CLASS (gst_video_aggregator_pad_parent_class)->finalize (o);
 }
 
+static void gst_video_aggregator_queue_conversion (GstVideoAggregator * vagg,
+    GstVideoAggregatorConvertPad * pad);
+static gboolean gst_video_aggregator_convert_pad_prepare_frame
+    (GstVideoAggregatorPad * vpad, GstVideoAggregator * vagg,
+    GstBuffer * buffer, GstVideoFrame * prepared_frame);
+
+/* All pads are converted at once, share the cores between them */
+static guint
+gst_video_aggregator_get_convert_n_threads (GstVideoAggregator * vagg)
+{
+  guint n_threads;
+
+  GST_OBJECT_LOCK (vagg);
+  n_threads = g_get_num_processors () /
+      MAX (GST_ELEMENT_CAST (vagg)->numsinkpads, 1);
+  GST_OBJECT_UNLOCK (vagg);
+
+  return MAX (n_threads, 1);
+}
+
+/* Subclasses overriding prepare_frame() may expect the frame to be converted
+ * when chaining up returns, so only defer the conversion if they said they
+ * don't */
+static gboolean
+gst_video_aggregator_convert_pad_converts_concurrently
+    (GstVideoAggregatorConvertPad * pad)
+{
+  GstVideoAggregatorConvertPadClass *klass =
+      GST_VIDEO_AGGREGATOR_CONVERT_PAD_GET_CLASS (pad);
+
+  return klass->convert_concurrently ||
+      GST_VIDEO_AGGREGATOR_PAD_CLASS (klass)->prepare_frame ==
+      gst_video_aggregator_convert_pad_prepare_frame;
+}
+
 static void
     gst_video_aggregator_convert_pad_update_conversion_info_internal
     (GstVideoAggregatorPad * vpad)
@@ -385,6 +429,7 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
 {
   GstVideoAggregatorConvertPad *pad = GST_VIDEO_AGGREGATOR_CONVERT_PAD (vpad);
   GstVideoFrame frame;
+  gboolean recreate = FALSE;
 
   /* Update/create converter as needed */
   if (pad->priv->converter_config_changed) {
@@ -402,27 +447,58 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
         || !gst_video_info_is_equal (&conversion_info,
             &pad->priv->conversion_info)) {
       pad->priv->conversion_info = conversion_info;
+      recreate = TRUE;
+    }
+  }
 
-      if (pad->priv->convert)
-        gst_video_converter_free (pad->priv->convert);
-      pad->priv->convert = NULL;
-
-      if (!gst_video_info_is_equal (&vpad->info, &pad->priv->conversion_info)) {
-        pad->priv->convert =
-            gst_video_converter_new (&vpad->info, &pad->priv->conversion_info,
-            pad->priv->converter_config ? gst_structure_copy (pad->
-                priv->converter_config) : NULL);
-        if (!pad->priv->convert) {
-          GST_WARNING_OBJECT (pad, "No path found for conversion");
-          return FALSE;
-        }
+  GST_OBJECT_LOCK (pad);
+  if (pad->priv->converter_config_updated) {
+    pad->priv->converter_config_updated = FALSE;
+    recreate = TRUE;
+  }
+  GST_OBJECT_UNLOCK (pad);
 
-        GST_DEBUG_OBJECT (pad, "This pad will be converted from %d to %d",
-            GST_VIDEO_INFO_FORMAT (&vpad->info),
-            GST_VIDEO_INFO_FORMAT (&pad->priv->conversion_info));
-      } else {
-        GST_DEBUG_OBJECT (pad, "This pad will not need conversion");
+  /* The number of threads depends on the number of pads, follow it */
+  if (pad->priv->convert && pad->priv->n_threads != 0 &&
+      pad->priv->n_threads != gst_video_aggregator_get_convert_n_threads (vagg))
+    recreate = TRUE;
+
+  if (recreate) {
+    if (pad->priv->convert)
+      gst_video_converter_free (pad->priv->convert);
+    pad->priv->convert = NULL;
+    pad->priv->n_threads = 0;
+
+    if (!gst_video_info_is_equal (&vpad->info, &pad->priv->conversion_info)) {
+      GstStructure *config;
+
+      GST_OBJECT_LOCK (pad);
+      config = pad->priv->converter_config ?
+          gst_structure_copy (pad->priv->converter_config) :
+          gst_structure_new_empty ("GstVideoConverter");
+      GST_OBJECT_UNLOCK (pad);
+
+      if (!gst_structure_has_field (config, GST_VIDEO_CONVERTER_OPT_THREADS)) {
+        pad->priv->n_threads =
+            gst_video_aggregator_get_convert_n_threads (vagg);
+        gst_structure_set (config, GST_VIDEO_CONVERTER_OPT_THREADS,
+            G_TYPE_UINT, pad->priv->n_threads, NULL);
       }
+
+      pad->priv->convert =
+          gst_video_converter_new (&vpad->info, &pad->priv->conversion_info,
+          config);
+      if (!pad->priv->convert) {
+        GST_WARNING_OBJECT (pad, "No path found for conversion");
+        return FALSE;
+      }
+
+      GST_DEBUG_OBJECT (pad, "This pad will be converted from %d to %d "
+          "with %u threads", GST_VIDEO_INFO_FORMAT (&vpad->info),
+          GST_VIDEO_INFO_FORMAT (&pad->priv->conversion_info),
+          pad->priv->n_threads);
+    } else {
+      GST_DEBUG_OBJECT (pad, "This pad will not need conversion");
     }
   }
 
@@ -452,9 +528,17 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
       return FALSE;
     }
 
-    gst_video_converter_frame (pad->priv->convert, &frame, &converted_frame);
     pad->priv->converted_buffer = converted_buf;
-    gst_video_frame_unmap (&frame);
+    if (gst_video_aggregator_convert_pad_converts_concurrently (pad)) {
+      /* The actual conversion runs together with the other pads' ones before
+       * aggregating */
+      pad->priv->input_frame = frame;
+      pad->priv->converted_frame = converted_frame;
+      gst_video_aggregator_queue_conversion (vagg, pad);
+    } else {
+      gst_video_converter_frame (pad->priv->convert, &frame, &converted_frame);
+      gst_video_frame_unmap (&frame);
+    }
     *prepared_frame = converted_frame;
   } else {
     *prepared_frame = frame;
@@ -469,6 +553,12 @@ gst_video_aggregator_convert_pad_clean_frame (GstVideoAggregatorPad * vpad,
 {
   GstVideoAggregatorConvertPad *pad = GST_VIDEO_AGGREGATOR_CONVERT_PAD (vpad);
 
+  if (pad->priv->input_frame.buffer) {
+    gst_video_frame_unmap (&pad->priv->input_frame);
+    memset (&pad->priv->input_frame, 0, sizeof (GstVideoFrame));
+  }
+  memset (&pad->priv->converted_frame, 0, sizeof (GstVideoFrame));
+
   if (prepared_frame->buffer) {
     gst_video_frame_unmap (prepared_frame);
     memset (prepared_frame, 0, sizeof (GstVideoFrame));
@@ -570,6 +660,7 @@ gst_video_aggregator_convert_pad_set_property (GObject * object, guint prop_id,
         gst_structure_free (pad->priv->converter_config);
       pad->priv->converter_config = g_value_dup_boxed (value);
       pad->priv->converter_config_changed = TRUE;
+      pad->priv->converter_config_updated = TRUE;
       GST_OBJECT_UNLOCK (pad);
       break;
     default:
@@ -621,6 +712,8 @@ gst_video_aggregator_convert_pad_init (GstVideoAggregatorConvertPad * vaggpad)
   vaggpad->priv->convert = NULL;
   vaggpad->priv->converter_config = NULL;
   vaggpad->priv->converter_config_changed = FALSE;
+  vaggpad->priv->converter_config_updated = FALSE;
+  vaggpad->priv->n_threads = 0;
 }
 
 
@@ -681,6 +774,13 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* Convert pads whose conversion is pending for the current frame */
+  GPtrArray *conversions;
+  GThreadPool *convert_pool;
+  GMutex convert_lock;
+  GCond convert_cond;
+  guint convert_pending;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1633,6 +1733,93 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
       vpad->priv->buffer, &vpad->priv->prepared_frame);
 }
 
+static void
+gst_video_aggregator_convert_pad_convert (GstVideoAggregatorConvertPad * pad)
+{
+  gst_video_converter_frame (pad->priv->convert, &pad->priv->input_frame,
+      &pad->priv->converted_frame);
+
+  gst_video_frame_unmap (&pad->priv->input_frame);
+  memset (&pad->priv->input_frame, 0, sizeof (GstVideoFrame));
+}
+
+static void
+gst_video_aggregator_queue_conversion (GstVideoAggregator * vagg,
+    GstVideoAggregatorConvertPad * pad)
+{
+  g_ptr_array_add (vagg->priv->conversions, gst_object_ref (pad));
+}
+
+static void
+gst_video_aggregator_convert_func (gpointer data, gpointer user_data)
+{
+  GstVideoAggregator *vagg = user_data;
+
+  gst_video_aggregator_convert_pad_convert (data);
+
+  g_mutex_lock (&vagg->priv->convert_lock);
+  if (--vagg->priv->convert_pending == 0)
+    g_cond_signal (&vagg->priv->convert_cond);
+  g_mutex_unlock (&vagg->priv->convert_lock);
+}
+
+/* Runs the conversions queued in prepare_frames(), concurrently if more than
+ * one pad needs converting */
+static void
+gst_video_aggregator_run_conversions (GstVideoAggregator * vagg)
+{
+  GPtrArray *conversions = vagg->priv->conversions;
+  guint i, n_threads;
+
+  if (conversions->len == 0)
+    return;
+
+  n_threads = MIN (conversions->len, g_get_num_processors ());
+
+  if (n_threads > 1 && vagg->priv->convert_pool == NULL) {
+    GError *err = NULL;
+
+    vagg->priv->convert_pool =
+        g_thread_pool_new (gst_video_aggregator_convert_func, vagg,
+        n_threads - 1, FALSE, &err);
+    if (vagg->priv->convert_pool == NULL) {
+      GST_WARNING_OBJECT (vagg, "Could not create conversion threads: %s",
+          err->message);
+      g_clear_error (&err);
+    }
+  } else if (n_threads > 1 &&
+      g_thread_pool_get_max_threads (vagg->priv->convert_pool) <
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (vagg->priv->convert_pool, n_threads - 1,
+        NULL);
+  }
+
+  if (n_threads > 1 && vagg->priv->convert_pool) {
+    GST_LOG_OBJECT (vagg, "Converting %u pads concurrently", conversions->len);
+
+    g_mutex_lock (&vagg->priv->convert_lock);
+    vagg->priv->convert_pending = conversions->len - 1;
+    for (i = 1; i < conversions->len; i++)
+      g_thread_pool_push (vagg->priv->convert_pool,
+          g_ptr_array_index (conversions, i), NULL);
+    g_mutex_unlock (&vagg->priv->convert_lock);
+
+    gst_video_aggregator_convert_pad_convert (g_ptr_array_index (conversions,
+            0));
+
+    g_mutex_lock (&vagg->priv->convert_lock);
+    while (vagg->priv->convert_pending > 0)
+      g_cond_wait (&vagg->priv->convert_cond, &vagg->priv->convert_lock);
+    g_mutex_unlock (&vagg->priv->convert_lock);
+  } else {
+    for (i = 0; i < conversions->len; i++)
+      gst_video_aggregator_convert_pad_convert (g_ptr_array_index (conversions,
+              i));
+  }
+
+  g_ptr_array_set_size (conversions, 0);
+}
+
 static gboolean
 clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
 {
@@ -1679,6 +1866,7 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
 
   /* Convert all the frames the subclass has before aggregating */
   gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  gst_video_aggregator_run_conversions (vagg);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2478,7 +2666,14 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->convert_pool)
+    g_thread_pool_free (vagg->priv->convert_pool, FALSE, TRUE);
+  vagg->priv->convert_pool = NULL;
+  g_ptr_array_unref (vagg->priv->conversions);
+
   g_mutex_clear (&vagg->priv->lock);
+  g_mutex_clear (&vagg->priv->convert_lock);
+  g_cond_clear (&vagg->priv->convert_cond);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
 }
@@ -2577,6 +2772,11 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
 
   g_mutex_init (&vagg->priv->lock);
 
+  vagg->priv->conversions =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gst_object_unref);
+  g_mutex_init (&vagg->priv->convert_lock);
+  g_cond_init (&vagg->priv->convert_cond);
+
   /* initialize variables */
   gst_video_aggregator_reset (vagg);
 }
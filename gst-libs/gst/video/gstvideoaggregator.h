@@ -150,6 +150,12 @@ struct _GstVideoAggregatorConvertPad
 
 /**
  * GstVideoAggregatorConvertPadClass:
+ * @convert_concurrently: If %TRUE, the frame set by prepare_frame() is
+ *     only converted right before aggregate_frames(), together with the
+ *     frames of the other pads. Subclasses overriding prepare_frame() must
+ *     then not access the pixels after chaining up. Otherwise the frames of
+ *     such subclasses are converted before prepare_frame() returns, which
+ *     prevents concurrent conversions. Since: 1.16
  *
  */
 struct _GstVideoAggregatorConvertPadClass
@@ -158,8 +164,10 @@ struct _GstVideoAggregatorConvertPadClass
 
   void (*create_conversion_info) (GstVideoAggregatorConvertPad *pad, GstVideoAggregator *agg, GstVideoInfo *conversion_info);
 
+  gboolean convert_concurrently;
+
   /*< private >*/
-  gpointer      _gst_reserved[GST_PADDING];
+  gpointer      _gst_reserved[GST_PADDING - 1];
 };
 
 GST_VIDEO_BAD_API
@@ -129,6 +129,8 @@ static void gst_compositor_child_proxy_init (gpointer g_iface,
 #define DEFAULT_PAD_HEIGHT 0
 #define DEFAULT_PAD_ALPHA  1.0
 #define DEFAULT_PAD_CROSSFADE_RATIO  0.0
+/* more fragmented visible areas are blended as a whole */
+#define MAX_VISIBLE_RECTS 16
 enum
 {
   PROP_PAD_0,
@@ -259,17 +261,6 @@ _mixer_pad_get_output_size (GstCompositor * comp,
   *height = pad_height;
 }
 
-/* Test whether rectangle2 contains rectangle 1 (geometrically) */
-static gboolean
-is_rectangle_contained (GstVideoRectangle rect1, GstVideoRectangle rect2)
-{
-  if ((rect2.x <= rect1.x) && (rect2.y <= rect1.y) &&
-      ((rect2.x + rect2.w) >= (rect1.x + rect1.w)) &&
-      ((rect2.y + rect2.h) >= (rect1.y + rect1.h)))
-    return TRUE;
-  return FALSE;
-}
-
 static GstVideoRectangle
 clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
     gint outer_height)
@@ -290,6 +281,81 @@ clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
   return clamped;
 }
 
+/* Alignment of the positions the blend functions round to for @finfo, which
+ * follows the chroma subsampling */
+static void
+get_blend_alignment (const GstVideoFormatInfo * finfo, gint * x_align,
+    gint * y_align)
+{
+  guint c;
+
+  *x_align = *y_align = 1;
+  for (c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+    *x_align = MAX (*x_align, 1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, c));
+    *y_align = MAX (*y_align, 1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, c));
+  }
+}
+
+/* Remove @hole from all rectangles of @rects, storing the remaining
+ * non-overlapping pieces in @out */
+static void
+subtract_rectangle (GArray * rects, const GstVideoRectangle * hole,
+    GArray * out)
+{
+  gint hx2 = hole->x + hole->w;
+  gint hy2 = hole->y + hole->h;
+  guint i;
+
+  g_array_set_size (out, 0);
+
+  for (i = 0; i < rects->len; i++) {
+    GstVideoRectangle r = g_array_index (rects, GstVideoRectangle, i);
+    GstVideoRectangle piece;
+    gint rx2 = r.x + r.w;
+    gint ry2 = r.y + r.h;
+    gint y1, y2;
+
+    if (hole->x >= rx2 || hx2 <= r.x || hole->y >= ry2 || hy2 <= r.y) {
+      g_array_append_val (out, r);
+      continue;
+    }
+
+    /* full width pieces above and below the hole */
+    if (hole->y > r.y) {
+      piece.x = r.x;
+      piece.y = r.y;
+      piece.w = r.w;
+      piece.h = hole->y - r.y;
+      g_array_append_val (out, piece);
+    }
+    if (hy2 < ry2) {
+      piece.x = r.x;
+      piece.y = hy2;
+      piece.w = r.w;
+      piece.h = ry2 - hy2;
+      g_array_append_val (out, piece);
+    }
+
+    /* pieces left and right of the hole */
+    y1 = MAX (r.y, hole->y);
+    y2 = MIN (ry2, hy2);
+    if (hole->x > r.x) {
+      piece.x = r.x;
+      piece.y = y1;
+      piece.w = hole->x - r.x;
+      piece.h = y2 - y1;
+      g_array_append_val (out, piece);
+    }
+    if (hx2 < rx2) {
+      piece.x = hx2;
+      piece.y = y1;
+      piece.w = rx2 - hx2;
+      piece.h = y2 - y1;
+      g_array_append_val (out, piece);
+    }
+  }
+}
+
 static gboolean
 gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg, GstBuffer * buffer,
@@ -298,7 +364,9 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstCompositor *comp = GST_COMPOSITOR (vagg);
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
   gint width, height;
+  gint xpos, ypos, x_align, y_align;
   gboolean frame_obscured = FALSE;
+  GArray *visible, *remaining;
   GList *l;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
@@ -316,6 +384,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
    *     width/height. See ->set_info()
    * */
 
+  cpad->culled = FALSE;
+
   _mixer_pad_get_output_size (comp, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
       GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
 
@@ -324,7 +394,12 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     goto done;
   }
 
-  frame_rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+  /* The blend functions round the position up to the chroma subsampling */
+  get_blend_alignment (vagg->info.finfo, &x_align, &y_align);
+  xpos = GST_ROUND_UP_N (cpad->xpos, x_align);
+  ypos = GST_ROUND_UP_N (cpad->ypos, y_align);
+
+  frame_rect = clamp_rectangle (xpos, ypos, width, height,
       GST_VIDEO_INFO_WIDTH (&vagg->info), GST_VIDEO_INFO_HEIGHT (&vagg->info));
 
   if (frame_rect.w == 0 || frame_rect.h == 0) {
@@ -344,31 +419,48 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     l = l->next;
   }
 
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
-   * higher-zorder frames */
+  /* Find which parts of this frame are not covered by opaque frames of a
+   * higher zorder, skipping the frame if none are */
+  visible = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  remaining = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  g_array_append_val (visible, frame_rect);
+
   for (; l; l = l->next) {
     GstVideoRectangle frame2_rect;
     GstVideoAggregatorPad *pad2 = l->data;
     GstCompositorPad *cpad2 = GST_COMPOSITOR_PAD (pad2);
-    gint pad2_width, pad2_height;
+    gint pad2_width, pad2_height, x2, y2;
+    GArray *tmp;
+
+    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
+     * channel and isn't being crossfaded, then check opacity */
+    if (!gst_video_aggregator_pad_has_current_buffer (pad2)
+        || cpad2->alpha != 1.0 || GST_VIDEO_INFO_HAS_ALPHA (&pad2->info)
+        || cpad2->crossfade > 0.0
+        || GST_COMPOSITOR_PAD (l->prev->data)->crossfade > 0.0)
+      continue;
 
     _mixer_pad_get_output_size (comp, cpad2, GST_VIDEO_INFO_PAR_N (&vagg->info),
         GST_VIDEO_INFO_PAR_D (&vagg->info), &pad2_width, &pad2_height);
 
-    /* We don't need to clamp the coords of the second rectangle */
-    frame2_rect.x = cpad2->xpos;
-    frame2_rect.y = cpad2->ypos;
-    /* This is effectively what set_info and the above conversion
-     * code do to calculate the desired width/height */
-    frame2_rect.w = pad2_width;
-    frame2_rect.h = pad2_height;
+    /* We don't need to clamp the coords of the second rectangle, but shrink
+     * it to the alignment so that all visible parts start aligned and don't
+     * share chroma samples */
+    frame2_rect.x = GST_ROUND_UP_N (cpad2->xpos, x_align);
+    frame2_rect.y = GST_ROUND_UP_N (cpad2->ypos, y_align);
+    x2 = GST_ROUND_DOWN_N (frame2_rect.x + pad2_width, x_align);
+    y2 = GST_ROUND_DOWN_N (frame2_rect.y + pad2_height, y_align);
+    if (x2 <= frame2_rect.x || y2 <= frame2_rect.y)
+      continue;
+    frame2_rect.w = x2 - frame2_rect.x;
+    frame2_rect.h = y2 - frame2_rect.y;
 
-    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
-     * channel, then check opacity and frame boundaries */
-    if (gst_video_aggregator_pad_has_current_buffer (pad2)
-        && cpad2->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad2->info)
-        && is_rectangle_contained (frame_rect, frame2_rect)) {
+    subtract_rectangle (visible, &frame2_rect, remaining);
+    tmp = visible;
+    visible = remaining;
+    remaining = tmp;
+
+    if (visible->len == 0) {
       frame_obscured = TRUE;
       GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %s %ix%i@(%i,%i) "
           "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
@@ -381,6 +473,22 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   }
   GST_OBJECT_UNLOCK (vagg);
 
+  /* Only blend the visible parts if something is covered and the frame
+   * isn't too fragmented for that to be worth it */
+  if (!frame_obscured && visible->len <= MAX_VISIBLE_RECTS &&
+      (visible->len > 1 || memcmp (&g_array_index (visible, GstVideoRectangle,
+                  0), &frame_rect, sizeof (GstVideoRectangle)) != 0)) {
+    GST_LOG_OBJECT (pad, "blending %u visible parts", visible->len);
+    cpad->culled = TRUE;
+    cpad->culled_xpos = xpos;
+    cpad->culled_ypos = ypos;
+    g_array_set_size (cpad->visible_rects, 0);
+    g_array_append_vals (cpad->visible_rects, visible->data, visible->len);
+  }
+
+  g_array_free (visible, TRUE);
+  g_array_free (remaining, TRUE);
+
   if (frame_obscured)
     goto done;
 
@@ -437,6 +545,16 @@ gst_compositor_pad_create_conversion_info (GstVideoAggregatorConvertPad * pad,
   }
 }
 
+static void
+gst_compositor_pad_finalize (GObject * object)
+{
+  GstCompositorPad *pad = GST_COMPOSITOR_PAD (object);
+
+  g_array_free (pad->visible_rects, TRUE);
+
+  G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -448,6 +566,7 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   gobject_class->set_property = gst_compositor_pad_set_property;
   gobject_class->get_property = gst_compositor_pad_get_property;
+  gobject_class->finalize = gst_compositor_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
       g_param_spec_int ("xpos", "X Position", "X Position of the picture",
@@ -480,6 +599,8 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   vaggcpadclass->create_conversion_info =
       GST_DEBUG_FUNCPTR (gst_compositor_pad_create_conversion_info);
+  /* prepare_frame() doesn't look at the converted frame */
+  vaggcpadclass->convert_concurrently = TRUE;
 }
 
 static void
@@ -489,15 +610,22 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
   compo_pad->ypos = DEFAULT_PAD_YPOS;
   compo_pad->alpha = DEFAULT_PAD_ALPHA;
   compo_pad->crossfade = DEFAULT_PAD_CROSSFADE_RATIO;
+  compo_pad->visible_rects =
+      g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
 }
 
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_MAX_THREADS 0
+/* minimum height of a band blended by one thread, a multiple of 16 rows so
+ * bands stay aligned to chroma subsampling and the checker pattern */
+#define MIN_BAND_HEIGHT 64
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_MAX_THREADS,
 };
 
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
@@ -533,6 +661,11 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -549,6 +682,11 @@ gst_compositor_set_property (GObject * object,
     case PROP_BACKGROUND:
       self->background = g_value_get_enum (value);
       break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->max_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -560,6 +698,20 @@ G_DEFINE_TYPE_WITH_CODE (GstCompositor, gst_compositor,
     GST_TYPE_VIDEO_AGGREGATOR, G_IMPLEMENT_INTERFACE (GST_TYPE_CHILD_PROXY,
         gst_compositor_child_proxy_init));
 
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  if (self->blend_pool)
+    g_thread_pool_free (self->blend_pool, FALSE, TRUE);
+  self->blend_pool = NULL;
+  g_mutex_clear (&self->blend_lock);
+  g_cond_clear (&self->blend_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 set_functions (GstCompositor * self, GstVideoInfo * info)
 {
@@ -950,6 +1102,243 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
   return all_crossfading;
 }
 
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *out_frame;
+  BlendFunction composite;
+  gboolean fill_background;
+  gboolean blend_pads;
+  guint y_start;
+  guint y_end;
+} CompositorBand;
+
+/* Make @sub a view of the @width x @height area at @x, @y of @frame, which
+ * must be aligned to the chroma subsampling */
+static void
+gst_compositor_init_sub_frame (GstVideoFrame * sub,
+    const GstVideoFrame * frame, gint x, gint y, gint width, gint height)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  gboolean plane_done[GST_VIDEO_MAX_PLANES] = { FALSE, };
+  guint c;
+
+  *sub = *frame;
+  sub->info.width = width;
+  sub->info.height = height;
+
+  for (c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+    guint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, c);
+
+    if (plane_done[plane])
+      continue;
+    plane_done[plane] = TRUE;
+
+    sub->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, c, y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, c, x) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c);
+  }
+}
+
+static void
+gst_compositor_fill_background (GstCompositor * self, GstVideoFrame * frame)
+{
+  switch (self->background) {
+    case COMPOSITOR_BACKGROUND_CHECKER:
+      self->fill_checker (frame);
+      break;
+    case COMPOSITOR_BACKGROUND_BLACK:
+      self->fill_color (frame, 16, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_WHITE:
+      self->fill_color (frame, 240, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_TRANSPARENT:
+      gst_compositor_fill_transparent (self, frame, NULL);
+      break;
+  }
+}
+
+/* Blend only the parts of @pad's frame that are not covered by higher
+ * opaque pads into the band @frame */
+static void
+gst_compositor_blend_visible_rects (CompositorBand * band,
+    GstCompositorPad * pad, GstVideoFrame * prepared_frame,
+    GstVideoFrame * frame)
+{
+  guint i;
+
+  for (i = 0; i < pad->visible_rects->len; i++) {
+    GstVideoRectangle *rect =
+        &g_array_index (pad->visible_rects, GstVideoRectangle, i);
+    GstVideoFrame src;
+
+    if (rect->y >= (gint) band->y_end ||
+        rect->y + rect->h <= (gint) band->y_start)
+      continue;
+
+    gst_compositor_init_sub_frame (&src, prepared_frame,
+        rect->x - pad->culled_xpos, rect->y - pad->culled_ypos, rect->w,
+        rect->h);
+    band->composite (&src, rect->x, rect->y - (gint) band->y_start,
+        pad->alpha, frame, COMPOSITOR_BLEND_MODE_NORMAL);
+  }
+}
+
+/* WITH GST_OBJECT_LOCK held by the aggregating thread */
+static void
+gst_compositor_blend_band (CompositorBand * band)
+{
+  GstCompositor *self = band->self;
+  GstVideoFrame frame;
+  GList *l;
+
+  gst_compositor_init_sub_frame (&frame, band->out_frame, 0, band->y_start,
+      GST_VIDEO_FRAME_WIDTH (band->out_frame), band->y_end - band->y_start);
+
+  if (band->fill_background)
+    gst_compositor_fill_background (self, &frame);
+
+  if (!band->blend_pads)
+    return;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+    GstVideoFrame *prepared_frame =
+        gst_video_aggregator_pad_get_prepared_frame (pad);
+    gint ypos;
+
+    if (prepared_frame == NULL)
+      continue;
+
+    if (compo_pad->culled && !compo_pad->crossfaded) {
+      gst_compositor_blend_visible_rects (band, compo_pad, prepared_frame,
+          &frame);
+      continue;
+    }
+
+    ypos = compo_pad->crossfaded ? 0 : compo_pad->ypos;
+
+    /* skip pads not intersecting this band, allowing for ypos being rounded
+     * up to the chroma subsampling by the blend functions */
+    if (ypos >= (gint) band->y_end ||
+        ypos + GST_VIDEO_FRAME_HEIGHT (prepared_frame) < (gint) band->y_start)
+      continue;
+
+    band->composite (prepared_frame,
+        compo_pad->crossfaded ? 0 : compo_pad->xpos,
+        ypos - (gint) band->y_start, compo_pad->alpha, &frame,
+        COMPOSITOR_BLEND_MODE_NORMAL);
+  }
+}
+
+static void
+gst_compositor_blend_band_func (gpointer data, gpointer user_data)
+{
+  GstCompositor *self = user_data;
+
+  gst_compositor_blend_band (data);
+
+  g_mutex_lock (&self->blend_lock);
+  if (--self->blend_pending == 0)
+    g_cond_signal (&self->blend_cond);
+  g_mutex_unlock (&self->blend_lock);
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Returns the number of horizontal bands to split @height rows into and
+ * makes sure enough worker threads are available for them */
+static guint
+gst_compositor_prepare_bands (GstCompositor * self, guint height)
+{
+  guint n_threads, n_bands;
+
+  n_threads = self->max_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  n_bands = MAX (1, MIN (n_threads, height / MIN_BAND_HEIGHT));
+  if (n_bands == 1)
+    return 1;
+
+  /* the aggregating thread blends one of the bands itself */
+  if (self->blend_pool == NULL) {
+    GError *err = NULL;
+
+    self->blend_pool = g_thread_pool_new (gst_compositor_blend_band_func,
+        self, n_bands - 1, FALSE, &err);
+    if (self->blend_pool == NULL) {
+      GST_WARNING_OBJECT (self, "Could not create blending threads: %s",
+          err->message);
+      g_clear_error (&err);
+      return 1;
+    }
+  } else if (g_thread_pool_get_max_threads (self->blend_pool) <
+      (gint) n_bands - 1) {
+    g_thread_pool_set_max_threads (self->blend_pool, n_bands - 1, NULL);
+  }
+
+  return n_bands;
+}
+
+/* WITH GST_OBJECT_LOCK !! */
+static void
+gst_compositor_blend_bands (GstCompositor * self, GstVideoFrame * outframe,
+    guint n_bands, BlendFunction composite, gboolean fill_background,
+    gboolean blend_pads)
+{
+  CompositorBand *bands = g_newa (CompositorBand, n_bands);
+  guint height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  guint i;
+
+  for (i = 0; i < n_bands; i++) {
+    bands[i].self = self;
+    bands[i].out_frame = outframe;
+    bands[i].composite = composite;
+    bands[i].fill_background = fill_background;
+    bands[i].blend_pads = blend_pads;
+    bands[i].y_start = i == 0 ? 0 : bands[i - 1].y_end;
+    bands[i].y_end = i == n_bands - 1 ? height :
+        MIN (height, GST_ROUND_UP_16 (height * (i + 1) / n_bands));
+  }
+
+  if (n_bands == 1) {
+    gst_compositor_blend_band (&bands[0]);
+    return;
+  }
+
+  self->blend_pending = n_bands - 1;
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (self->blend_pool, &bands[i], NULL);
+
+  gst_compositor_blend_band (&bands[0]);
+
+  g_mutex_lock (&self->blend_lock);
+  while (self->blend_pending > 0)
+    g_cond_wait (&self->blend_cond, &self->blend_lock);
+  g_mutex_unlock (&self->blend_lock);
+}
+
+/* WITH GST_OBJECT_LOCK !! */
+static gboolean
+gst_compositor_has_crossfading_pads (GstCompositor * self)
+{
+  GList *l;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+
+    if (GST_COMPOSITOR_PAD (pad)->crossfade > 0.0 &&
+        gst_video_aggregator_pad_get_prepared_frame (pad))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
 static GstFlowReturn
 gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 {
@@ -957,6 +1346,8 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
   GstVideoFrame out_frame, *outframe;
+  gboolean blend_pads;
+  guint n_bands;
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
@@ -964,44 +1355,37 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   }
 
   outframe = &out_frame;
-  /* default to blending */
-  composite = self->blend;
+  /* default to blending, use overlay to keep a transparent background */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+  else
+    composite = self->blend;
+
   /* TODO: If the frames to be composited completely obscure the background,
    * don't bother drawing the background at all. */
-  switch (self->background) {
-    case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
-      break;
-    case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_TRANSPARENT:
-      gst_compositor_fill_transparent (self, outframe, NULL);
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
-      break;
+  GST_OBJECT_LOCK (vagg);
+  n_bands = gst_compositor_prepare_bands (self,
+      GST_VIDEO_FRAME_HEIGHT (outframe));
+
+  /* First mix the crossfade frames as required, which needs the background
+   * of the whole frame first. Otherwise the background is drawn by each band
+   * right before blending the pads into it. */
+  if (gst_compositor_has_crossfading_pads (self)) {
+    gst_compositor_blend_bands (self, outframe, n_bands, composite, TRUE,
+        FALSE);
+    blend_pads = !gst_compositor_crossfade_frames (self, outframe);
+    if (blend_pads)
+      gst_compositor_blend_bands (self, outframe, n_bands, composite, FALSE,
+          TRUE);
+  } else {
+    blend_pads = !gst_compositor_crossfade_frames (self, outframe);
+    gst_compositor_blend_bands (self, outframe, n_bands, composite, TRUE,
+        blend_pads);
   }
 
-  GST_OBJECT_LOCK (vagg);
-  /* First mix the crossfade frames as required */
-  if (!gst_compositor_crossfade_frames (self, outframe)) {
-    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
-      GstVideoAggregatorPad *pad = l->data;
-      GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
-      GstVideoFrame *prepared_frame =
-          gst_video_aggregator_pad_get_prepared_frame (pad);
-
-      if (prepared_frame != NULL) {
-        composite (prepared_frame,
-            compo_pad->crossfaded ? 0 : compo_pad->xpos,
-            compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
-            outframe, COMPOSITOR_BLEND_MODE_NORMAL);
-        compo_pad->crossfaded = FALSE;
-      }
-    }
+  if (blend_pads) {
+    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next)
+      GST_COMPOSITOR_PAD (l->data)->crossfaded = FALSE;
   }
   GST_OBJECT_UNLOCK (vagg);
 
@@ -1104,6 +1488,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_compositor_request_new_pad);
@@ -1119,6 +1504,22 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:max-threads:
+   *
+   * Maximum number of threads blending horizontal bands of the output
+   * frame in parallel, each band blending all pads intersecting it.
+   * 0 uses one thread per CPU core, 1 blends everything in the
+   * aggregating thread.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Max Threads",
+          "Maximum number of blending threads to use (0 = auto)",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1135,6 +1536,9 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  self->max_threads = DEFAULT_MAX_THREADS;
+  g_mutex_init (&self->blend_lock);
+  g_cond_init (&self->blend_cond);
 }
 
 /* GstChildProxy implementation */
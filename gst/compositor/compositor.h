@@ -72,6 +72,13 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* band-parallel blending */
+  guint max_threads;
+  GThreadPool *blend_pool;
+  GMutex blend_lock;
+  GCond blend_cond;
+  guint blend_pending;
 };
 
 struct _GstCompositorClass
@@ -55,6 +55,12 @@ struct _GstCompositorPad
   gdouble crossfade;
 
   gboolean crossfaded;
+
+  /* visible parts of the prepared frame, in output coordinates, when only
+   * those need to be blended */
+  gboolean culled;
+  gint culled_xpos, culled_ypos;
+  GArray *visible_rects;
 };
 
 struct _GstCompositorPadClass
@@ -78,7 +78,7 @@ gst_inter_surface_unref (GstInterSurface * surface)
     }
 
     g_mutex_clear (&surface->mutex);
-    gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_surface_clear_video_frames (surface);
     gst_buffer_replace (&surface->sub_buffer, NULL);
     gst_object_unref (surface->audio_adapter);
     g_free (surface->name);
@@ -86,3 +86,70 @@ gst_inter_surface_unref (GstInterSurface * surface)
   }
   g_mutex_unlock (&mutex);
 }
+
+/* The video frame functions must be called with the surface mutex held */
+
+void
+gst_inter_surface_push_video_frame (GstInterSurface * surface,
+    GstBuffer * buffer, GstClock * clock, GstClockTime time)
+{
+  GstInterVideoFrame *frame;
+
+  frame = &surface->video_frames[surface->video_seqnum %
+      GST_INTER_SURFACE_VIDEO_FRAMES];
+  gst_buffer_replace (&frame->buffer, buffer);
+  gst_object_replace ((GstObject **) & frame->clock, (GstObject *) clock);
+  frame->time = time;
+  frame->seqnum = ++surface->video_seqnum;
+}
+
+/* Returns the frame that should be shown at @time on @clock, that is the most
+ * recent one due at or before @time, or the oldest one if all are due later.
+ * Frames with a time on another clock are considered due, so without a valid
+ * @time or a common clock this is the most recent frame. Frames older than
+ * @min_seqnum are never returned, so that a reader does not go back in time. */
+GstBuffer *
+gst_inter_surface_get_video_frame (GstInterSurface * surface,
+    GstClock * clock, GstClockTime time, guint64 min_seqnum, guint64 * seqnum)
+{
+  GstInterVideoFrame *best = NULL, *oldest = NULL;
+  guint i;
+
+  for (i = 0; i < GST_INTER_SURFACE_VIDEO_FRAMES; i++) {
+    GstInterVideoFrame *frame = &surface->video_frames[i];
+
+    if (!frame->buffer || frame->seqnum < min_seqnum)
+      continue;
+
+    if (!oldest || frame->seqnum < oldest->seqnum)
+      oldest = frame;
+
+    if (clock && frame->clock == clock && GST_CLOCK_TIME_IS_VALID (time) &&
+        GST_CLOCK_TIME_IS_VALID (frame->time) && frame->time > time)
+      continue;
+
+    if (!best || frame->seqnum > best->seqnum)
+      best = frame;
+  }
+
+  if (!best)
+    best = oldest;
+  if (!best)
+    return NULL;
+
+  *seqnum = best->seqnum;
+  return gst_buffer_ref (best->buffer);
+}
+
+void
+gst_inter_surface_clear_video_frames (GstInterSurface * surface)
+{
+  guint i;
+
+  for (i = 0; i < GST_INTER_SURFACE_VIDEO_FRAMES; i++) {
+    gst_buffer_replace (&surface->video_frames[i].buffer, NULL);
+    gst_object_replace ((GstObject **) & surface->video_frames[i].clock,
+        NULL);
+    surface->video_frames[i].time = GST_CLOCK_TIME_NONE;
+  }
+}
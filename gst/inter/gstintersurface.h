@@ -27,6 +27,19 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterVideoFrame GstInterVideoFrame;
+
+#define GST_INTER_SURFACE_VIDEO_FRAMES 8
+
+struct _GstInterVideoFrame
+{
+  GstBuffer *buffer;
+  /* time the frame is meant to be shown at on @clock, or GST_CLOCK_TIME_NONE */
+  GstClock *clock;
+  GstClockTime time;
+  /* increases with every frame written to the surface, starting at 1 */
+  guint64 seqnum;
+};
 
 struct _GstInterSurface
 {
@@ -35,9 +48,10 @@ struct _GstInterSurface
 
   char *name;
 
-  /* video */
+  /* video: ring of the most recent frames, read by any number of sources */
   GstVideoInfo video_info;
-  int video_buffer_count;
+  GstInterVideoFrame video_frames[GST_INTER_SURFACE_VIDEO_FRAMES];
+  guint64 video_seqnum;
 
   /* audio */
   GstAudioInfo audio_info;
@@ -45,7 +59,6 @@ struct _GstInterSurface
   guint64 audio_latency_time;
   guint64 audio_period_time;
 
-  GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
   GstAdapter *audio_adapter;
 };
@@ -58,6 +71,12 @@ struct _GstInterSurface
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+void gst_inter_surface_push_video_frame (GstInterSurface *surface,
+    GstBuffer *buffer, GstClock *clock, GstClockTime time);
+GstBuffer * gst_inter_surface_get_video_frame (GstInterSurface *surface,
+    GstClock *clock, GstClockTime time, guint64 min_seqnum, guint64 *seqnum);
+void gst_inter_surface_clear_video_frames (GstInterSurface *surface);
+
 
 G_END_DECLS
 
@@ -210,10 +210,7 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
 
   g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = NULL;
+  gst_inter_surface_clear_video_frames (intervideosink->surface);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
   g_mutex_unlock (&intervideosink->surface->mutex);
 
@@ -246,17 +243,29 @@ static GstFlowReturn
 gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstClockTime time = GST_CLOCK_TIME_NONE;
+  GstClock *clock;
 
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
+  /* Sources pick frames by clock time, as their running times are
+   * unrelated to ours */
+  clock = gst_element_get_clock (GST_ELEMENT (sink));
+  if (GST_BUFFER_PTS_IS_VALID (buffer) && clock) {
+    time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    if (GST_CLOCK_TIME_IS_VALID (time))
+      time += gst_element_get_base_time (GST_ELEMENT (sink));
   }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
+
+  g_mutex_lock (&intervideosink->surface->mutex);
+  gst_inter_surface_push_video_frame (intervideosink->surface, buffer, clock,
+      time);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
+  if (clock)
+    gst_object_unref (clock);
+
   return GST_FLOW_OK;
 }
@@ -71,7 +71,8 @@ enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_STATS
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -130,6 +131,20 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSrc:stats:
+   *
+   * Statistics about the frames read from the channel: "dropped" frames
+   * were replaced by a newer one before they could be output,
+   * "duplicated" frames were output more than once, and "black" frames
+   * were output while no frame was available.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Various statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -175,6 +190,15 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-inter-video-src-stats",
+              "dropped", G_TYPE_UINT64, intervideosrc->n_dropped,
+              "duplicated", G_TYPE_UINT64, intervideosrc->n_duplicated,
+              "black", G_TYPE_UINT64, intervideosrc->n_black, NULL));
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -276,6 +300,14 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
+  intervideosrc->video_seqnum = 0;
+  intervideosrc->n_repeats = 0;
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->n_dropped = 0;
+  intervideosrc->n_duplicated = 0;
+  intervideosrc->n_black = 0;
+  GST_OBJECT_UNLOCK (intervideosrc);
 
   return TRUE;
 }
@@ -326,7 +358,9 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
   GstCaps *caps;
   GstBuffer *buffer;
-  guint64 frames;
+  guint64 frames, seqnum = 0, dropped = 0;
+  GstClockTime base_time = GST_CLOCK_TIME_NONE, time = GST_CLOCK_TIME_NONE;
+  GstClock *clock;
   gboolean is_gap = FALSE;
 
   GST_DEBUG_OBJECT (intervideosrc, "create");
@@ -338,6 +372,10 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
       GST_VIDEO_INFO_FPS_N (&intervideosrc->info),
       GST_VIDEO_INFO_FPS_D (&intervideosrc->info) * GST_SECOND);
 
+  clock = gst_element_get_clock (GST_ELEMENT (src));
+  if (clock)
+    base_time = gst_element_get_base_time (GST_ELEMENT (src));
+
   g_mutex_lock (&intervideosrc->surface->mutex);
   if (intervideosrc->surface->video_info.finfo) {
     GstVideoInfo tmp_info = intervideosrc->surface->video_info;
@@ -360,25 +398,48 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
-    /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
+  /* Pick the frame due when the one we are creating will be shown */
+  if (GST_CLOCK_TIME_IS_VALID (base_time))
+    time = base_time + intervideosrc->timestamp_offset +
+        gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
+        GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+        GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
 
-    /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
-    }
+  buffer = gst_inter_surface_get_video_frame (intervideosrc->surface, clock,
+      time, intervideosrc->video_seqnum, &seqnum);
+  g_mutex_unlock (&intervideosrc->surface->mutex);
+
+  if (clock)
+    gst_object_unref (clock);
+
+  if (buffer && seqnum != intervideosrc->video_seqnum) {
+    if (intervideosrc->video_seqnum != 0)
+      dropped = seqnum - intervideosrc->video_seqnum - 1;
+    intervideosrc->video_seqnum = seqnum;
+    intervideosrc->n_repeats = 0;
+  } else {
+    intervideosrc->n_repeats++;
+    /* Only keep repeating the last frame until the timeout */
+    if (buffer && intervideosrc->n_repeats > frames)
+      gst_buffer_replace (&buffer, NULL);
   }
 
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
-    /* This is a repeat of the stored buffer or of a black frame */
+  if (intervideosrc->n_repeats != 0 && intervideosrc->n_repeats != frames + 1) {
+    /* This is a repeat of the last frame or of a black frame */
     is_gap = TRUE;
   }
 
-  intervideosrc->surface->video_buffer_count++;
-  g_mutex_unlock (&intervideosrc->surface->mutex);
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->n_dropped += dropped;
+  if (buffer && intervideosrc->n_repeats != 0)
+    intervideosrc->n_duplicated++;
+  else if (!buffer)
+    intervideosrc->n_black++;
+  GST_OBJECT_UNLOCK (intervideosrc);
+
+  if (dropped)
+    GST_LOG_OBJECT (intervideosrc, "Skipped %" G_GUINT64_FORMAT " frames",
+        dropped);
 
   if (caps) {
     gboolean ret;
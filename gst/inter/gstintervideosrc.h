@@ -48,6 +48,15 @@ struct _GstInterVideoSrc
   GstBuffer *black_frame;
   int n_frames;
   GstClockTime timestamp_offset;
+
+  /* reader cursor into the surface frames */
+  guint64 video_seqnum;
+  guint64 n_repeats;
+
+  /* protected by the object lock */
+  guint64 n_dropped;
+  guint64 n_duplicated;
+  guint64 n_black;
 };
 
 struct _GstInterVideoSrcClass
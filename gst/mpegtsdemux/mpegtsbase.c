@@ -195,6 +195,9 @@ mpegts_base_reset (MpegTSBase * base)
   /* ATSC */
   MPEGTS_BIT_SET (base->known_psi, 0x1ffb);
 
+  base->filter_program_number = -1;
+  mpegts_base_update_pid_filter (base);
+
   if (base->pat) {
     g_ptr_array_unref (base->pat);
     base->pat = NULL;
@@ -434,6 +437,37 @@ mpegts_base_get_program (MpegTSBase * base, gint program_number)
   return program;
 }
 
+/* Only lets the packetizer parse PSI packets and the packets of the streams of
+ * filter_program_number, so that the PES of other programs of a multiplex
+ * are dropped with a single lookup */
+void
+mpegts_base_update_pid_filter (MpegTSBase * base)
+{
+  MpegTSBaseProgram *program;
+  guint8 pids[1024];
+  GList *tmp;
+
+  if (base->filter_program_number == -1) {
+    mpegts_packetizer_set_pid_filter (base->packetizer, NULL);
+    return;
+  }
+
+  memcpy (pids, base->known_psi, 1024);
+
+  program = mpegts_base_get_program (base, base->filter_program_number);
+  if (program && program->active) {
+    for (tmp = program->stream_list; tmp; tmp = tmp->next) {
+      MpegTSBaseStream *stream = (MpegTSBaseStream *) tmp->data;
+      MPEGTS_BIT_SET (pids, stream->pid);
+    }
+    MPEGTS_BIT_SET (pids, program->pcr_pid);
+  }
+
+  GST_DEBUG_OBJECT (base, "Filtering PIDs for program %d",
+      base->filter_program_number);
+  mpegts_packetizer_set_pid_filter (base->packetizer, pids);
+}
+
 static MpegTSBaseProgram *
 mpegts_base_steal_program (MpegTSBase * base, gint program_number)
 {
@@ -676,6 +710,8 @@ mpegts_base_update_program (MpegTSBase * base, MpegTSBaseProgram * program,
     MpegTSBaseStream *stream = (MpegTSBaseStream *) tmp->data;
     mpegts_base_program_remove_stream (base, program, stream->pid);
   }
+  mpegts_base_update_pid_filter (base);
+
   return TRUE;
 }
 
@@ -865,6 +901,7 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
 
     GST_DEBUG ("program stream_list is now %p", program->stream_list);
   }
+  mpegts_base_update_pid_filter (base);
 
   /* Inform subclasses we're deactivating this program */
   if (klass->program_stopped)
@@ -927,6 +964,7 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
 
   program->active = TRUE;
   program->initial_program = initial_program;
+  mpegts_base_update_pid_filter (base);
 
   klass = GST_MPEGTS_BASE_GET_CLASS (base);
   if (klass->program_started != NULL)
@@ -1041,6 +1079,7 @@ mpegts_base_apply_pat (MpegTSBase * base, GstMpegtsSection * section)
 
     g_ptr_array_unref (old_pat);
   }
+  mpegts_base_update_pid_filter (base);
 
   return TRUE;
 }
@@ -1201,6 +1240,7 @@ mpegts_base_parse_atsc_mgt (MpegTSBase * base, GstMpegtsSection * section)
       MPEGTS_BIT_SET (base->known_psi, table->pid);
     }
   }
+  mpegts_base_update_pid_filter (base);
 
   return TRUE;
 }
@@ -132,6 +132,11 @@ struct _MpegTSBase {
   guint8 *known_psi;
   guint8 *is_pes;
 
+  /* Program number whose PES PIDs are the only ones parsed, packets for the
+   * PES of other programs being dropped by the packetizer (-1 for all).
+   * Call mpegts_base_update_pid_filter() after changing it */
+  gint filter_program_number;
+
   gboolean disposed;
 
   /* size of the MpegTSBaseProgram structure, can be overridden
@@ -232,6 +237,8 @@ G_GNUC_INTERNAL gboolean gst_mpegtsbase_plugin_init (GstPlugin * plugin);
 
 G_GNUC_INTERNAL void mpegts_base_deactivate_and_free_program (MpegTSBase *base, MpegTSBaseProgram *program);
 
+G_GNUC_INTERNAL void mpegts_base_update_pid_filter (MpegTSBase *base);
+
 G_END_DECLS
 
 #endif /* GST_MPEG_TS_BASE_H */
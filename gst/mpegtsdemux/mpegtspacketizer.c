@@ -49,6 +49,7 @@ G_DEFINE_TYPE_EXTENDED (MpegTSPacketizer2, mpegts_packetizer, G_TYPE_OBJECT, 0,
 #define PACKETIZER_GROUP_UNLOCK(p) g_mutex_unlock(&((p)->group_lock))
 
 static void mpegts_packetizer_dispose (GObject * object);
+static void mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer);
 static void mpegts_packetizer_finalize (GObject * object);
 static GstClockTime calculate_skew (MpegTSPacketizer2 * packetizer,
     MpegTSPCR * pcr, guint64 pcrtime, GstClockTime time);
@@ -261,6 +262,11 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->zero_copy = FALSE;
+  packetizer->map_buffer = NULL;
+  packetizer->bytes_copied = 0;
+  packetizer->pid_filter = NULL;
+  packetizer->skipped_packets = 0;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -289,8 +295,11 @@ mpegts_packetizer_dispose (GObject * object)
       g_free (packetizer->streams);
     }
 
+    mpegts_packetizer_unmap (packetizer);
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
+    g_free (packetizer->pid_filter);
+    packetizer->pid_filter = NULL;
     g_mutex_clear (&packetizer->group_lock);
     packetizer->disposed = TRUE;
     packetizer->offset = 0;
@@ -553,6 +562,20 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   return res;
 }
 
+static void
+mpegts_packetizer_unmap (MpegTSPacketizer2 * packetizer)
+{
+  if (packetizer->map_buffer) {
+    gst_buffer_unmap (packetizer->map_buffer, &packetizer->map_info);
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
+  }
+
+  packetizer->map_data = NULL;
+  packetizer->map_size = 0;
+  packetizer->map_offset = 0;
+}
+
 void
 mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
 {
@@ -571,13 +594,11 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
     memset (packetizer->streams, 0, 8192 * sizeof (MpegTSPacketizerStream *));
   }
 
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -586,6 +607,7 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
 
   /* Close current PCR group */
   PACKETIZER_GROUP_LOCK (packetizer);
+  packetizer->skipped_packets = 0;
 
   for (i = 0; i < MAX_PCR_OBS_CHANNELS; i++) {
     if (packetizer->observations[i])
@@ -610,14 +632,12 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
       }
     }
   }
+  mpegts_packetizer_unmap (packetizer);
   gst_adapter_clear (packetizer->adapter);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -626,6 +646,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
 
   /* Close current PCR group */
   PACKETIZER_GROUP_LOCK (packetizer);
+  packetizer->skipped_packets = 0;
   for (i = 0; i < MAX_PCR_OBS_CHANNELS; i++) {
     if (packetizer->observations[i])
       _close_current_group (packetizer->observations[i]);
@@ -651,6 +672,68 @@ mpegts_packetizer_remove_stream (MpegTSPacketizer2 * packetizer, gint16 pid)
   }
 }
 
+void
+mpegts_packetizer_set_zero_copy (MpegTSPacketizer2 * packetizer,
+    gboolean zero_copy)
+{
+  GST_DEBUG ("zero-copy payloads %s", zero_copy ? "enabled" : "disabled");
+
+  /* Takes effect on the next mapping of the adapter */
+  packetizer->zero_copy = zero_copy;
+}
+
+/* Returns a buffer sharing the memory of the given region of the currently
+ * mapped data, or NULL if the region can not be shared (zero-copy mode
+ * disabled or data not coming from the current mapping) */
+GstBuffer *
+mpegts_packetizer_get_sub_buffer (MpegTSPacketizer2 * packetizer,
+    const guint8 * data, gsize size)
+{
+  gsize offset;
+
+  if (packetizer->map_buffer == NULL)
+    return NULL;
+
+  if (G_UNLIKELY (data < packetizer->map_data ||
+          data + size > packetizer->map_data + packetizer->map_size))
+    return NULL;
+
+  offset = data - packetizer->map_data;
+
+  return gst_buffer_copy_region (packetizer->map_buffer,
+      GST_BUFFER_COPY_MEMORY, offset, size);
+}
+
+guint64
+mpegts_packetizer_get_skipped_packets (MpegTSPacketizer2 * packetizer)
+{
+  guint64 skipped_packets;
+
+  PACKETIZER_GROUP_LOCK (packetizer);
+  skipped_packets = packetizer->skipped_packets;
+  PACKETIZER_GROUP_UNLOCK (packetizer);
+
+  return skipped_packets;
+}
+
+/* Only packets on PIDs set in @pids (an array of 8192 bits, see MPEGTS_BIT_*)
+ * will be returned by mpegts_packetizer_next_packet(). Passing NULL disables
+ * filtering */
+void
+mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 * packetizer,
+    const guint8 * pids)
+{
+  if (pids == NULL) {
+    g_free (packetizer->pid_filter);
+    packetizer->pid_filter = NULL;
+    return;
+  }
+
+  if (packetizer->pid_filter == NULL)
+    packetizer->pid_filter = g_new (guint8, 1024);
+  memcpy (packetizer->pid_filter, pids, 1024);
+}
+
 MpegTSPacketizer2 *
 mpegts_packetizer_new (void)
 {
@@ -682,14 +765,12 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
 static void
 mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
 {
+  mpegts_packetizer_unmap (packetizer);
+
   if (size > 0) {
     GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
     gst_adapter_flush (packetizer->adapter, size);
   }
-
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
 }
 
 static gboolean
@@ -706,10 +787,28 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   if (available < size)
     return FALSE;
 
-  packetizer->map_data =
-      (guint8 *) gst_adapter_map (packetizer->adapter, available);
-  if (!packetizer->map_data)
-    return FALSE;
+  /* Data spread over several input buffers has to be merged */
+  if (gst_adapter_available_fast (packetizer->adapter) < available)
+    packetizer->bytes_copied += available;
+
+  if (packetizer->zero_copy) {
+    /* Only copies if the data is spread over several input buffers,
+     * which gst_adapter_map() would have to do as well */
+    packetizer->map_buffer =
+        gst_adapter_get_buffer (packetizer->adapter, available);
+    if (!gst_buffer_map (packetizer->map_buffer, &packetizer->map_info,
+            GST_MAP_READ)) {
+      gst_buffer_unref (packetizer->map_buffer);
+      packetizer->map_buffer = NULL;
+      return FALSE;
+    }
+    packetizer->map_data = packetizer->map_info.data;
+  } else {
+    packetizer->map_data =
+        (guint8 *) gst_adapter_map (packetizer->adapter, available);
+    if (!packetizer->map_data)
+      return FALSE;
+  }
 
   packetizer->map_size = available;
   packetizer->map_offset = 0;
@@ -719,11 +818,30 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+/* Returns the position of the first sync byte in data[start..end[, or end
+ * if there is none. memchr() is used since the C library provides vectorized
+ * implementations of it on all the platforms we care about, which makes
+ * skipping garbage/unsynchronized data much faster than a byte loop */
+static inline gsize
+mpegts_packetizer_find_sync_byte (const guint8 * data, gsize start, gsize end)
+{
+  const guint8 *sync;
+
+  if (G_UNLIKELY (start >= end))
+    return end;
+
+  sync = memchr (data + start, PACKET_SYNC_BYTE, end - start);
+  if (sync == NULL)
+    return end;
+
+  return sync - data;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, limit, i, j;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -738,10 +856,12 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
+  limit = size - 3 * MPEGTS_MAX_PACKETSIZE;
+  for (i = 0; i < limit; i++) {
     /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+    i = mpegts_packetizer_find_sync_byte (data, i, limit);
+    if (i == limit)
+      break;
 
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
@@ -781,7 +901,7 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   gboolean found = FALSE;
   guint8 *data;
   guint packet_size;
-  gsize size, sync_offset, i;
+  gsize size, limit, sync_offset, i;
 
   packet_size = packetizer->packet_size;
 
@@ -796,9 +916,13 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+  limit = size - 2 * packet_size;
+  for (i = sync_offset; i < limit; i++) {
+    i = mpegts_packetizer_find_sync_byte (data, i, limit);
+    if (i == limit)
+      break;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -817,9 +941,11 @@ MpegTSPacketizerPacketReturn
 mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
 {
+  MpegTSPacketizerPacketReturn ret;
   guint8 *packet_data;
   guint packet_size;
   gsize sync_offset;
+  guint skipped = 0;
 
   packet_size = packetizer->packet_size;
   if (G_UNLIKELY (!packet_size)) {
@@ -836,13 +962,17 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
 
   while (1) {
     if (packetizer->need_sync) {
-      if (!mpegts_packetizer_sync (packetizer))
-        return PACKET_NEED_MORE;
+      if (!mpegts_packetizer_sync (packetizer)) {
+        ret = PACKET_NEED_MORE;
+        break;
+      }
       packetizer->need_sync = FALSE;
     }
 
-    if (!mpegts_packetizer_map (packetizer, packet_size))
-      return PACKET_NEED_MORE;
+    if (!mpegts_packetizer_map (packetizer, packet_size)) {
+      ret = PACKET_NEED_MORE;
+      break;
+    }
 
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
@@ -850,6 +980,13 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
       GST_DEBUG ("lost sync");
       packetizer->need_sync = TRUE;
+    } else if (packetizer->pid_filter &&
+        !MPEGTS_BIT_IS_SET (packetizer->pid_filter,
+            GST_READ_UINT16_BE (packet_data + 1) & 0x1FFF)) {
+      /* Unwanted PID, skip it without looking any further */
+      packetizer->offset += packet_size;
+      skipped++;
+      mpegts_packetizer_clear_packet (packetizer, packet);
     } else {
       /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
        * packet sizes contain either extra data (timesync, FEC, ..) either
@@ -861,9 +998,19 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
       packetizer->offset += packet_size;
       GST_MEMDUMP ("data_start", packet->data_start, 16);
 
-      return mpegts_packetizer_parse_packet (packetizer, packet);
+      ret = mpegts_packetizer_parse_packet (packetizer, packet);
+      break;
     }
   }
+
+  /* Only take the lock once for all packets skipped in a row */
+  if (skipped > 0) {
+    PACKETIZER_GROUP_LOCK (packetizer);
+    packetizer->skipped_packets += skipped;
+    PACKETIZER_GROUP_UNLOCK (packetizer);
+  }
+
+  return ret;
 }
 
 MpegTSPacketizerPacketReturn
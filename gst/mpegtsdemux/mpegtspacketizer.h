@@ -269,6 +269,23 @@ struct _MpegTSPacketizer2 {
   gsize map_size;
   gboolean need_sync;
 
+  /* If TRUE, the adapter contents are mapped through a GstBuffer so that
+   * payloads can be handed out as sub-buffers instead of being copied */
+  gboolean zero_copy;
+  /* Buffer backing map_data when zero_copy is used */
+  GstBuffer *map_buffer;
+  GstMapInfo map_info;
+  /* Bytes copied by the adapter when the mapped data had to be merged from
+   * several input buffers, to be collected by the subclass */
+  guint64 bytes_copied;
+
+  /* If set, packets whose PID bit is not set in this array are dropped
+   * before any header parsing. Use MPEGTS_BIT_* macros to check */
+  guint8 *pid_filter;
+  /* Number of packets dropped by pid_filter since the last flush, protected
+   * by group_lock */
+  guint64 skipped_packets;
+
   /* Reference offset */
   guint64 refoffset;
 
@@ -350,6 +367,13 @@ G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetiz
 				     MpegTSPacketizerPacket *packet);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
+G_GNUC_INTERNAL void mpegts_packetizer_set_zero_copy (MpegTSPacketizer2 *packetizer,
+  gboolean zero_copy);
+G_GNUC_INTERNAL GstBuffer *mpegts_packetizer_get_sub_buffer (MpegTSPacketizer2 *packetizer,
+  const guint8 *data, gsize size);
+G_GNUC_INTERNAL void mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 *packetizer,
+  const guint8 *pids);
+G_GNUC_INTERNAL guint64 mpegts_packetizer_get_skipped_packets (MpegTSPacketizer2 *packetizer);
 
 G_GNUC_INTERNAL GstMpegtsSection *mpegts_packetizer_push_section (MpegTSPacketizer2 *packetzer,
 								  MpegTSPacketizerPacket *packet, GList **remaining);
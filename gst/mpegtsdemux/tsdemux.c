@@ -63,6 +63,9 @@
 #define CONTINUITY_UNSET 255
 #define MAX_CONTINUITY 15
 
+/* Payload of a TS packet without adaptation field */
+#define TS_MAX_PAYLOAD_SIZE 184
+
 /* Seeking/Scanning related variables */
 
 /* seek to SEEK_TIMESTAMP_OFFSET before the desired offset and search then
@@ -161,6 +164,10 @@ struct _TSDemuxStream
   /* Data being reconstructed (allocated) */
   guint8 *data;
 
+  /* Data being reconstructed as sub-buffers of the input, used instead of
+   * ->data in zero-copy mode */
+  GstBufferList *data_list;
+
   /* Size of data being reconstructed (if known, else 0) */
   guint expected_size;
 
@@ -169,6 +176,11 @@ struct _TSDemuxStream
   /* Size of ->data */
   guint allocated_size;
 
+  /* Amount of payload bytes copied while reconstructing PES packets, and
+   * how much of it was already added to the element's total */
+  guint64 bytes_copied;
+  guint64 bytes_copied_reported;
+
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
   GstClockTime dts;
@@ -282,6 +294,9 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_ZERO_COPY_PES,
+  PROP_SKIPPED_PACKETS,
+  PROP_BYTES_COPIED,
   /* FILL ME */
 };
 
@@ -373,6 +388,52 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:zero-copy-pes:
+   *
+   * Reassemble PES packets from sub-buffers of the input instead of copying
+   * every TS packet payload. As every TS packet payload is a separate memory
+   * block and a #GstBuffer holds at most 16 of them, this only applies to
+   * PES packets of up to 16 TS packets (about 2.9 kB), like audio frames.
+   * Larger PES packets, which includes most video frames, are copied as in
+   * the default mode. Payloads are also merged into contiguous memory when
+   * the stream needs to be inspected (keyframe search, Opus, JPEG 2000).
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY_PES,
+      g_param_spec_boolean ("zero-copy-pes", "Zero-copy PES",
+          "Reassemble PES packets without copying the payload when possible",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:skipped-packets:
+   *
+   * Number of packets belonging to other programs than the one being
+   * demuxed, which were dropped without being parsed since the last flush.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SKIPPED_PACKETS,
+      g_param_spec_uint64 ("skipped-packets", "Skipped packets",
+          "Number of packets of other programs dropped without parsing",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:bytes-copied:
+   *
+   * Number of payload bytes copied while reassembling PES packets, updated
+   * after every output buffer. This includes input buffers that were merged
+   * because packets span them. Allows comparing the default mode with
+   * #GstTSDemux:zero-copy-pes.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_BYTES_COPIED,
+      g_param_spec_uint64 ("bytes-copied", "Bytes copied",
+          "Number of payload bytes copied while reassembling PES packets",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -432,6 +493,10 @@ gst_ts_demux_reset (MpegTSBase * base)
 
   demux->last_seek_offset = -1;
   demux->program_generation = 0;
+
+  GST_OBJECT_LOCK (demux);
+  demux->bytes_copied = 0;
+  GST_OBJECT_UNLOCK (demux);
 }
 
 static void
@@ -466,6 +531,11 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_ZERO_COPY_PES:
+      demux->zero_copy_pes = g_value_get_boolean (value);
+      mpegts_packetizer_set_zero_copy (MPEG_TS_BASE_PACKETIZER (demux),
+          demux->zero_copy_pes);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -484,6 +554,19 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_ZERO_COPY_PES:
+      g_value_set_boolean (value, demux->zero_copy_pes);
+      break;
+    case PROP_SKIPPED_PACKETS:
+      g_value_set_uint64 (value,
+          mpegts_packetizer_get_skipped_packets (MPEG_TS_BASE_PACKETIZER
+              (demux)));
+      break;
+    case PROP_BYTES_COPIED:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->bytes_copied);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -710,8 +793,7 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
         if (h264infos->framedata.size)
           break;
 
-        res = gst_h264_parser_parse_slice_hdr (parser, &unit, &slice,
-            FALSE, FALSE);
+        res = gst_h264_parser_parse_slice_hdr_light (parser, &unit, &slice);
 
         if (GST_H264_IS_I_SLICE (&slice) || GST_H264_IS_SI_SLICE (&slice)) {
           if (*(unit.data + unit.offset + 1) & 0x80) {
@@ -1820,6 +1902,12 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
     stream->pad = NULL;
   }
 
+  GST_DEBUG_OBJECT (base, "pid 0x%04x: copied %" G_GUINT64_FORMAT
+      " bytes for %u output buffers (%" G_GUINT64_FORMAT " per buffer)",
+      bstream->pid, stream->bytes_copied, stream->nb_out_buffers,
+      stream->nb_out_buffers ? stream->bytes_copied /
+      stream->nb_out_buffers : 0);
+
   gst_ts_demux_stream_flush (stream, GST_TS_DEMUX_CAST (base), TRUE);
 
   if (stream->taglist != NULL) {
@@ -1847,14 +1935,137 @@ activate_pad_for_stream (GstTSDemux * tsdemux, TSDemuxStream * stream)
   }
 }
 
+/* Releases the data being reconstructed, whichever way it is stored */
+static void
+gst_ts_demux_stream_clear_data (TSDemuxStream * stream)
+{
+  g_free (stream->data);
+  stream->data = NULL;
+  if (stream->data_list) {
+    gst_buffer_list_unref (stream->data_list);
+    stream->data_list = NULL;
+  }
+}
+
+/* Merges the sub-buffers collected in zero-copy mode into ->data, for the
+ * code paths that need contiguous access to the PES payload */
+static void
+gst_ts_demux_stream_merge_data (TSDemuxStream * stream)
+{
+  guint i, len;
+  gsize offset = 0;
+
+  if (stream->data_list == NULL)
+    return;
+
+  g_assert (stream->data == NULL);
+
+  stream->allocated_size = MAX (stream->current_size, 8192);
+  stream->allocated_size = MAX (stream->allocated_size, stream->expected_size);
+  stream->data = g_malloc (stream->allocated_size);
+
+  len = gst_buffer_list_length (stream->data_list);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (stream->data_list, i);
+    offset += gst_buffer_extract (buf, 0, stream->data + offset,
+        gst_buffer_get_size (buf));
+  }
+  stream->bytes_copied += offset;
+
+  gst_buffer_list_unref (stream->data_list);
+  stream->data_list = NULL;
+}
+
+static inline void
+gst_ts_demux_stream_append_data (GstTSDemux * demux, TSDemuxStream * stream,
+    guint8 * data, guint size)
+{
+  if (stream->data_list) {
+    GstBuffer *sub;
+
+    if (G_UNLIKELY (size == 0))
+      return;
+
+    /* A buffer can't hold more payloads than that, copy the PES packet
+     * from here on instead of collecting sub-buffers only to merge them */
+    if (G_UNLIKELY (gst_buffer_list_length (stream->data_list) >=
+            gst_buffer_get_max_memory ())) {
+      GST_DEBUG ("pid 0x%04x: PES packet too large for zero-copy",
+          stream->stream.pid);
+      gst_ts_demux_stream_merge_data (stream);
+      goto copy;
+    }
+
+    sub = mpegts_packetizer_get_sub_buffer (MPEG_TS_BASE_PACKETIZER (demux),
+        data, size);
+    if (G_LIKELY (sub)) {
+      gst_buffer_list_add (stream->data_list, sub);
+      stream->current_size += size;
+      return;
+    }
+
+    /* The packetizer can't share this payload, continue with copies */
+    GST_DEBUG ("pid 0x%04x: falling back to copying PES data",
+        stream->stream.pid);
+    gst_ts_demux_stream_merge_data (stream);
+  }
+
+copy:
+  if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
+    GST_LOG ("resizing buffer");
+    do {
+      stream->allocated_size *= 2;
+    } while (stream->current_size + size > stream->allocated_size);
+    stream->data = g_realloc (stream->data, stream->allocated_size);
+    /* Assume the worst case, where realloc had to move the data */
+    stream->bytes_copied += stream->current_size;
+  }
+  memcpy (stream->data + stream->current_size, data, size);
+  stream->current_size += size;
+  stream->bytes_copied += size;
+}
+
+/* Returns the reconstructed PES payload as a buffer. In zero-copy mode the
+ * buffer references the input memory, unless the payload is spread over more
+ * memory blocks than a buffer can hold in which case it's merged once */
+static GstBuffer *
+gst_ts_demux_stream_take_buffer (TSDemuxStream * stream)
+{
+  GstBuffer *buffer;
+
+  if (stream->data_list) {
+    guint i, len, n_mem = 0;
+
+    len = gst_buffer_list_length (stream->data_list);
+    for (i = 0; i < len; i++)
+      n_mem += gst_buffer_n_memory (gst_buffer_list_get (stream->data_list, i));
+
+    if (n_mem <= gst_buffer_get_max_memory ()) {
+      buffer = gst_buffer_new ();
+      for (i = 0; i < len; i++)
+        gst_buffer_copy_into (buffer, gst_buffer_list_get (stream->data_list,
+                i), GST_BUFFER_COPY_MEMORY, 0, -1);
+      gst_buffer_list_unref (stream->data_list);
+      stream->data_list = NULL;
+      return buffer;
+    }
+
+    gst_ts_demux_stream_merge_data (stream);
+  }
+
+  buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+  stream->data = NULL;
+
+  return buffer;
+}
+
 static void
 gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
     gboolean hard)
 {
   GST_DEBUG ("flushing stream %p", stream);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_clear_data (stream);
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
   stream->allocated_size = 0;
@@ -1866,6 +2077,8 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
   stream->raw_dts = -1;
   stream->pending_ts = TRUE;
   stream->nb_out_buffers = 0;
+  stream->bytes_copied = 0;
+  stream->bytes_copied_reported = 0;
   stream->gap_ref_buffers = 0;
   stream->gap_ref_pts = GST_CLOCK_TIME_NONE;
   stream->continuity_counter = CONTINUITY_UNSET;
@@ -1964,6 +2177,10 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
     demux->program_number = program->program_number;
     demux->program = program;
 
+    /* Only the PES of this program need to be parsed from now on */
+    base->filter_program_number = program->program_number;
+    mpegts_base_update_pid_filter (base);
+
     /* Increment the program_generation counter */
     demux->program_generation = (demux->program_generation + 1) & 0xf;
 
@@ -2044,6 +2261,8 @@ gst_ts_demux_program_stopped (MpegTSBase * base, MpegTSBaseProgram * program)
   if (demux->program == program) {
     demux->program = NULL;
     demux->program_number = -1;
+    base->filter_program_number = -1;
+    mpegts_base_update_pid_filter (base);
   }
 }
 
@@ -2313,15 +2532,23 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   length -= header.header_size;
 
   /* Create the output buffer */
-  if (stream->expected_size)
-    stream->allocated_size = MAX (stream->expected_size, length);
-  else
-    stream->allocated_size = MAX (8192, length);
+  g_assert (stream->data == NULL && stream->data_list == NULL);
+  stream->current_size = 0;
+  /* PES packets that are known to span more TS packets than a buffer can
+   * hold memory blocks are copied right away */
+  if (demux->zero_copy_pes && (stream->expected_size == 0 ||
+          stream->expected_size <= length +
+          (gst_buffer_get_max_memory () - 1) * TS_MAX_PAYLOAD_SIZE)) {
+    stream->data_list = gst_buffer_list_new ();
+  } else {
+    if (stream->expected_size)
+      stream->allocated_size = MAX (stream->expected_size, length);
+    else
+      stream->allocated_size = MAX (8192, length);
 
-  g_assert (stream->data == NULL);
-  stream->data = g_malloc (stream->allocated_size);
-  memcpy (stream->data, data, length);
-  stream->current_size = length;
+    stream->data = g_malloc (stream->allocated_size);
+  }
+  gst_ts_demux_stream_append_data (demux, stream, data, length);
 
   stream->state = PENDING_PACKET_BUFFER;
 
@@ -2384,24 +2611,13 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG ("BUFFER: appending data");
-      if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
-        GST_LOG ("resizing buffer");
-        do {
-          stream->allocated_size *= 2;
-        } while (stream->current_size + size > stream->allocated_size);
-        stream->data = g_realloc (stream->data, stream->allocated_size);
-      }
-      memcpy (stream->data + stream->current_size, data, size);
-      stream->current_size += size;
+      gst_ts_demux_stream_append_data (demux, stream, data, size);
       break;
     }
     case PENDING_PACKET_DISCONT:
     {
       GST_LOG ("DISCONT: not storing/pushing");
-      if (G_UNLIKELY (stream->data)) {
-        g_free (stream->data);
-        stream->data = NULL;
-      }
+      gst_ts_demux_stream_clear_data (stream);
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2577,6 +2793,8 @@ parse_opus_access_unit (TSDemuxStream * stream)
   GstByteReader reader;
   GstBufferList *buffer_list = NULL;
 
+  gst_ts_demux_stream_merge_data (stream);
+
   buffer_list = gst_buffer_list_new ();
   gst_byte_reader_init (&reader, stream->data, stream->current_size);
 
@@ -2698,6 +2916,8 @@ parse_jp2k_access_unit (TSDemuxStream * stream)
   guint data_location;
   GstBuffer *retbuf = NULL;
 
+  gst_ts_demux_stream_merge_data (stream);
+
   if (stream->current_size < header_size) {
     GST_ERROR_OBJECT (stream->pad, "Not enough data for header");
     goto error;
@@ -2825,7 +3045,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
+  if (G_UNLIKELY (stream->data == NULL && stream->data_list == NULL)) {
     GST_LOG ("stream->data == NULL");
     goto beach;
   }
@@ -2842,13 +3062,14 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
   if (G_UNLIKELY (demux->program == NULL)) {
     GST_LOG_OBJECT (demux, "No program");
-    g_free (stream->data);
+    gst_ts_demux_stream_clear_data (stream);
     goto beach;
   }
 
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
+    gst_ts_demux_stream_merge_data (stream);
     if ((gst_ts_demux_adjust_seek_offset_for_keyframe (stream, stream->data,
                 stream->current_size)) || demux->last_seek_offset == 0) {
       GST_DEBUG_OBJECT (stream->pad,
@@ -2875,7 +3096,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
           goto beach;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        buffer = gst_ts_demux_stream_take_buffer (stream);
       }
 
       stream->seeked_pts = stream->pts;
@@ -2891,7 +3112,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
       stream->continuity_counter = CONTINUITY_UNSET;
       res = GST_FLOW_REWINDING;
-      g_free (stream->data);
+      gst_ts_demux_stream_clear_data (stream);
       goto beach;
     }
   } else {
@@ -2915,7 +3136,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         goto beach;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      buffer = gst_ts_demux_stream_take_buffer (stream);
     }
 
     if (G_UNLIKELY (stream->pending_ts && !check_pending_buffers (demux))) {
@@ -3061,9 +3282,21 @@ beach:
   GST_LOG ("Resetting to EMPTY, returning %s", gst_flow_get_name (res));
   stream->state = PENDING_PACKET_EMPTY;
   stream->data = NULL;
+  if (G_UNLIKELY (stream->data_list)) {
+    gst_buffer_list_unref (stream->data_list);
+    stream->data_list = NULL;
+  }
   stream->expected_size = 0;
   stream->current_size = 0;
 
+  GST_OBJECT_LOCK (demux);
+  demux->bytes_copied += stream->bytes_copied - stream->bytes_copied_reported;
+  /* including the input buffers the packetizer had to merge */
+  demux->bytes_copied += MPEG_TS_BASE_PACKETIZER (demux)->bytes_copied;
+  GST_OBJECT_UNLOCK (demux);
+  stream->bytes_copied_reported = stream->bytes_copied;
+  MPEG_TS_BASE_PACKETIZER (demux)->bytes_copied = 0;
+
   return res;
 }
 
@@ -115,11 +115,14 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
+#define MPEGTSMUX_DEFAULT_SLAB_PACKETS 32
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BITRATE      0
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -174,6 +177,9 @@ static void gst_mpegtsmux_get_property (GObject * object, guint prop_id,
 static void mpegtsmux_reset (MpegTsMux * mux, gboolean alloc);
 static void mpegtsmux_dispose (GObject * object);
 static void alloc_packet_cb (GstBuffer ** _buf, void *user_data);
+static guint8 *alloc_slab_packet_cb (void *user_data);
+static gboolean new_slab_packet_cb (guint8 * data, void *user_data,
+    gint64 new_pcr);
 static gboolean new_packet_cb (GstBuffer * buf, void *user_data,
     gint64 new_pcr);
 static void release_buffer_cb (guint8 * data, void *user_data);
@@ -184,6 +190,7 @@ static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
     gint64 new_pcr);
 
 static void mpegtsmux_prepare_srcpad (MpegTsMux * mux);
+static void mpegtsmux_setup_slabs (MpegTsMux * mux);
 GstFlowReturn mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
     GstCollectData * cdata, GstBuffer * buf, GstBuffer ** outbuf,
     gpointer user_data);
@@ -305,6 +312,22 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * mpegtsmux:bitrate:
+   *
+   * Produce constant bitrate output by inserting null packets, with PCR
+   * values derived from the position in the stream so the output can be
+   * paced without jitter.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target bitrate, will insert null packets as padding "
+          "to achieve multiplex-wide constant bitrate (0 = variable bitrate)",
+          0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -336,6 +359,7 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->pat_interval = TSMUX_DEFAULT_PAT_INTERVAL;
   mux->pmt_interval = TSMUX_DEFAULT_PMT_INTERVAL;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
 
@@ -385,6 +409,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   mux->previous_offset = 0;
   mux->pcr_rate_num = mux->pcr_rate_den = 1;
   mux->last_ts = 0;
+  mux->end_ts = GST_CLOCK_TIME_NONE;
   mux->is_delta = TRUE;
   mux->is_header = FALSE;
 
@@ -420,6 +445,21 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   gst_event_replace (&mux->force_key_unit_event, NULL);
   gst_buffer_replace (&mux->out_buffer, NULL);
 
+  if (mux->slab) {
+    gst_buffer_unmap (mux->slab, &mux->slab_map);
+    gst_buffer_replace (&mux->slab, NULL);
+  }
+  if (mux->slab_list) {
+    gst_buffer_list_unref (mux->slab_list);
+    mux->slab_list = NULL;
+  }
+  if (mux->slab_pool) {
+    gst_buffer_pool_set_active (mux->slab_pool, FALSE);
+    gst_object_unref (mux->slab_pool);
+    mux->slab_pool = NULL;
+  }
+  mux->slab_filled = 0;
+
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
     for (walk = mux->collect->data; walk != NULL; walk = g_slist_next (walk))
@@ -431,6 +471,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_bitrate (mux->tsmux, mux->bitrate);
   }
 }
 
@@ -511,6 +552,11 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      mux->bitrate = g_value_get_uint64 (value);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -542,6 +588,9 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1343,12 +1392,30 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
 
     mpegtsmux_prepare_srcpad (mux);
 
+    /* m2ts needs every packet separately for PCR interpolation */
+    if (!mux->m2ts_mode)
+      mpegtsmux_setup_slabs (mux);
+
     mux->first = FALSE;
   }
 
   if (G_UNLIKELY (best == NULL)) {
     /* EOS */
     GST_INFO_OBJECT (mux, "EOS");
+
+    /* keep the configured bitrate up to the end of the last frame */
+    if (mux->bitrate && GST_CLOCK_TIME_IS_VALID (mux->end_ts)) {
+      GList *cur;
+
+      for (cur = mux->tsmux->programs; cur; cur = cur->next) {
+        TsMuxProgram *program = (TsMuxProgram *) cur->data;
+
+        if (program->pcr_stream && !tsmux_pad_to_ts (mux->tsmux,
+                program->pcr_stream, GSTTIME_TO_MPEGTIME (mux->end_ts)))
+          GST_WARNING_OBJECT (mux, "Failed to pad the output");
+      }
+    }
+
     /* drain some possibly cached data */
     new_packet_m2ts (mux, NULL, -1);
     mpegtsmux_push_packets (mux, TRUE);
@@ -1475,6 +1542,15 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     mux->last_ts =
         GST_CLOCK_TIME_IS_VALID (GST_BUFFER_DTS (buf)) ?
         GST_BUFFER_DTS (buf) : GST_BUFFER_PTS (buf);
+
+    if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_PTS (buf))) {
+      GstClockTime end_ts = GST_BUFFER_PTS (buf);
+
+      if (GST_BUFFER_DURATION_IS_VALID (buf))
+        end_ts += GST_BUFFER_DURATION (buf);
+      if (!GST_CLOCK_TIME_IS_VALID (mux->end_ts) || end_ts > mux->end_ts)
+        mux->end_ts = end_ts;
+    }
   }
 
   mux->is_delta = delta;
@@ -1627,6 +1703,114 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
   }
 }
 
+static void
+mpegtsmux_write_null_packets (guint8 * data, gint count, gint packet_size,
+    guint32 header)
+{
+  for (; count > 0; count--) {
+    gint offset;
+
+    if (packet_size > NORMAL_TS_PACKET_LENGTH) {
+      GST_WRITE_UINT32_BE (data, header);
+      /* simply increase header a bit and never mind too much */
+      header++;
+      offset = 4;
+    } else {
+      offset = 0;
+    }
+    GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
+    /* null packet PID */
+    GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
+    /* no adaptation field exists | continuity counter undefined */
+    GST_WRITE_UINT8 (data + offset + 3, 0x10);
+    /* payload */
+    memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
+    data += packet_size;
+  }
+}
+
+static void
+mpegtsmux_setup_slabs (MpegTsMux * mux)
+{
+  GstStructure *config;
+  guint size;
+
+  if (mux->alignment > 0)
+    mux->slab_packets = mux->alignment;
+  else
+    mux->slab_packets = MPEGTSMUX_DEFAULT_SLAB_PACKETS;
+  size = mux->slab_packets * NORMAL_TS_PACKET_LENGTH;
+
+  GST_DEBUG_OBJECT (mux, "writing packets into slabs of %u packets",
+      mux->slab_packets);
+
+  mux->slab_pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (mux->slab_pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+  if (!gst_buffer_pool_set_config (mux->slab_pool, config) ||
+      !gst_buffer_pool_set_active (mux->slab_pool, TRUE)) {
+    GST_WARNING_OBJECT (mux, "failed to activate slab pool, "
+        "falling back to a buffer per packet");
+    gst_object_unref (mux->slab_pool);
+    mux->slab_pool = NULL;
+    return;
+  }
+
+  tsmux_set_packet_funcs (mux->tsmux, alloc_slab_packet_cb,
+      new_slab_packet_cb, mux);
+}
+
+/* Move the current slab to the list of pending output buffers */
+static void
+mpegtsmux_finish_slab (MpegTsMux * mux)
+{
+  GstBuffer *slab = mux->slab;
+
+  gst_buffer_unmap (slab, &mux->slab_map);
+  mux->slab = NULL;
+
+  if (mux->slab_filled < mux->slab_packets)
+    gst_buffer_set_size (slab, mux->slab_filled * NORMAL_TS_PACKET_LENGTH);
+  mux->slab_filled = 0;
+
+  if (!mux->slab_list)
+    mux->slab_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->slab_list, slab);
+}
+
+static GstFlowReturn
+mpegtsmux_push_slabs (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list;
+
+  if (mux->slab && mux->slab_filled > 0) {
+    if (mux->alignment <= 0) {
+      /* no alignment, push all available data */
+      mpegtsmux_finish_slab (mux);
+    } else if (force) {
+      gint dummy = mux->slab_packets - mux->slab_filled;
+
+      GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
+      mpegtsmux_write_null_packets (mux->slab_map.data +
+          mux->slab_filled * NORMAL_TS_PACKET_LENGTH, dummy,
+          NORMAL_TS_PACKET_LENGTH, 0);
+      mux->slab_filled = mux->slab_packets;
+      mpegtsmux_finish_slab (mux);
+    }
+  }
+
+  if (!mux->slab_list)
+    return GST_FLOW_OK;
+
+  buffer_list = mux->slab_list;
+  mux->slab_list = NULL;
+
+  GST_LOG_OBJECT (mux, "pushing %u slabs",
+      gst_buffer_list_length (buffer_list));
+
+  return gst_pad_push_list (mux->srcpad, buffer_list);
+}
+
 static GstFlowReturn
 mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
 {
@@ -1634,6 +1818,9 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
   gint align = mux->alignment;
   gint av, packet_size;
 
+  if (mux->slab_pool)
+    return mpegtsmux_push_slabs (mux, force);
+
   if (mux->m2ts_mode) {
     packet_size = M2TS_PACKET_LENGTH;
     if (align < 0)
@@ -1703,27 +1890,7 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
 
     dummy = (map.size - av) / packet_size;
     GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
-
-    for (; dummy > 0; dummy--) {
-      gint offset;
-
-      if (packet_size > NORMAL_TS_PACKET_LENGTH) {
-        GST_WRITE_UINT32_BE (data, header);
-        /* simply increase header a bit and never mind too much */
-        header++;
-        offset = 4;
-      } else {
-        offset = 0;
-      }
-      GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
-      /* null packet PID */
-      GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
-      /* no adaptation field exists | continuity counter undefined */
-      GST_WRITE_UINT8 (data + offset + 3, 0x10);
-      /* payload */
-      memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
-      data += packet_size;
-    }
+    mpegtsmux_write_null_packets (data, dummy, packet_size, header);
 
     gst_buffer_unmap (buf, &map);
     gst_buffer_list_add (buffer_list, buf);
@@ -1895,6 +2062,60 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
   return TRUE;
 }
 
+/* called when TsMux needs memory for the next packet in slab mode */
+static guint8 *
+alloc_slab_packet_cb (void *user_data)
+{
+  MpegTsMux *mux = (MpegTsMux *) user_data;
+
+  if (G_UNLIKELY (mux->slab == NULL)) {
+    GstFlowReturn ret;
+
+    ret = gst_buffer_pool_acquire_buffer (mux->slab_pool, &mux->slab, NULL);
+    if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+      GST_DEBUG_OBJECT (mux, "failed to acquire slab: %s",
+          gst_flow_get_name (ret));
+      return NULL;
+    }
+    gst_buffer_map (mux->slab, &mux->slab_map, GST_MAP_WRITE);
+    mux->slab_filled = 0;
+  }
+
+  return mux->slab_map.data + mux->slab_filled * NORMAL_TS_PACKET_LENGTH;
+}
+
+/* Called when TsMux has written a packet into the current slab */
+static gboolean
+new_slab_packet_cb (guint8 * data, void *user_data, gint64 new_pcr)
+{
+  MpegTsMux *mux = (MpegTsMux *) user_data;
+  GstBuffer *slab = mux->slab;
+
+  /* streamheaders only */
+  new_packet_common_init (mux, NULL, data, NORMAL_TS_PACKET_LENGTH);
+
+  /* timestamp and header flag follow the first packet, the slab is only
+   * a delta unit if none of its packets starts a key unit */
+  if (mux->slab_filled == 0) {
+    GST_BUFFER_PTS (slab) = mux->last_ts;
+    GST_BUFFER_FLAG_SET (slab, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (mux->is_header) {
+      GST_LOG_OBJECT (mux, "marking as header buffer");
+      GST_BUFFER_FLAG_SET (slab, GST_BUFFER_FLAG_HEADER);
+    }
+  }
+  if (!mux->is_delta) {
+    GST_DEBUG_OBJECT (mux, "marking as non-delta unit");
+    GST_BUFFER_FLAG_UNSET (slab, GST_BUFFER_FLAG_DELTA_UNIT);
+    mux->is_delta = TRUE;
+  }
+
+  if (++mux->slab_filled == mux->slab_packets)
+    mpegtsmux_finish_slab (mux);
+
+  return TRUE;
+}
+
 /* called when TsMux needs new packet to write into */
 static void
 alloc_packet_cb (GstBuffer ** _buf, void *user_data)
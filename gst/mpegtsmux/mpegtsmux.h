@@ -139,6 +139,7 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint64 bitrate;
 
   /* state */
   gboolean first;
@@ -152,6 +153,8 @@ struct MpegTsMux {
   gboolean is_delta;
   gboolean is_header;
   GstClockTime last_ts;
+  /* end time of the data of the PCR streams, to pad CBR output at EOS */
+  GstClockTime end_ts;
 
   /* m2ts specific */
   gint64 previous_pcr;
@@ -164,6 +167,14 @@ struct MpegTsMux {
   GstAdapter *out_adapter;
   GstBuffer *out_buffer;
 
+  /* packets written directly into pooled slabs (non-m2ts mode) */
+  GstBufferPool *slab_pool;
+  GstBuffer *slab;
+  GstMapInfo slab_map;
+  guint slab_packets;
+  guint slab_filled;
+  GstBufferList *slab_list;
+
 #if 0
   /* SPN/PTS index handling */
   GstIndex *element_index;
@@ -109,12 +109,18 @@
 /* Times per second to write PCR */
 #define TSMUX_DEFAULT_PCR_FREQ (25)
 
+/* Offset of the byte holding the last bit of program_clock_reference_base
+ * in a packet carrying a PCR, which is the byte the PCR value refers to */
+#define TSMUX_PCR_BYTE_OFFSET 10
+
 /* Base for all written PCR and DTS/PTS,
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
 
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
+static gboolean tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
+    guint * payload_len_out, guint * payload_offset_out);
 static void
 tsmux_section_free (TsMuxSection * section)
 {
@@ -150,6 +156,8 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -193,6 +201,66 @@ tsmux_set_alloc_func (TsMux * mux, TsMuxAllocFunc func, void *user_data)
   mux->alloc_func_data = user_data;
 }
 
+/**
+ * tsmux_set_packet_funcs:
+ * @mux: a #TsMux
+ * @alloc_func: callback returning memory for the next packet
+ * @write_func: callback called once the packet memory has been filled
+ * @user_data: user data passed to @alloc_func and @write_func
+ *
+ * Make @mux write packets directly into memory provided by @alloc_func,
+ * which must point to at least %TSMUX_PACKET_LENGTH writable bytes, instead
+ * of allocating one buffer per packet through the alloc function. Memory
+ * handed out but never passed to @write_func (on errors) may be reused.
+ * Passing %NULL callbacks restores the buffer based behaviour.
+ */
+void
+tsmux_set_packet_funcs (TsMux * mux, TsMuxPacketAllocFunc alloc_func,
+    TsMuxPacketWriteFunc write_func, void *user_data)
+{
+  g_return_if_fail (mux != NULL);
+  g_return_if_fail ((alloc_func == NULL) == (write_func == NULL));
+
+  mux->packet_alloc_func = alloc_func;
+  mux->packet_write_func = write_func;
+  mux->packet_func_data = user_data;
+}
+
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the mux rate in bits per second, or 0
+ *
+ * Make @mux produce a constant bitrate stream of @bitrate bits per second
+ * by inserting null packets, with PCR values derived from the byte position
+ * in the output. A @bitrate of 0 produces variable bitrate output.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->bitrate = bitrate;
+  mux->first_pcr = -1;
+  mux->warned_late = FALSE;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured mux rate. See also tsmux_set_bitrate().
+ *
+ * Returns: the mux rate in bits per second, 0 for variable bitrate output
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
 /**
  * tsmux_set_pat_interval:
  * @mux: a #TsMux
@@ -634,9 +702,144 @@ tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
     return TRUE;
   }
 
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
   return mux->write_func (buf, mux->write_func_data, pcr);
 }
 
+static gboolean
+tsmux_packet_out_direct (TsMux * mux, guint8 * packet, gint64 pcr)
+{
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
+  return mux->packet_write_func (packet, mux->packet_func_data, pcr);
+}
+
+/* Duration of @n_bytes of output at the configured bitrate, in PCR units */
+static inline gint64
+tsmux_bytes_to_pcr (TsMux * mux, guint64 n_bytes)
+{
+  return gst_util_uint64_scale (n_bytes * 8, TSMUX_SYS_CLOCK_FREQ,
+      mux->bitrate);
+}
+
+/* PCR value for a packet starting at the current output position */
+static inline gint64
+tsmux_get_byte_pcr (TsMux * mux)
+{
+  return mux->first_pcr + tsmux_bytes_to_pcr (mux,
+      mux->n_bytes + TSMUX_PCR_BYTE_OFFSET);
+}
+
+/* Write a packet without payload: a PCR only packet described by @pi, or
+ * a null packet if @pi is NULL */
+static gboolean
+tsmux_write_stuffing_packet (TsMux * mux, TsMuxPacketInfo * pi, gint64 pcr)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  guint payload_len, payload_offs;
+  guint8 *packet;
+  gboolean res = TRUE;
+
+  if (mux->packet_alloc_func) {
+    packet = mux->packet_alloc_func (mux->packet_func_data);
+    if (G_UNLIKELY (packet == NULL))
+      return FALSE;
+  } else {
+    if (!tsmux_get_buffer (mux, &buf))
+      return FALSE;
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    packet = map.data;
+  }
+
+  if (pi) {
+    res = tsmux_write_ts_header (packet, pi, &payload_len, &payload_offs);
+  } else {
+    packet[0] = TSMUX_SYNC_BYTE;
+    /* null packet PID, payload only, continuity counter undefined */
+    packet[1] = 0x1f;
+    packet[2] = 0xff;
+    packet[3] = 0x10;
+    memset (packet + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  }
+
+  if (buf) {
+    gst_buffer_unmap (buf, &map);
+    if (G_UNLIKELY (!res)) {
+      gst_buffer_unref (buf);
+      return FALSE;
+    }
+    return tsmux_packet_out (mux, buf, pcr);
+  }
+
+  return res && tsmux_packet_out_direct (mux, packet, pcr);
+}
+
+/* In CBR mode, stuff the output until its position reaches @target_pcr
+ * while keeping the PCRs of @stream at the usual rate */
+static gboolean
+tsmux_pad_stream (TsMux * mux, TsMuxStream * stream, gint64 target_pcr)
+{
+  guint n_packets = 0;
+  gint64 pcr;
+
+  while ((pcr = tsmux_get_byte_pcr (mux)) < target_pcr) {
+    gboolean res;
+
+    if (stream->last_pcr == -1 ||
+        pcr - stream->last_pcr > TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ) {
+      TsMuxPacketInfo pi = { 0, };
+
+      pi.pid = stream->pi.pid;
+      pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+      pi.pcr = pcr;
+      /* no payload, so the continuity counter must not advance */
+      pi.packet_count = stream->pi.packet_count - 1;
+
+      res = tsmux_write_stuffing_packet (mux, &pi, pcr);
+      stream->last_pcr = pcr;
+    } else {
+      res = tsmux_write_stuffing_packet (mux, NULL, -1);
+    }
+
+    if (G_UNLIKELY (!res))
+      return FALSE;
+    n_packets++;
+  }
+
+  if (n_packets > 0)
+    TS_DEBUG ("Inserted %u stuffing packets", n_packets);
+
+  return TRUE;
+}
+
+/**
+ * tsmux_pad_to_ts:
+ * @mux: a #TsMux
+ * @stream: the PCR stream of a program
+ * @ts: a time in 90kHz clock units
+ *
+ * In constant bitrate mode, insert null packets until the output reaches
+ * @ts, as if the next PES packet of @stream started there. This is used at
+ * the end of the stream to keep the bitrate up to the end of the last
+ * frame. Does nothing in variable bitrate mode.
+ *
+ * Returns: TRUE if the packets could be written.
+ */
+gboolean
+tsmux_pad_to_ts (TsMux * mux, TsMuxStream * stream, gint64 ts)
+{
+  g_return_val_if_fail (mux != NULL, FALSE);
+  g_return_val_if_fail (stream != NULL, FALSE);
+
+  if (!mux->bitrate || mux->first_pcr == -1)
+    return TRUE;
+
+  return tsmux_pad_stream (mux, stream, (ts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+}
+
 /*
  * adaptation_field() {
  *   adaptation_field_length                              8 uimsbf
@@ -884,6 +1087,54 @@ tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
   return TRUE;
 }
 
+/* Write the packetized section straight into memory handed out by the
+ * packet_alloc_func, avoiding the per packet buffer and memory wrapping */
+static gboolean
+tsmux_section_write_packet_direct (TsMux * mux, TsMuxSection * section,
+    const guint8 * data)
+{
+  gsize payload_written = 0;
+  guint len = 0, offset = 0, payload_len = 0;
+  guint8 *packet;
+
+  while (section->pi.stream_avail > 0) {
+    packet = mux->packet_alloc_func (mux->packet_func_data);
+    if (G_UNLIKELY (packet == NULL))
+      return FALSE;
+
+    if (section->pi.packet_start_unit_indicator) {
+      /* We need room for a pointer byte */
+      section->pi.stream_avail++;
+
+      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
+        return FALSE;
+
+      /* Write the pointer byte */
+      packet[offset++] = 0x00;
+      payload_len = len - 1;
+    } else {
+      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
+        return FALSE;
+      payload_len = len;
+    }
+
+    memcpy (packet + offset, data + payload_written, payload_len);
+
+    TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
+        len, section->pi.stream_avail - len);
+
+    /* Push the packet without PCR */
+    if (G_UNLIKELY (!tsmux_packet_out_direct (mux, packet, -1)))
+      return FALSE;
+
+    section->pi.stream_avail -= len;
+    payload_written += payload_len;
+    section->pi.packet_start_unit_indicator = FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 tsmux_section_write_packet (GstMpegtsSectionType * type,
     TsMuxSection * section, TsMux * mux)
@@ -915,6 +1166,9 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   section->pi.stream_avail = data_size;
   payload_written = 0;
 
+  if (mux->packet_alloc_func)
+    return tsmux_section_write_packet_direct (mux, section, data);
+
   /* Wrap section data in a buffer without free function.
      The data will be freed when the GstMpegtsSection is destroyed. */
   section_buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
@@ -1061,6 +1315,37 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
           (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
     }
 
+    if (mux->bitrate && cur_pts != G_MININT64) {
+      gint64 late;
+
+      if (mux->first_pcr == -1)
+        mux->first_pcr = cur_pcr - tsmux_bytes_to_pcr (mux,
+            mux->n_bytes + TSMUX_PCR_BYTE_OFFSET);
+
+      if (!tsmux_pad_stream (mux, stream, cur_pcr))
+        return FALSE;
+
+      /* PCR running past the DTS means the data does not fit the bitrate.
+       * Once behind, this happens for every PES, so only warn once */
+      late = tsmux_get_byte_pcr (mux) - cur_pcr;
+      if (late > TSMUX_PCR_OFFSET * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)) {
+        if (!mux->warned_late) {
+          GST_WARNING ("Output is %" G_GINT64_FORMAT " ms late, bitrate %"
+              G_GUINT64_FORMAT " is too low", late / (TSMUX_SYS_CLOCK_FREQ /
+                  1000), mux->bitrate);
+          mux->warned_late = TRUE;
+        } else {
+          GST_DEBUG ("Output is %" G_GINT64_FORMAT " ms late",
+              late / (TSMUX_SYS_CLOCK_FREQ / 1000));
+        }
+      }
+    }
+
+    /* in CBR mode PCRs follow the output position, so decide on the next
+     * one with the same clock as the previous ones */
+    if (mux->bitrate && mux->first_pcr != -1)
+      cur_pcr = tsmux_get_byte_pcr (mux);
+
     /* Need to decide whether to write a new PCR in this packet */
     if (stream->last_pcr == -1 ||
         (cur_pcr - stream->last_pcr >
@@ -1132,6 +1417,36 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
+  /* in CBR mode the PCR follows the position of the packet in the output,
+   * which is only known once the tables above have been written */
+  if (mux->bitrate && mux->first_pcr != -1 &&
+      (pi->flags & TSMUX_PACKET_FLAG_WRITE_PCR)) {
+    cur_pcr = tsmux_get_byte_pcr (mux);
+    pi->pcr = cur_pcr;
+    stream->last_pcr = cur_pcr;
+  }
+
+  if (mux->packet_alloc_func) {
+    guint8 *packet = mux->packet_alloc_func (mux->packet_func_data);
+
+    if (G_UNLIKELY (packet == NULL))
+      return FALSE;
+
+    if (!tsmux_write_ts_header (packet, pi, &payload_len, &payload_offs))
+      return FALSE;
+
+    if (!tsmux_stream_get_data (stream, packet + payload_offs, payload_len))
+      return FALSE;
+
+    GST_DEBUG ("Writing PES of size %d", TSMUX_PACKET_LENGTH);
+    res = tsmux_packet_out_direct (mux, packet, cur_pcr);
+
+    /* Reset all dynamic flags */
+    stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
+
+    return res;
+  }
+
   /* obtain buffer */
   if (!tsmux_get_buffer (mux, &buf))
     return FALSE;
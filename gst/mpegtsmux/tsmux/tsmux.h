@@ -102,6 +102,8 @@ typedef struct TsMux TsMux;
 
 typedef gboolean (*TsMuxWriteFunc) (GstBuffer * buf, void *user_data, gint64 new_pcr);
 typedef void (*TsMuxAllocFunc) (GstBuffer ** buf, void *user_data);
+typedef guint8 * (*TsMuxPacketAllocFunc) (void *user_data);
+typedef gboolean (*TsMuxPacketWriteFunc) (guint8 * data, void *user_data, gint64 new_pcr);
 
 struct TsMuxSection {
   TsMuxPacketInfo pi;
@@ -175,6 +177,20 @@ struct TsMux {
   /* callback to alloc new packet buffer */
   TsMuxAllocFunc alloc_func;
   void *alloc_func_data;
+  /* optional callbacks writing packets straight into caller owned memory,
+   * used instead of alloc_func/write_func when set */
+  TsMuxPacketAllocFunc packet_alloc_func;
+  TsMuxPacketWriteFunc packet_write_func;
+  void *packet_func_data;
+
+  /* constant mux rate in bits per second, 0 for VBR output */
+  guint64 bitrate;
+  /* number of bytes output so far */
+  guint64 n_bytes;
+  /* PCR at the start of the output in CBR mode, -1 if unknown yet */
+  gint64 first_pcr;
+  /* whether a warning about late output was already emitted */
+  gboolean warned_late;
 
   /* scratch space for writing ES_info descriptors */
   guint8 es_info_buf[TSMUX_MAX_ES_INFO_LENGTH];
@@ -187,11 +203,18 @@ void 		tsmux_free 			(TsMux *mux);
 /* Setting muxing session properties */
 void 		tsmux_set_write_func 		(TsMux *mux, TsMuxWriteFunc func, void *user_data);
 void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data);
+void 		tsmux_set_packet_funcs 		(TsMux *mux, TsMuxPacketAllocFunc alloc_func,
+						 TsMuxPacketWriteFunc write_func, void *user_data);
+void 		tsmux_set_bitrate 		(TsMux *mux, guint64 bitrate);
+guint64 	tsmux_get_bitrate 		(TsMux *mux);
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
 void 		tsmux_resend_pat                (TsMux *mux);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
 
+/* constant bitrate output */
+gboolean	tsmux_pad_to_ts			(TsMux *mux, TsMuxStream *stream, gint64 ts);
+
 /* pid/program management */
 TsMuxProgram *	tsmux_program_new 		(TsMux *mux, gint prog_id);
 void 		tsmux_program_free 		(TsMuxProgram *program);
@@ -116,9 +116,17 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_READ_AHEAD,
+  PROP_STATS
 };
 
+#define DEFAULT_READ_AHEAD (64 * 1024)
+/* read-ahead blocks start at multiples of this if they can */
+#define READ_AHEAD_ALIGN 4096
+/* 16 byte key and BER encoded length of at most 9 bytes */
+#define KLV_HEADER_MAX_SIZE (16 + 9)
+
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static gboolean gst_mxf_demux_src_event (GstPad * pad, GstObject * parent,
@@ -260,6 +268,14 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
   }
 
   gst_adapter_clear (demux->adapter);
+  gst_buffer_replace (&demux->read_ahead_buffer, NULL);
+  demux->read_ahead_offset = 0;
+
+  GST_OBJECT_LOCK (demux);
+  demux->n_pulls = 0;
+  demux->n_read_ahead_hits = 0;
+  demux->bytes_pulled = 0;
+  GST_OBJECT_UNLOCK (demux);
 
   gst_mxf_demux_remove_pads (demux);
 
@@ -302,12 +318,111 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
 }
 
 static GstFlowReturn
-gst_mxf_demux_pull_range (GstMXFDemux * demux, guint64 offset,
+gst_mxf_demux_pull_range_upstream (GstMXFDemux * demux, guint64 offset,
     guint size, GstBuffer ** buffer)
 {
   GstFlowReturn ret;
 
   ret = gst_pad_pull_range (demux->sinkpad, offset, size, buffer);
+
+  GST_OBJECT_LOCK (demux);
+  demux->n_pulls++;
+  if (ret == GST_FLOW_OK && *buffer)
+    demux->bytes_pulled += gst_buffer_get_size (*buffer);
+  GST_OBJECT_UNLOCK (demux);
+
+  return ret;
+}
+
+static gboolean
+gst_mxf_demux_read_ahead_contains (GstMXFDemux * demux, guint64 offset,
+    guint size)
+{
+  return demux->read_ahead_buffer && offset >= demux->read_ahead_offset
+      && offset + size <= demux->read_ahead_offset +
+      gst_buffer_get_size (demux->read_ahead_buffer);
+}
+
+/* Replaces the read-ahead block by @size bytes from @offset */
+static void
+gst_mxf_demux_fill_read_ahead (GstMXFDemux * demux, guint64 offset,
+    guint size)
+{
+  GstBuffer *buffer = NULL;
+
+  gst_buffer_replace (&demux->read_ahead_buffer, NULL);
+  if (gst_mxf_demux_pull_range_upstream (demux, offset, size,
+          &buffer) != GST_FLOW_OK)
+    return;
+
+  GST_LOG_OBJECT (demux, "Read ahead %" G_GSIZE_FORMAT " bytes at offset %"
+      G_GUINT64_FORMAT, gst_buffer_get_size (buffer), offset);
+  demux->read_ahead_buffer = buffer;
+  demux->read_ahead_offset = offset;
+}
+
+static GstFlowReturn
+gst_mxf_demux_pull_range (GstMXFDemux * demux, guint64 offset,
+    guint size, GstBuffer ** buffer)
+{
+  GstFlowReturn ret;
+
+  /* Serve small reads, like KLV keys and lengths, from one larger block
+   * instead of pulling each of them from upstream */
+  if (size < demux->read_ahead) {
+    if (!gst_mxf_demux_read_ahead_contains (demux, offset, size)) {
+      guint64 start = offset - offset % READ_AHEAD_ALIGN;
+
+      if (offset - start + size > demux->read_ahead)
+        start = offset;
+      gst_mxf_demux_fill_read_ahead (demux, start, demux->read_ahead);
+    }
+
+    if (gst_mxf_demux_read_ahead_contains (demux, offset, size)) {
+      *buffer = gst_buffer_copy_region (demux->read_ahead_buffer,
+          GST_BUFFER_COPY_MEMORY, offset - demux->read_ahead_offset, size);
+
+      GST_OBJECT_LOCK (demux);
+      demux->n_read_ahead_hits++;
+      GST_OBJECT_UNLOCK (demux);
+
+      return GST_FLOW_OK;
+    }
+  }
+
+  /* Pull values that don't fit into a block together with the key and length
+   * of the next KLV packet, and keep a copy of those as block. The value
+   * itself must not stay shared with the block, or downstream would have to
+   * copy it when mapping it for writing */
+  if (demux->read_ahead > 0 && size >= demux->read_ahead
+      && size <= G_MAXUINT - KLV_HEADER_MAX_SIZE) {
+    GstBuffer *block = NULL;
+
+    ret = gst_mxf_demux_pull_range_upstream (demux, offset,
+        size + KLV_HEADER_MAX_SIZE, &block);
+    if (ret == GST_FLOW_OK && gst_buffer_get_size (block) >= size) {
+      gsize rest = gst_buffer_get_size (block) - size;
+
+      GST_LOG_OBJECT (demux, "Read ahead %" G_GSIZE_FORMAT " bytes at offset %"
+          G_GUINT64_FORMAT, rest, offset + size);
+      gst_buffer_replace (&demux->read_ahead_buffer, NULL);
+      if (rest > 0) {
+        demux->read_ahead_buffer = gst_buffer_copy_region (block,
+            GST_BUFFER_COPY_MEMORY | GST_BUFFER_COPY_DEEP, size, rest);
+        demux->read_ahead_offset = offset + size;
+        gst_buffer_resize (block, 0, size);
+      }
+
+      *buffer = block;
+      return GST_FLOW_OK;
+    }
+
+    /* e.g. sources failing reads beyond the end, try without the header */
+    if (block)
+      gst_buffer_unref (block);
+  }
+
+  ret = gst_mxf_demux_pull_range_upstream (demux, offset, size, buffer);
   if (G_UNLIKELY (ret != GST_FLOW_OK)) {
     GST_WARNING_OBJECT (demux,
         "failed when pulling %u bytes from offset %" G_GUINT64_FORMAT ": %s",
@@ -2388,6 +2503,12 @@ gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
 
   g_assert (filesize > 4);
 
+  /* The random index pack, and often the footer partition, are at the end
+   * of the file: get them all at once */
+  if (demux->read_ahead > 0)
+    gst_mxf_demux_fill_read_ahead (demux,
+        filesize - MIN (filesize, demux->read_ahead), demux->read_ahead);
+
   buffer = NULL;
   if (gst_mxf_demux_pull_range (demux, filesize - 4, 4, &buffer) != GST_FLOW_OK) {
     GST_DEBUG_OBJECT (demux, "Failed pulling last 4 bytes");
@@ -3693,7 +3814,7 @@ collect_index_table_segments (GstMXFDemux * demux)
   for (l = demux->pending_index_table_segments; l; l = l->next) {
     MXFIndexTableSegment *segment = l->data;
     GstMXFDemuxIndexTable *t = NULL;
-    GList *k;
+    GList *k, *partition_hint;
     guint64 start, end;
 
     for (k = demux->index_tables; k; k = k->next) {
@@ -3726,13 +3847,24 @@ collect_index_table_segments (GstMXFDemux * demux)
     if (t->offsets->len < end)
       g_array_set_size (t->offsets, end);
 
+    partition_hint = NULL;
     for (i = 0; i < segment->n_index_entries && start + i < t->offsets->len;
         i++) {
       guint64 offset = segment->index_entries[i].stream_offset;
       GList *m;
       GstMXFDemuxPartition *offset_partition = NULL, *next_partition = NULL;
 
-      for (m = demux->partitions; m; m = m->next) {
+      /* Entries are usually in stream order, so continue the search from
+       * the partition of the previous entry instead of the first one */
+      m = demux->partitions;
+      if (partition_hint) {
+        GstMXFDemuxPartition *hint = partition_hint->data;
+
+        if (offset >= hint->partition.body_offset)
+          m = partition_hint;
+      }
+
+      for (; m; m = m->next) {
         GstMXFDemuxPartition *partition = m->data;
 
         if (!next_partition && offset_partition)
@@ -3744,6 +3876,7 @@ collect_index_table_segments (GstMXFDemux * demux)
           break;
 
         offset_partition = partition;
+        partition_hint = m;
         next_partition = NULL;
       }
 
@@ -4549,6 +4682,9 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_READ_AHEAD:
+      demux->read_ahead = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4568,6 +4704,17 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_READ_AHEAD:
+      g_value_set_uint (value, demux->read_ahead);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (demux);
+      g_value_take_boxed (value, gst_structure_new ("application/x-mxf-stats",
+              "pulls", G_TYPE_UINT64, demux->n_pulls,
+              "read-ahead-hits", G_TYPE_UINT64, demux->n_read_ahead_hits,
+              "bytes-pulled", G_TYPE_UINT64, demux->bytes_pulled, NULL));
+      GST_OBJECT_UNLOCK (demux);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -4662,6 +4809,35 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMXFDemux:read-ahead:
+   *
+   * In pull mode, reads smaller than this are served from blocks of this
+   * size pulled from upstream, instead of pulling every KLV key, length
+   * and small packet separately. Larger packets are pulled together with
+   * the key and length of the next one. 0 disables read-ahead.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD,
+      g_param_spec_uint ("read-ahead", "Read ahead",
+          "Size in bytes of the blocks pulled from upstream (0 = disabled)",
+          0, 16 * 1024 * 1024, DEFAULT_READ_AHEAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMXFDemux:stats:
+   *
+   * Statistics about the data pulled from upstream: the number of pulls,
+   * the number of reads served from the read-ahead block instead, and the
+   * number of bytes pulled.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Various statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
@@ -4693,6 +4869,7 @@ gst_mxf_demux_init (GstMXFDemux * demux)
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 
   demux->max_drift = 500 * GST_MSECOND;
+  demux->read_ahead = DEFAULT_READ_AHEAD;
 
   demux->adapter = gst_adapter_new ();
   demux->flowcombiner = gst_flow_combiner_new ();
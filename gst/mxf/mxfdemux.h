@@ -170,6 +170,15 @@ struct _GstMXFDemux
 
   guint64 offset;
 
+  /* pull mode: last read-ahead block and its offset */
+  GstBuffer *read_ahead_buffer;
+  guint64 read_ahead_offset;
+
+  /* protected by the object lock */
+  guint64 n_pulls;
+  guint64 n_read_ahead_hits;
+  guint64 bytes_pulled;
+
   gboolean random_access;
   gboolean flushing;
 
@@ -208,6 +217,7 @@ struct _GstMXFDemux
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  guint read_ahead;
 };
 
 struct _GstMXFDemuxClass
@@ -113,15 +113,22 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("application/mxf")
     );
 
+#define DEFAULT_PARTITION_INTERVAL 0
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_PARTITION_INTERVAL
 };
 
 #define gst_mxf_mux_parent_class parent_class
 G_DEFINE_TYPE (GstMXFMux, gst_mxf_mux, GST_TYPE_AGGREGATOR);
 
 static void gst_mxf_mux_finalize (GObject * object);
+static void gst_mxf_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_mxf_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static GstFlowReturn gst_mxf_mux_aggregate (GstAggregator * aggregator,
     gboolean timeout);
@@ -163,6 +170,33 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gstaggregator_class = (GstAggregatorClass *) klass;
 
   gobject_class->finalize = gst_mxf_mux_finalize;
+  gobject_class->set_property = gst_mxf_mux_set_property;
+  gobject_class->get_property = gst_mxf_mux_get_property;
+
+  /**
+   * GstMXFMux:partition-interval:
+   *
+   * Start a new body partition at the first keyframe after this much
+   * time has passed since the previous one. The index table segments of
+   * the essence written since then are placed in the new partition and
+   * released, which keeps memory usage bounded for long recordings and
+   * makes the index available while the file is still being written.
+   * 0 writes a single body partition and the complete index in the
+   * footer.
+   *
+   * Frames that are displayed before the partition they are stored in,
+   * like leading B-frames of open GOPs, can't set the temporal offsets of
+   * index entries that were already written with the previous partition.
+   * A warning is logged and those entries keep a temporal offset of 0.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PARTITION_INTERVAL,
+      g_param_spec_uint64 ("partition-interval", "Partition Interval",
+          "Minimum duration of body partitions, index table segments are "
+          "written at each new partition (0 = single body partition)", 0,
+          G_MAXUINT64, DEFAULT_PARTITION_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstaggregator_class->create_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_create_new_pad);
@@ -190,7 +224,10 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
 static void
 gst_mxf_mux_init (GstMXFMux * mux)
 {
-  mux->index_table = g_array_new (FALSE, FALSE, sizeof (MXFIndexTableSegment));
+  mux->index_entries = g_array_new (FALSE, TRUE, sizeof (MXFIndexEntry));
+  mux->partitions =
+      g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  mux->partition_interval = DEFAULT_PARTITION_INTERVAL;
   gst_mxf_mux_reset (mux);
 }
 
@@ -208,23 +245,59 @@ gst_mxf_mux_finalize (GObject * object)
     mux->metadata_list = NULL;
   }
 
-  if (mux->index_table) {
-    gsize n;
-    for (n = 0; n < mux->index_table->len; ++n)
-      g_free (g_array_index (mux->index_table, MXFIndexTableSegment,
-              n).index_entries);
-    g_array_free (mux->index_table, TRUE);
-    mux->index_table = NULL;
+  if (mux->index_entries) {
+    g_array_free (mux->index_entries, TRUE);
+    mux->index_entries = NULL;
+  }
+
+  if (mux->partitions) {
+    g_array_free (mux->partitions, TRUE);
+    mux->partitions = NULL;
   }
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_mxf_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMXFMux *mux = GST_MXF_MUX (object);
+
+  switch (prop_id) {
+    case PROP_PARTITION_INTERVAL:
+      GST_OBJECT_LOCK (mux);
+      mux->partition_interval = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_mxf_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstMXFMux *mux = GST_MXF_MUX (object);
+
+  switch (prop_id) {
+    case PROP_PARTITION_INTERVAL:
+      GST_OBJECT_LOCK (mux);
+      g_value_set_uint64 (value, mux->partition_interval);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_mxf_mux_reset (GstMXFMux * mux)
 {
   GList *l;
-  gsize n;
 
   GST_OBJECT_LOCK (mux);
   for (l = GST_ELEMENT_CAST (mux)->sinkpads; l; l = l->next) {
@@ -261,13 +334,12 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_position = 0;
   mux->offset = 0;
 
-  if (mux->index_table)
-    for (n = 0; n < mux->index_table->len; ++n)
-      g_free (g_array_index (mux->index_table, MXFIndexTableSegment,
-              n).index_entries);
-  g_array_set_size (mux->index_table, 0);
-  mux->current_index_pos = 0;
+  g_array_set_size (mux->index_entries, 0);
+  mux->index_start_position = 0;
   mux->last_keyframe_pos = 0;
+
+  g_array_set_size (mux->partitions, 0);
+  mux->last_partition_timestamp = 0;
 }
 
 static gboolean
@@ -1200,6 +1272,111 @@ gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
   return ret;
 }
 
+static MXFIndexEntry *
+gst_mxf_mux_get_index_entry (GstMXFMux * mux, guint64 position)
+{
+  guint i = position - mux->index_start_position;
+
+  /* New entries are zero-initialized */
+  if (i >= mux->index_entries->len)
+    g_array_set_size (mux->index_entries, i + 1);
+
+  return &g_array_index (mux->index_entries, MXFIndexEntry, i);
+}
+
+/* Converts the index entries of all edit units of the first essence stream
+ * that were written so far into index table segments and removes them.
+ * Entries after that only carry temporal offsets and are kept. */
+static GList *
+gst_mxf_mux_take_index_table_segments (GstMXFMux * mux,
+    guint * index_byte_count)
+{
+  GstMXFMuxPad *pad = GST_ELEMENT_CAST (mux)->sinkpads->data;
+  const guint max_segment_size = G_MAXUINT16 / 11;
+  MXFMetadataEssenceContainerData *ecd =
+      mux->preface->content_storage->essence_container_data[0];
+  GList *segments = NULL;
+  guint n_entries, i;
+
+  n_entries = pad->pos - mux->index_start_position;
+  g_assert (n_entries <= mux->index_entries->len);
+
+  for (i = 0; i < n_entries; i += max_segment_size) {
+    MXFIndexTableSegment segment;
+    GstBuffer *buf;
+
+    memset (&segment, 0, sizeof (segment));
+
+    mxf_uuid_init (&segment.instance_id, mux->metadata);
+    memcpy (&segment.index_edit_rate, &pad->source_track->edit_rate,
+        sizeof (segment.index_edit_rate));
+    segment.index_start_position = mux->index_start_position + i;
+    segment.index_duration = MIN (n_entries - i, max_segment_size);
+    segment.index_sid = ecd->index_sid;
+    segment.body_sid = ecd->body_sid;
+    segment.n_index_entries = segment.index_duration;
+    segment.index_entries =
+        &g_array_index (mux->index_entries, MXFIndexEntry, i);
+
+    buf = mxf_index_table_segment_to_buffer (&segment);
+    *index_byte_count += gst_buffer_get_size (buf);
+    segments = g_list_prepend (segments, buf);
+  }
+
+  g_array_remove_range (mux->index_entries, 0, n_entries);
+  mux->index_start_position += n_entries;
+
+  return g_list_reverse (segments);
+}
+
+static GstFlowReturn
+gst_mxf_mux_write_body_partition (GstMXFMux * mux)
+{
+  MXFRandomIndexPackEntry entry;
+  GList *segments, *l;
+  guint index_byte_count = 0;
+  GstFlowReturn ret;
+  GstBuffer *buf;
+
+  segments = gst_mxf_mux_take_index_table_segments (mux, &index_byte_count);
+
+  /* body_offset is kept, it is the essence stream offset at which this
+   * partition starts */
+  mux->partition.type = MXF_PARTITION_PACK_BODY;
+  mux->partition.closed = TRUE;
+  mux->partition.complete = TRUE;
+  mux->partition.prev_partition = mux->partition.this_partition;
+  mux->partition.this_partition = mux->offset;
+  mux->partition.footer_partition = 0;
+  mux->partition.header_byte_count = 0;
+  mux->partition.index_byte_count = index_byte_count;
+  mux->partition.index_sid = segments ?
+      mux->preface->content_storage->essence_container_data[0]->index_sid : 0;
+  mux->partition.body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+
+  entry.offset = mux->partition.this_partition;
+  entry.body_sid = mux->partition.body_sid;
+  g_array_append_val (mux->partitions, entry);
+
+  GST_DEBUG_OBJECT (mux, "Writing body partition at offset %" G_GUINT64_FORMAT
+      " with %u bytes of index table segments", mux->partition.this_partition,
+      index_byte_count);
+
+  buf = mxf_partition_pack_to_buffer (&mux->partition);
+  ret = gst_mxf_mux_push (mux, buf);
+
+  for (l = segments; l; l = l->next) {
+    if (ret == GST_FLOW_OK)
+      ret = gst_mxf_mux_push (mux, l->data);
+    else
+      gst_buffer_unref (l->data);
+  }
+  g_list_free (segments);
+
+  return ret;
+}
+
 static const guint8 _gc_essence_element_ul[] = {
   0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
@@ -1267,54 +1444,29 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
 
   /* We currently only index the first essence stream */
   if (pad == (GstMXFMuxPad *) GST_ELEMENT_CAST (mux)->sinkpads->data) {
-    MXFIndexTableSegment *segment;
-    const gint max_segment_size = G_MAXUINT16 / 11;
-
-    if (mux->index_table->len == 0 ||
-        g_array_index (mux->index_table, MXFIndexTableSegment,
-            mux->current_index_pos).index_duration >= max_segment_size) {
-
-      if (mux->index_table->len > 0)
-        mux->current_index_pos++;
-
-      if (mux->index_table->len <= mux->current_index_pos) {
-        MXFIndexTableSegment s;
-
-        memset (&segment, 0, sizeof (segment));
-
-        mxf_uuid_init (&s.instance_id, mux->metadata);
-        memcpy (&s.index_edit_rate, &pad->source_track->edit_rate,
-            sizeof (s.index_edit_rate));
-        if (mux->index_table->len > 0)
-          s.index_start_position =
-              g_array_index (mux->index_table, MXFIndexTableSegment,
-              mux->index_table->len - 1).index_start_position;
-        else
-          s.index_start_position = 0;
-        s.index_duration = 0;
-        s.edit_unit_byte_count = 0;
-        s.index_sid =
-            mux->preface->content_storage->essence_container_data[0]->index_sid;
-        s.body_sid =
-            mux->preface->content_storage->essence_container_data[0]->body_sid;
-        s.slice_count = 0;
-        s.pos_table_count = 0;
-        s.n_delta_entries = 0;
-        s.delta_entries = NULL;
-        s.n_index_entries = 0;
-        s.index_entries = g_new0 (MXFIndexEntry, max_segment_size);
-        g_array_append_val (mux->index_table, s);
+    MXFIndexEntry *entry;
+    GstClockTime partition_interval;
+
+    GST_OBJECT_LOCK (mux);
+    partition_interval = mux->partition_interval;
+    GST_OBJECT_UNLOCK (mux);
+
+    if (partition_interval > 0 && is_keyframe
+        && pad->last_timestamp >=
+        mux->last_partition_timestamp + partition_interval) {
+      ret = gst_mxf_mux_write_body_partition (mux);
+      if (ret != GST_FLOW_OK) {
+        GST_ERROR_OBJECT (mux, "Failed pushing body partition, reason %s",
+            gst_flow_get_name (ret));
+        gst_buffer_unref (buf);
+        return ret;
       }
+      mux->last_partition_timestamp = pad->last_timestamp;
     }
-    segment =
-        &g_array_index (mux->index_table, MXFIndexTableSegment,
-        mux->current_index_pos);
 
     if (dts != GST_CLOCK_TIME_NONE && pts != GST_CLOCK_TIME_NONE) {
       guint64 pts_pos;
-      guint64 pts_index_pos, pts_segment_pos;
       gint64 index_pos_diff;
-      MXFIndexTableSegment *pts_segment;
 
       pts =
           gst_segment_to_running_time (&pad->parent.segment, GST_FORMAT_TIME,
@@ -1324,78 +1476,28 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
           pad->source_track->edit_rate.d * GST_SECOND);
 
       index_pos_diff = pts_pos - pad->pos;
-      pts_index_pos = mux->current_index_pos;
-      pts_segment_pos = segment->n_index_entries;
-      if (index_pos_diff >= 0) {
-        while (pts_segment_pos + index_pos_diff >= max_segment_size) {
-          index_pos_diff -= max_segment_size - pts_segment_pos;
-          pts_segment_pos = 0;
-          pts_index_pos++;
-
-          if (pts_index_pos >= mux->index_table->len) {
-            MXFIndexTableSegment s;
-
-            memset (&segment, 0, sizeof (segment));
-
-            mxf_uuid_init (&s.instance_id, mux->metadata);
-            memcpy (&s.index_edit_rate, &pad->source_track->edit_rate,
-                sizeof (s.index_edit_rate));
-            if (mux->index_table->len > 0)
-              s.index_start_position =
-                  g_array_index (mux->index_table, MXFIndexTableSegment,
-                  mux->index_table->len - 1).index_start_position;
-            else
-              s.index_start_position = 0;
-            s.index_duration = 0;
-            s.edit_unit_byte_count = 0;
-            s.index_sid =
-                mux->preface->content_storage->
-                essence_container_data[0]->index_sid;
-            s.body_sid =
-                mux->preface->content_storage->
-                essence_container_data[0]->body_sid;
-            s.slice_count = 0;
-            s.pos_table_count = 0;
-            s.n_delta_entries = 0;
-            s.delta_entries = NULL;
-            s.n_index_entries = 0;
-            s.index_entries = g_new0 (MXFIndexEntry, max_segment_size);
-            g_array_append_val (mux->index_table, s);
-          }
-        }
+      if (index_pos_diff < -127 || index_pos_diff > 127) {
+        GST_WARNING_OBJECT (pad, "Temporal offset %" G_GINT64_FORMAT
+            " out of range", index_pos_diff);
+      } else if (pts_pos < mux->index_start_position) {
+        /* e.g. leading B-frames of the first GOP of this partition, which
+         * belong to the index table segments written before it */
+        GST_WARNING_OBJECT (pad, "Index entry for position %" G_GUINT64_FORMAT
+            " was already written", pts_pos);
       } else {
-        while (pts_segment_pos + index_pos_diff <= 0) {
-          if (pts_index_pos == 0) {
-            pts_index_pos = G_MAXUINT64;
-            break;
-          }
-          index_pos_diff += pts_segment_pos;
-          pts_segment_pos = max_segment_size;
-          pts_index_pos--;
-        }
-      }
-      if (pts_index_pos != G_MAXUINT64) {
-        g_assert (index_pos_diff < 127 && index_pos_diff >= -127);
-        pts_segment =
-            &g_array_index (mux->index_table, MXFIndexTableSegment,
-            pts_index_pos);
-        pts_segment->index_entries[pts_segment_pos +
-            index_pos_diff].temporal_offset = -index_pos_diff;
+        entry = gst_mxf_mux_get_index_entry (mux, pts_pos);
+        entry->temporal_offset = -index_pos_diff;
       }
     }
 
     /* Leave temporal offset initialized at 0, above code will set it as necessary */
-    ;
     if (is_keyframe)
       mux->last_keyframe_pos = pad->pos;
-    segment->index_entries[segment->n_index_entries].key_frame_offset =
-        MIN (pad->pos - mux->last_keyframe_pos, 127);
-    segment->index_entries[segment->n_index_entries].flags = is_keyframe ? 0x80 : 0x20; /* FIXME: Need to distinguish all the cases */
-    segment->index_entries[segment->n_index_entries].stream_offset =
-        mux->partition.body_offset;
-
-    segment->n_index_entries++;
-    segment->index_duration++;
+    entry = gst_mxf_mux_get_index_entry (mux, pad->pos);
+    entry->key_frame_offset = MIN (pad->pos - mux->last_keyframe_pos, 127);
+    /* FIXME: Need to distinguish all the cases */
+    entry->flags = is_keyframe ? 0x80 : 0x20;
+    entry->stream_offset = mux->partition.body_offset;
   }
 
   buf_size = gst_buffer_get_size (buf);
@@ -1428,28 +1530,6 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
   return ret;
 }
 
-static GstFlowReturn
-gst_mxf_mux_write_body_partition (GstMXFMux * mux)
-{
-  GstBuffer *buf;
-
-  mux->partition.type = MXF_PARTITION_PACK_BODY;
-  mux->partition.closed = TRUE;
-  mux->partition.complete = TRUE;
-  mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
-  mux->partition.footer_partition = 0;
-  mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
-  mux->partition.body_sid =
-      mux->preface->content_storage->essence_container_data[0]->body_sid;
-
-  buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
-}
-
 static GstFlowReturn
 gst_mxf_mux_handle_eos (GstMXFMux * mux)
 {
@@ -1565,25 +1645,19 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
 
   {
     guint64 body_partition = mux->partition.this_partition;
-    guint32 body_sid = mux->partition.body_sid;
+    guint64 first_body_partition =
+        g_array_index (mux->partitions, MXFRandomIndexPackEntry, 0).offset;
     guint64 footer_partition = mux->offset;
     GArray *rip;
     GstFlowReturn ret;
     GstSegment segment;
     MXFRandomIndexPackEntry entry;
-    GList *index_entries = NULL, *l;
+    GList *index_entries, *l;
     guint index_byte_count = 0;
-    guint i;
     GstBuffer *buf;
 
-    for (i = 0; i < mux->index_table->len; i++) {
-      MXFIndexTableSegment *segment =
-          &g_array_index (mux->index_table, MXFIndexTableSegment, i);
-      GstBuffer *segment_buffer = mxf_index_table_segment_to_buffer (segment);
-
-      index_byte_count += gst_buffer_get_size (segment_buffer);
-      index_entries = g_list_prepend (index_entries, segment_buffer);
-    }
+    index_entries =
+        gst_mxf_mux_take_index_table_segments (mux, &index_byte_count);
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
@@ -1600,7 +1674,6 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
 
     gst_mxf_mux_write_header_metadata (mux);
 
-    index_entries = g_list_reverse (index_entries);
     for (l = index_entries; l; l = l->next) {
       if ((ret = gst_mxf_mux_push (mux, l->data)) != GST_FLOW_OK) {
         GST_ERROR_OBJECT (mux, "Failed pushing index table segment");
@@ -1608,13 +1681,12 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     }
     g_list_free (index_entries);
 
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
+    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry),
+        mux->partitions->len + 2);
     entry.offset = 0;
     entry.body_sid = 0;
     g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
+    g_array_append_vals (rip, mux->partitions->data, mux->partitions->len);
     entry.offset = footer_partition;
     entry.body_sid = 0;
     g_array_append_val (rip, entry);
@@ -1648,7 +1720,7 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
         return ret;
       }
 
-      g_assert (mux->offset == body_partition);
+      g_assert (mux->offset == first_body_partition);
 
       mux->partition.type = MXF_PARTITION_PACK_BODY;
       mux->partition.closed = TRUE;
@@ -69,9 +69,17 @@ typedef struct _GstMXFMux {
 
   gchar *application;
 
-  GArray *index_table;
-  guint current_index_pos;
+  /* MXFIndexEntry for the first essence stream that were not written
+   * yet, the first one is for edit unit index_start_position */
+  GArray *index_entries;
+  guint64 index_start_position;
   guint64 last_keyframe_pos;
+
+  /* MXFRandomIndexPackEntry for all partitions written so far */
+  GArray *partitions;
+  GstClockTime last_partition_timestamp;
+
+  GstClockTime partition_interval;
 } GstMXFMux;
 
 typedef struct _GstMXFMuxClass {
@@ -161,6 +161,7 @@ static void
 gst_h264_parse_init (GstH264Parse * h264parse)
 {
   h264parse->frame_out = gst_adapter_new ();
+  h264parse->in_place_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (h264parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (h264parse));
   GST_PAD_SET_ACCEPT_TEMPLATE (GST_BASE_PARSE_SINK_PAD (h264parse));
@@ -176,6 +177,7 @@ gst_h264_parse_finalize (GObject * object)
   GstH264Parse *h264parse = GST_H264_PARSE (object);
 
   g_object_unref (h264parse->frame_out);
+  g_array_free (h264parse->in_place_sizes, TRUE);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -197,6 +199,8 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->frame_start = FALSE;
   h264parse->aud_insert = TRUE;
   gst_adapter_clear (h264parse->frame_out);
+  h264parse->in_place_pos = 0;
+  g_array_set_size (h264parse->in_place_sizes, 0);
 }
 
 static void
@@ -418,35 +422,65 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+/* Writes the prefix of a NAL of @size bytes in @format to @prefix and
+ * returns its length */
+static guint
+gst_h264_parse_nal_prefix (GstH264Parse * h264parse, guint format,
+    guint size, guint8 prefix[4])
 {
-  GstBuffer *buf;
   guint nl = h264parse->nal_length_size;
-  guint32 tmp;
 
-  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
-
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    GST_WRITE_UINT32_BE (prefix, size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work. 
      * There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    GST_WRITE_UINT32_BE (prefix, 1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, prefix);
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
+/* Like gst_h264_parse_wrap_nal(), but shares the memory of the @size bytes
+ * of NAL at @offset in @buffer instead of copying them */
+static GstBuffer *
+gst_h264_parse_wrap_nal_shared (GstH264Parse * h264parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, prefix);
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
+
+  return gst_buffer_append_region (buf, gst_buffer_ref (buffer), offset, size);
+}
+
 static void
 gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     GstH264NalUnitType naltype, GstH264NalUnit * nalu)
@@ -834,8 +868,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       {
         GstH264SliceHdr slice;
 
-        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
-            FALSE, FALSE);
+        pres = gst_h264_parser_parse_slice_hdr_light (nalparser, nalu,
+            &slice);
         GST_DEBUG_OBJECT (h264parse,
             "parse result %d, first MB: %u, slice type: %u",
             pres, slice.first_mb_in_slice, slice.type);
@@ -892,10 +926,29 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
    * and use that to replace outgoing buffer data later on */
   if (h264parse->transform) {
     GstBuffer *buf;
+    guint8 prefix[4];
+
+    /* the output only differs in the NAL prefixes as long as the NALs follow
+     * each other from the frame start with prefixes of the output size */
+    if (h264parse->nal_buffer && !h264parse->split_packetized &&
+        h264parse->in_place_pos == nalu->sc_offset &&
+        nalu->offset - nalu->sc_offset ==
+        gst_h264_parse_nal_prefix (h264parse, h264parse->format, nalu->size,
+            prefix)) {
+      g_array_append_val (h264parse->in_place_sizes, nalu->size);
+      h264parse->in_place_pos = nalu->offset + nalu->size;
+    } else {
+      h264parse->in_place_pos = -1;
+    }
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (h264parse->nal_buffer) {
+      buf = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format,
+          h264parse->nal_buffer, nalu->offset, nalu->size);
+    } else {
+      buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
+          nalu->data + nalu->offset, nalu->size);
+    }
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -993,7 +1046,9 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
+    h264parse->nal_buffer = buffer;
     gst_h264_parse_process_nal (h264parse, &nalu);
+    h264parse->nal_buffer = NULL;
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1067,7 +1122,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
   GstH264ParserResult pres;
   gint framesize;
   GstFlowReturn ret;
-  gboolean au_complete;
+  gboolean au_complete, processed;
 
   if (G_UNLIKELY (GST_BUFFER_FLAG_IS_SET (frame->buffer,
               GST_BUFFER_FLAG_DISCONT))) {
@@ -1231,7 +1286,11 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    h264parse->nal_buffer = buffer;
+    processed = gst_h264_parse_process_nal (h264parse, &nalu);
+    h264parse->nal_buffer = NULL;
+
+    if (!processed) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -1300,6 +1359,8 @@ skip:
       !(h264parse->state & GST_H264_PARSE_STATE_VALID_PICTURE_HEADERS) ||
       (h264parse->state & GST_H264_PARSE_STATE_GOT_SLICE))
     gst_h264_parse_reset_frame (h264parse);
+  else
+    h264parse->in_place_pos = -1;
   goto out;
 
 invalid_stream:
@@ -2143,6 +2204,64 @@ exit:
     h264parse->dts += *out_dur;
 }
 
+/* Converts the NALs at the start of @frame to the output format by
+ * overwriting their prefixes, provided its buffer is writable */
+static gboolean
+gst_h264_parse_transform_in_place (GstH264Parse * h264parse,
+    GstBaseParseFrame * frame)
+{
+  GstBuffer *buffer = frame->buffer;
+  GstMapInfo map;
+  guint i, pos = 0;
+
+  if (!gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  /* the collected NALs share the memory of the buffer, which would make
+   * mapping it for writing copy it */
+  gst_adapter_clear (h264parse->frame_out);
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_WRITE)) {
+    /* collect them again for converting by copying */
+    for (i = 0; i < h264parse->in_place_sizes->len; i++) {
+      guint size = g_array_index (h264parse->in_place_sizes, guint, i);
+      guint8 prefix[4];
+      GstBuffer *buf;
+      guint nl;
+
+      nl = gst_h264_parse_nal_prefix (h264parse, h264parse->format, size,
+          prefix);
+      buf = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format,
+          buffer, pos + nl, size);
+      gst_adapter_push (h264parse->frame_out, buf);
+      pos += nl + size;
+    }
+    return FALSE;
+  }
+
+  GST_LOG_OBJECT (h264parse, "rewriting %u NAL prefixes in place",
+      h264parse->in_place_sizes->len);
+
+  for (i = 0; i < h264parse->in_place_sizes->len; i++) {
+    guint size = g_array_index (h264parse->in_place_sizes, guint, i);
+    guint8 prefix[4];
+    guint nl;
+
+    nl = gst_h264_parse_nal_prefix (h264parse, h264parse->format, size,
+        prefix);
+    memcpy (map.data + pos, prefix, nl);
+    pos += nl + size;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  /* the input buffer may extend past the frame */
+  buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, 0, pos);
+  gst_buffer_replace (&frame->out_buffer, buffer);
+  gst_buffer_unref (buffer);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
@@ -2179,10 +2298,14 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 
   /* replace with transformed AVC output if applicable */
   av = gst_adapter_available (h264parse->frame_out);
-  if (av) {
+  if (av && h264parse->in_place_pos == av && (!h264parse->packetized ||
+          gst_buffer_get_size (buffer) == av) &&
+      gst_h264_parse_transform_in_place (h264parse, frame)) {
+    GST_LOG_OBJECT (h264parse, "converted frame in place");
+  } else if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2197,12 +2320,8 @@ static GstFlowReturn
 gst_h264_parse_push_codec_buffer (GstH264Parse * h264parse,
     GstBuffer * nal, GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format, nal,
+      0, gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -2332,60 +2451,40 @@ gst_h264_parse_handle_sps_pps_nals (GstH264Parse * h264parse,
       }
     }
   } else {
-    /* insert config NALs into AU */
-    GstByteWriter bw;
+    /* insert config NALs into AU, sharing the memory of the AU and of the
+     * config NALs */
     GstBuffer *new_buf;
-    const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-    const gint nls = 4 - h264parse->nal_length_size;
-    gboolean ok;
 
-    gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer), FALSE);
-    ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
     GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
+    new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+        h264parse->idr_pos);
     for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
       if ((codec_nal = h264parse->sps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
         GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
-
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+        new_buf = gst_buffer_append (new_buf,
+            gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format,
+                codec_nal, 0, gst_buffer_get_size (codec_nal)));
         send_done = TRUE;
       }
     }
     for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
       if ((codec_nal = h264parse->pps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
         GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+        new_buf = gst_buffer_append (new_buf,
+            gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format,
+                codec_nal, 0, gst_buffer_get_size (codec_nal)));
         send_done = TRUE;
       }
     }
-    ok &= gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
+    new_buf = gst_buffer_append_region (new_buf, gst_buffer_ref (buffer),
+        h264parse->idr_pos, -1);
     /* collect result and push */
-    new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
     gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     /* should already be keyframe/IDR, but it may not have been,
      * so mark it as such to avoid being discarded by picky decoder */
     GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
     gst_buffer_replace (&frame->out_buffer, new_buf);
     gst_buffer_unref (new_buf);
-    /* some result checking seems to make some compilers happy */
-    if (G_UNLIKELY (!ok)) {
-      GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-    }
   }
 
   return send_done;
@@ -2436,7 +2535,11 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (guint8 *) au_delim,
           sizeof (au_delim), 0, sizeof (au_delim), NULL, NULL);
 
-      frame->out_buffer = gst_buffer_copy (frame->buffer);
+      /* keep the converted output if there is one */
+      if (frame->out_buffer)
+        frame->out_buffer = gst_buffer_make_writable (frame->out_buffer);
+      else
+        frame->out_buffer = gst_buffer_copy (frame->buffer);
       gst_buffer_prepend_memory (frame->out_buffer, mem);
       if (h264parse->idr_pos >= 0)
         h264parse->idr_pos += sizeof (au_delim);
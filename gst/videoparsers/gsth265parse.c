@@ -137,6 +137,7 @@ static void
 gst_h265_parse_init (GstH265Parse * h265parse)
 {
   h265parse->frame_out = gst_adapter_new ();
+  h265parse->in_place_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (h265parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (h265parse));
   GST_PAD_SET_ACCEPT_TEMPLATE (GST_BASE_PARSE_SINK_PAD (h265parse));
@@ -149,6 +150,7 @@ gst_h265_parse_finalize (GObject * object)
   GstH265Parse *h265parse = GST_H265_PARSE (object);
 
   g_object_unref (h265parse->frame_out);
+  g_array_free (h265parse->in_place_sizes, TRUE);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -168,6 +170,8 @@ gst_h265_parse_reset_frame (GstH265Parse * h265parse)
   h265parse->keyframe = FALSE;
   h265parse->header = FALSE;
   gst_adapter_clear (h265parse->frame_out);
+  h265parse->in_place_pos = 0;
+  g_array_set_size (h265parse->in_place_sizes, 0);
 }
 
 static void
@@ -362,35 +366,65 @@ gst_h265_parse_negotiate (GstH265Parse * h265parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
-    guint size)
+/* Writes the prefix of a NAL of @size bytes in @format to @prefix and
+ * returns its length */
+static guint
+gst_h265_parse_nal_prefix (GstH265Parse * h265parse, guint format,
+    guint size, guint8 prefix[4])
 {
-  GstBuffer *buf;
   guint nl = h265parse->nal_length_size;
-  guint32 tmp;
 
-  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
-
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H265_PARSE_FORMAT_HVC1
       || format == GST_H265_PARSE_FORMAT_HEV1) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    GST_WRITE_UINT32_BE (prefix, size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work.
      * There are legit cases where nl in hevc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    GST_WRITE_UINT32_BE (prefix, 1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, prefix);
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
+/* Like gst_h265_parse_wrap_nal(), but shares the memory of the @size bytes
+ * of NAL at @offset in @buffer instead of copying them */
+static GstBuffer *
+gst_h265_parse_wrap_nal_shared (GstH265Parse * h265parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, prefix);
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
+
+  return gst_buffer_append_region (buf, gst_buffer_ref (buffer), offset, size);
+}
+
 static void
 gst_h265_parser_store_nal (GstH265Parse * h265parse, guint id,
     GstH265NalUnitType naltype, GstH265NalUnit * nalu)
@@ -614,7 +648,7 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     {
       GstH265SliceHdr slice;
 
-      pres = gst_h265_parser_parse_slice_hdr (nalparser, nalu, &slice);
+      pres = gst_h265_parser_parse_slice_hdr_light (nalparser, nalu, &slice);
 
       if (pres == GST_H265_PARSER_OK) {
         if (GST_H265_IS_I_SLICE (&slice))
@@ -627,8 +661,6 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
       GST_DEBUG_OBJECT (h265parse,
           "parse result %d, first slice_segment: %u, slice type: %u",
           pres, slice.first_slice_segment_in_pic_flag, slice.type);
-
-      gst_h265_slice_hdr_free (&slice);
     }
 
       is_irap = ((nal_type >= GST_H265_NAL_SLICE_BLA_W_LP)
@@ -664,10 +696,29 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
    * and use that to replace outgoing buffer data later on */
   if (h265parse->transform) {
     GstBuffer *buf;
+    guint8 prefix[4];
+
+    /* the output only differs in the NAL prefixes as long as the NALs follow
+     * each other from the frame start with prefixes of the output size */
+    if (h265parse->nal_buffer && !h265parse->split_packetized &&
+        h265parse->in_place_pos == nalu->sc_offset &&
+        nalu->offset - nalu->sc_offset ==
+        gst_h265_parse_nal_prefix (h265parse, h265parse->format, nalu->size,
+            prefix)) {
+      g_array_append_val (h265parse->in_place_sizes, nalu->size);
+      h265parse->in_place_pos = nalu->offset + nalu->size;
+    } else {
+      h265parse->in_place_pos = -1;
+    }
 
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
-    buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (h265parse->nal_buffer) {
+      buf = gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format,
+          h265parse->nal_buffer, nalu->offset, nalu->size);
+    } else {
+      buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+          nalu->data + nalu->offset, nalu->size);
+    }
     gst_adapter_push (h265parse->frame_out, buf);
   }
 }
@@ -758,7 +809,9 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h265parse, "HEVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
+    h265parse->nal_buffer = buffer;
     gst_h265_parse_process_nal (h265parse, &nalu);
+    h265parse->nal_buffer = NULL;
 
     /* dispatch per NALU if needed */
     if (h265parse->split_packetized) {
@@ -976,7 +1029,9 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
         nalu.type == GST_H265_NAL_SPS ||
         nalu.type == GST_H265_NAL_PPS ||
         (h265parse->have_sps && h265parse->have_pps)) {
+      h265parse->nal_buffer = buffer;
       gst_h265_parse_process_nal (h265parse, &nalu);
+      h265parse->nal_buffer = NULL;
     } else {
       GST_WARNING_OBJECT (h265parse,
           "no SPS/PPS yet, nal Type: %d %s, Size: %u will be dropped",
@@ -1695,6 +1750,64 @@ gst_h265_parse_update_src_caps (GstH265Parse * h265parse, GstCaps * caps)
 
 }
 
+/* Converts the NALs at the start of @frame to the output format by
+ * overwriting their prefixes, provided its buffer is writable */
+static gboolean
+gst_h265_parse_transform_in_place (GstH265Parse * h265parse,
+    GstBaseParseFrame * frame)
+{
+  GstBuffer *buffer = frame->buffer;
+  GstMapInfo map;
+  guint i, pos = 0;
+
+  if (!gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  /* the collected NALs share the memory of the buffer, which would make
+   * mapping it for writing copy it */
+  gst_adapter_clear (h265parse->frame_out);
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_WRITE)) {
+    /* collect them again for converting by copying */
+    for (i = 0; i < h265parse->in_place_sizes->len; i++) {
+      guint size = g_array_index (h265parse->in_place_sizes, guint, i);
+      guint8 prefix[4];
+      GstBuffer *buf;
+      guint nl;
+
+      nl = gst_h265_parse_nal_prefix (h265parse, h265parse->format, size,
+          prefix);
+      buf = gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format,
+          buffer, pos + nl, size);
+      gst_adapter_push (h265parse->frame_out, buf);
+      pos += nl + size;
+    }
+    return FALSE;
+  }
+
+  GST_LOG_OBJECT (h265parse, "rewriting %u NAL prefixes in place",
+      h265parse->in_place_sizes->len);
+
+  for (i = 0; i < h265parse->in_place_sizes->len; i++) {
+    guint size = g_array_index (h265parse->in_place_sizes, guint, i);
+    guint8 prefix[4];
+    guint nl;
+
+    nl = gst_h265_parse_nal_prefix (h265parse, h265parse->format, size,
+        prefix);
+    memcpy (map.data + pos, prefix, nl);
+    pos += nl + size;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  /* the input buffer may extend past the frame */
+  buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, 0, pos);
+  gst_buffer_replace (&frame->out_buffer, buffer);
+  gst_buffer_unref (buffer);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
@@ -1723,10 +1836,14 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 
   /* replace with transformed HEVC output if applicable */
   av = gst_adapter_available (h265parse->frame_out);
-  if (av) {
+  if (av && h265parse->in_place_pos == av && (!h265parse->packetized ||
+          gst_buffer_get_size (buffer) == av) &&
+      gst_h265_parse_transform_in_place (h265parse, frame)) {
+    GST_LOG_OBJECT (h265parse, "converted frame in place");
+  } else if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h265parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -1741,12 +1858,8 @@ static GstFlowReturn
 gst_h265_parse_push_codec_buffer (GstH265Parse * h265parse, GstBuffer * nal,
     GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format, nal,
+      0, gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -1964,71 +2077,43 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
+          /* insert config NALs into AU, sharing the memory of the AU and of
+           * the config NALs */
           GstBuffer *new_buf;
-          const gboolean bs = h265parse->format == GST_H265_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h265parse->nal_length_size;
-          gboolean ok;
 
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h265parse->idr_pos);
           GST_DEBUG_OBJECT (h265parse, "- inserting VPS/SPS/PPS");
+          new_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0,
+              h265parse->idr_pos);
           for (i = 0; i < GST_H265_MAX_VPS_COUNT; i++) {
             if ((codec_nal = h265parse->vps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting VPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H265_MAX_SPS_COUNT; i++) {
             if ((codec_nal = h265parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
             if ((codec_nal = h265parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h265parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              new_buf = gst_buffer_append (new_buf,
+                  gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format,
+                      codec_nal, 0, gst_buffer_get_size (codec_nal)));
               h265parse->last_report = new_ts;
             }
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h265parse->idr_pos, -1);
+          new_buf = gst_buffer_append_region (new_buf, gst_buffer_ref (buffer),
+              h265parse->idr_pos, -1);
           /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -2036,10 +2121,6 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h265parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -82,6 +82,12 @@ struct _GstH265Parse
   gint idr_pos, sei_pos;
   gboolean update_caps;
   GstAdapter *frame_out;
+  /* buffer the NALs being processed are mapped from, if any */
+  GstBuffer *nal_buffer;
+  /* end of the NALs of the frame while they can be converted by rewriting
+   * their prefixes in place, -1 otherwise, and their sizes */
+  gint in_place_pos;
+  GArray *in_place_sizes;
   gboolean keyframe;
   gboolean header;
   /* AU state */
@@ -27,15 +27,28 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/gstfdmemory.h>
 #include "gstipcpipelinecomm.h"
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 #define GST_CAT_DEFAULT gst_ipc_pipeline_comm_debug
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* maximum number of file descriptors accepted by a single read */
+#define MAX_PASSED_FDS 16
+
 GQuark QUARK_ID;
 
 typedef enum
@@ -186,6 +199,8 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+      return "FD_BUFFER";
     default:
       return "UNKNOWN";
   }
@@ -255,6 +270,136 @@ write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
   return ret;
 }
 
+static gboolean
+write_byte_writer_to_fd_with_fd (GstIpcPipelineComm * comm, GstByteWriter * bw,
+    int passed_fd)
+{
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } cmsg;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *c;
+  guint8 *data;
+  gboolean ret;
+  guint size;
+  ssize_t written;
+
+  size = gst_byte_writer_get_size (bw);
+  data = gst_byte_writer_reset_and_get_data (bw);
+  if (!data)
+    return FALSE;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsg.buf;
+  msg.msg_controllen = sizeof (cmsg.buf);
+  c = CMSG_FIRSTHDR (&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (c), &passed_fd, sizeof (int));
+
+  GST_TRACE_OBJECT (comm->element, "Writing %u bytes and fd %d to fdout",
+      size, passed_fd);
+  do {
+    written = sendmsg (comm->fdout, &msg, 0);
+  } while (written < 0 && (errno == EAGAIN || errno == EINTR));
+
+  if (written < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to send fd: %s",
+        strerror (errno));
+    ret = FALSE;
+  } else {
+    /* the fd went with the first byte, the rest can be written normally */
+    ret = write_to_fd_raw (comm, data + written, size - written);
+  }
+  g_free (data);
+  return ret;
+}
+
+/* Copies the buffer data into a new memfd, which the receiver can map
+ * directly. Returns -1 if this is not possible, in which case the data
+ * has to be sent inline. */
+static int
+gst_ipc_pipeline_comm_create_memfd (GstIpcPipelineComm * comm,
+    GstBuffer * buffer)
+{
+#if defined (__linux__) && defined (SYS_memfd_create)
+  struct stat st;
+  GstMapInfo map;
+  gsize offset = 0;
+  int fd;
+
+  if (fstat (comm->fdout, &st) < 0 || !S_ISSOCK (st.st_mode)) {
+    GST_LOG_OBJECT (comm->element, "fdout is not a socket, can't pass fds");
+    return -1;
+  }
+
+  fd = syscall (SYS_memfd_create, "ipcpipeline", MFD_CLOEXEC);
+  if (fd < 0) {
+    GST_DEBUG_OBJECT (comm->element, "Failed to create memfd: %s",
+        strerror (errno));
+    return -1;
+  }
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    close (fd);
+    return -1;
+  }
+  while (offset < map.size) {
+    ssize_t written = write (fd, map.data + offset, map.size - offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      GST_WARNING_OBJECT (comm->element, "Failed to write to memfd: %s",
+          strerror (errno));
+      break;
+    }
+    offset += written;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  if (offset < map.size) {
+    close (fd);
+    return -1;
+  }
+  return fd;
+#else
+  return -1;
+#endif
+}
+
+/* Waits for the acknowledgement of the oldest buffer in flight. A failure
+ * is kept to be returned for the buffer currently being written. */
+static void
+gst_ipc_pipeline_comm_wait_buffer_in_flight (GstIpcPipelineComm * comm)
+{
+  GHashTable *waiting_ids;
+  CommRequest *req;
+  guint32 id, ret;
+
+  id = GPOINTER_TO_UINT (g_queue_pop_head (&comm->buffers_in_flight));
+  waiting_ids = g_hash_table_ref (comm->waiting_ids);
+  req = g_hash_table_lookup (waiting_ids, GINT_TO_POINTER (id));
+  if (req) {
+    ret = comm_request_wait (comm, req, ACK_TYPE_BLOCKING);
+    g_hash_table_remove (waiting_ids, GINT_TO_POINTER (id));
+  } else {
+    /* cancelled and dropped along with the table it was in */
+    ret = GST_FLOW_COMM_ERROR;
+  }
+  g_hash_table_unref (waiting_ids);
+
+  if (ret != GST_FLOW_OK && comm->buffers_in_flight_ret == GST_FLOW_OK)
+    comm->buffers_in_flight_ret = ret;
+}
+
 static void
 gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
     guint32 ret, CommRequestType type)
@@ -500,16 +645,26 @@ GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
   GstMapInfo map;
-  guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
   CommBufferMetadata meta;
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  CommRequest *req;
+  int passed_fd = -1;
 
   g_mutex_lock (&comm->mutex);
+
+  /* a buffer still in flight failed, don't send more */
+  if (comm->buffers_in_flight_ret != GST_FLOW_OK) {
+    ret = comm->buffers_in_flight_ret;
+    comm->buffers_in_flight_ret = GST_FLOW_OK;
+    g_mutex_unlock (&comm->mutex);
+    return ret;
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
@@ -527,13 +682,19 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   /* work out meta size */
   gst_buffer_foreach_meta (buffer, build_meta, &repr);
 
+  /* the data either follows inline or is passed along as a memfd */
+  if (comm->fd_passing && gst_buffer_get_size (buffer) > 0)
+    passed_fd = gst_ipc_pipeline_comm_create_memfd (comm, buffer);
+  if (passed_fd >= 0)
+    payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER;
+
   if (!gst_byte_writer_put_uint8 (&bw, payload_type))
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
+  size = sizeof (guint32) + sizeof (CommBufferMetadata) + repr.total_bytes;
+  if (passed_fd < 0)
+    size += gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
   if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
@@ -541,15 +702,21 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   size = gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  if (passed_fd >= 0) {
+    if (!write_byte_writer_to_fd_with_fd (comm, &bw, passed_fd))
+      goto write_failed;
+  } else {
+    if (!write_byte_writer_to_fd (comm, &bw))
+      goto write_failed;
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
+      goto write_failed;
+  }
 
   /* meta */
   gst_byte_writer_init (&bw);
@@ -588,13 +755,23 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   if (!write_byte_writer_to_fd (comm, &bw))
     goto write_failed;
 
-  if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
-          ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
-    goto wait_failed;
-  ret = ret32;
+  /* only wait for the oldest acknowledgements once too many buffers
+   * are in flight, a single one meaning a fully synchronous write */
+  req = comm_request_new (comm->send_id, COMM_REQUEST_TYPE_BUFFER, NULL);
+  g_hash_table_insert (comm->waiting_ids, GINT_TO_POINTER (comm->send_id),
+      req);
+  g_queue_push_tail (&comm->buffers_in_flight,
+      GUINT_TO_POINTER (comm->send_id));
+  while (g_queue_get_length (&comm->buffers_in_flight) >=
+      MAX (comm->max_buffers_in_flight, 1))
+    gst_ipc_pipeline_comm_wait_buffer_in_flight (comm);
+  ret = comm->buffers_in_flight_ret;
+  comm->buffers_in_flight_ret = GST_FLOW_OK;
 
 done:
   g_mutex_unlock (&comm->mutex);
+  if (passed_fd >= 0)
+    close (passed_fd);
   gst_byte_writer_reset (&bw);
   for (n = 0; n < repr.n_meta; ++n)
     g_free (repr.info[n].str);
@@ -607,12 +784,6 @@ write_failed:
   ret = GST_FLOW_COMM_ERROR;
   goto done;
 
-wait_failed:
-  GST_ELEMENT_ERROR (comm->element, RESOURCE, WRITE, (NULL),
-      ("Failed to wait for reply on socket"));
-  ret = GST_FLOW_COMM_ERROR;
-  goto done;
-
 map_failed:
   GST_ELEMENT_ERROR (comm->element, RESOURCE, READ, (NULL),
       ("Failed to map buffer"));
@@ -621,9 +792,12 @@ map_failed:
 }
 
 static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size,
+    gboolean fd_data)
 {
   GstBuffer *buffer;
+  GstMemory *mem;
+  int fd;
   CommBufferMetadata meta;
   guint32 n_meta, n;
   const guint8 *payload = NULL;
@@ -644,13 +818,33 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
-  if (buffer_data_size == 0) {
+  if (fd_data) {
+    if (g_queue_is_empty (&comm->fds)) {
+      GST_ERROR_OBJECT (comm->element, "No fd received for buffer data");
+      return NULL;
+    }
+    fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->fds));
+    buffer = gst_buffer_new ();
+    if (buffer_data_size == 0) {
+      close (fd);
+    } else {
+      /* the memory owns the fd now, and nobody else writes to it */
+      mem = gst_fd_allocator_alloc (comm->fd_allocator, fd, buffer_data_size,
+          GST_FD_MEMORY_FLAG_NONE);
+      if (!mem) {
+        close (fd);
+        gst_buffer_unref (buffer);
+        return NULL;
+      }
+      gst_buffer_append_memory (buffer, mem);
+    }
+  } else if (buffer_data_size == 0) {
     buffer = gst_buffer_new ();
   } else {
     buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
     gst_adapter_flush (comm->adapter, buffer_data_size);
+    size -= buffer_data_size;
   }
-  size -= buffer_data_size;
 
   GST_BUFFER_PTS (buffer) = meta.pts;
   GST_BUFFER_DTS (buffer) = meta.dts;
@@ -908,6 +1102,14 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
     return gst_ipc_pipeline_comm_write_sink_message_event_to_fd (comm, event);
 
   g_mutex_lock (&comm->mutex);
+
+  /* results of buffers sent before the flush don't matter anymore */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    while (!g_queue_is_empty (&comm->buffers_in_flight))
+      gst_ipc_pipeline_comm_wait_buffer_in_flight (comm);
+    comm->buffers_in_flight_ret = GST_FLOW_OK;
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing event %u: %" GST_PTR_FORMAT,
@@ -1607,12 +1809,28 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->adapter = gst_adapter_new ();
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+  comm->max_buffers_in_flight = 1;
+  g_queue_init (&comm->buffers_in_flight);
+  comm->buffers_in_flight_ret = GST_FLOW_OK;
+  comm->fdin_is_socket = TRUE;
+  g_queue_init (&comm->fds);
+  comm->fd_allocator = gst_fd_allocator_new ();
+}
+
+static void
+close_passed_fd (gpointer data, gpointer user_data)
+{
+  close (GPOINTER_TO_INT (data));
 }
 
 void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
   g_hash_table_destroy (comm->waiting_ids);
+  g_queue_clear (&comm->buffers_in_flight);
+  g_queue_foreach (&comm->fds, close_passed_fd, NULL);
+  g_queue_clear (&comm->fds);
+  gst_object_unref (comm->fd_allocator);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
   g_mutex_clear (&comm->mutex);
@@ -1647,6 +1865,15 @@ gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
 {
   g_mutex_lock (&comm->mutex);
   g_hash_table_foreach (comm->waiting_ids, cancel_request_error, comm);
+  /* nobody waits for the buffers still in flight yet, and their results
+   * don't matter anymore */
+  while (!g_queue_is_empty (&comm->buffers_in_flight)) {
+    guint32 id =
+        GPOINTER_TO_UINT (g_queue_pop_head (&comm->buffers_in_flight));
+
+    g_hash_table_remove (comm->waiting_ids, GINT_TO_POINTER (id));
+  }
+  comm->buffers_in_flight_ret = GST_FLOW_OK;
   if (cleanup) {
     g_hash_table_unref (comm->waiting_ids);
     comm->waiting_ids =
@@ -1699,6 +1926,67 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
   return TRUE;
 }
 
+/* Reads from fdin, queueing any file descriptors passed along */
+static ssize_t
+read_from_fdin (GstIpcPipelineComm * comm, void *data, size_t size)
+{
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int) * MAX_PASSED_FDS)];
+  } cmsg;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *c;
+  ssize_t sz;
+  int flags = 0;
+  guint n;
+
+  if (!comm->fdin_is_socket)
+    return read (comm->pollFDin.fd, data, size);
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsg.buf;
+  msg.msg_controllen = sizeof (cmsg.buf);
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  sz = recvmsg (comm->pollFDin.fd, &msg, flags);
+  if (sz < 0) {
+    if (errno != ENOTSOCK)
+      return sz;
+    GST_DEBUG_OBJECT (comm->element, "fdin is not a socket, using read()");
+    comm->fdin_is_socket = FALSE;
+    return read (comm->pollFDin.fd, data, size);
+  }
+
+  for (c = CMSG_FIRSTHDR (&msg); c; c = CMSG_NXTHDR (&msg, c)) {
+    if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+      continue;
+    for (n = 0; n < (c->cmsg_len - CMSG_LEN (0)) / sizeof (int); ++n) {
+      int fd;
+
+      memcpy (&fd, CMSG_DATA (c) + n * sizeof (int), sizeof (int));
+      GST_TRACE_OBJECT (comm->element, "Received fd %d", fd);
+      g_queue_push_tail (&comm->fds, GINT_TO_POINTER (fd));
+    }
+  }
+
+  if (msg.msg_flags & MSG_CTRUNC) {
+    /* fds were dropped, we can't match them with buffers anymore */
+    GST_ERROR_OBJECT (comm->element, "Too many fds received at once");
+    errno = EPROTO;
+    return -1;
+  }
+
+  return sz;
+}
+
 static gint
 update_adapter (GstIpcPipelineComm * comm)
 {
@@ -1721,6 +2009,9 @@ again:
       gst_poll_remove_fd (comm->poll, &comm->pollFDin);
       gst_poll_fd_init (&comm->pollFDin);
     }
+    g_queue_foreach (&comm->fds, close_passed_fd, NULL);
+    g_queue_clear (&comm->fds);
+    comm->fdin_is_socket = TRUE;
     if (comm->fdin != -1 && GST_OBJECT_PARENT (comm->element)) {
       GST_DEBUG_OBJECT (comm->element, "Start watching fd %d", comm->fdin);
       comm->pollFDin.fd = comm->fdin;
@@ -1745,7 +2036,7 @@ again:
       mem = gst_allocator_alloc (NULL, comm->read_chunk_size, NULL);
 
     gst_memory_map (mem, &map, GST_MAP_WRITE);
-    sz = read (comm->pollFDin.fd, map.data, map.size);
+    sz = read_from_fdin (comm, map.data, map.size);
     gst_memory_unmap (mem, &map);
 
     if (sz <= 0) {
@@ -1810,6 +2101,7 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1874,6 +2166,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1881,7 +2174,8 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length,
+            comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER);
         if (!buf)
           goto buffer_failed;
 
@@ -51,6 +51,7 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER,
 } GstIpcPipelineCommDataType;
 
 typedef struct
@@ -76,6 +77,18 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* sending side: buffer data passed as memfds, and ids of the buffers
+   * written but not acknowledged yet */
+  gboolean fd_passing;
+  guint max_buffers_in_flight;
+  GQueue buffers_in_flight;
+  GstFlowReturn buffers_in_flight_ret;
+
+  /* receiving side: file descriptors received along with the data */
+  gboolean fdin_is_socket;
+  GQueue fds;
+  GstAllocator *fd_allocator;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
@@ -56,6 +56,9 @@
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
  * performs a blocking wait for a reply, if a return code is needed.
+ * For buffers, #GstIpcPipelineSink:max-buffers-in-flight allows several of
+ * them to be sent before waiting, and #GstIpcPipelineSink:fd-passing moves
+ * their data out of the socket into memfds passed along with the packets.
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -98,11 +101,15 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_FD_PASSING,
+  PROP_MAX_BUFFERS_IN_FLIGHT,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_FD_PASSING FALSE
+#define DEFAULT_MAX_BUFFERS_IN_FLIGHT 1
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -174,6 +181,36 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           "Maximum time to wait for a response to a message",
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstIpcPipelineSink:fd-passing:
+   *
+   * Pass buffer data to ipcpipelinesrc as a memfd instead of writing it
+   * to the socket, so that the receiving side can map it without copying.
+   * Only available on Linux, and only if #GstIpcPipelineSink:fdout is a
+   * Unix domain socket. Buffers are sent inline otherwise.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "FD passing",
+          "Pass buffer data as file descriptors when possible",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstIpcPipelineSink:max-buffers-in-flight:
+   *
+   * Maximum number of buffers sent to ipcpipelinesrc without having been
+   * acknowledged. With 1, every buffer waits for the slave pipeline to
+   * have handled it. Higher values let the two processes work in
+   * parallel; a flow error is then returned for a later buffer than the
+   * one that caused it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_BUFFERS_IN_FLIGHT,
+      g_param_spec_uint ("max-buffers-in-flight", "Max buffers in flight",
+          "Maximum number of buffers sent without being acknowledged",
+          1, 1024, DEFAULT_MAX_BUFFERS_IN_FLIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
@@ -210,6 +247,8 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.fd_passing = DEFAULT_FD_PASSING;
+  sink->comm.max_buffers_in_flight = DEFAULT_MAX_BUFFERS_IN_FLIGHT;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -271,6 +310,16 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_FD_PASSING:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.fd_passing = g_value_get_boolean (value);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
+    case PROP_MAX_BUFFERS_IN_FLIGHT:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.max_buffers_in_flight = g_value_get_uint (value);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +345,16 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_FD_PASSING:
+      g_mutex_lock (&sink->comm.mutex);
+      g_value_set_boolean (value, sink->comm.fd_passing);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
+    case PROP_MAX_BUFFERS_IN_FLIGHT:
+      g_mutex_lock (&sink->comm.mutex);
+      g_value_set_uint (value, sink->comm.max_buffers_in_flight);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -39,6 +39,7 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
 
@@ -58,7 +59,8 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_FD_PASSING
 };
 
 struct GstShmClient
@@ -69,6 +71,7 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_FD_PASSING (FALSE)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -353,6 +356,7 @@ gst_shm_sink_init (GstShmSink * self)
   g_cond_init (&self->cond);
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
+  self->fd_passing = DEFAULT_FD_PASSING;
   self->perms = DEFAULT_PERMS;
 
   gst_allocation_params_init (&self->params);
@@ -416,6 +420,22 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:fd-passing:
+   *
+   * Send buffers made of a single file descriptor backed memory, like memfd
+   * or dmabuf memory, to the clients as file descriptors instead of copying
+   * them into the shared memory area. The clients must support it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing",
+          "Pass file descriptors",
+          "Send file descriptor backed buffers as file descriptors instead of "
+          "copying them into the shm area",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -504,6 +524,11 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -533,6 +558,9 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, self->fd_passing);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -664,6 +692,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   int rv = 0;
   GstMapInfo map;
   gboolean need_new_memory = FALSE;
+  gboolean send_fd = FALSE;
   GstFlowReturn ret = GST_FLOW_OK;
   GstMemory *memory = NULL;
   GstBuffer *sendbuf = NULL;
@@ -702,7 +731,11 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   } else {
     memory = gst_buffer_peek_memory (buf, 0);
 
-    if (memory->allocator != GST_ALLOCATOR (self->allocator)) {
+    if (self->fd_passing && gst_is_fd_memory (memory)) {
+      send_fd = TRUE;
+      GST_LOG_OBJECT (self, "Sending memory in buffer %p as file descriptor",
+          buf);
+    } else if (memory->allocator != GST_ALLOCATOR (self->allocator)) {
       need_new_memory = TRUE;
       GST_LOG_OBJECT (self, "Memory in buffer %p was not allocated by "
           "%" GST_PTR_FORMAT ", will memcpy", buf, memory->allocator);
@@ -722,6 +755,16 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     while ((memory =
             gst_shm_sink_allocator_alloc_locked (self->allocator,
                 gst_buffer_get_size (buf), &self->params)) == NULL) {
+      ShmAllocStats stats;
+
+      sp_writer_get_alloc_stats (self->pipe, &stats);
+      GST_DEBUG_OBJECT (self, "No space for %" G_GSIZE_FORMAT " bytes, %"
+          G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes used by %u blocks, "
+          "largest of %u free blocks has %" G_GSIZE_FORMAT " bytes, %lu of %lu "
+          "allocations failed", gst_buffer_get_size (buf), stats.used_size,
+          stats.size, stats.n_used_blocks, stats.n_free_blocks,
+          stats.largest_free_size, stats.n_failures,
+          stats.n_allocs + stats.n_failures);
       g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
@@ -772,25 +815,31 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     sendbuf = gst_buffer_ref (buf);
   }
 
-  if (!gst_buffer_map (sendbuf, &map, GST_MAP_READ)) {
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        (NULL), ("Failed to map data into send buffer"));
-    goto error;
-  }
+  if (send_fd) {
+    /* sendbuf keeps the memory alive until all clients are done with it */
+    rv = sp_writer_send_fd_buf (self->pipe, gst_fd_memory_get_fd (memory),
+        memory->offset, memory->size, sendbuf);
+  } else {
+    if (!gst_buffer_map (sendbuf, &map, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to map data into send buffer"));
+      goto error;
+    }
 
-  /* Make the memory readonly as of now as we've sent it to the other side
-   * We know it's not mapped for writing anywhere as we just mapped it for
-   * reading
-   */
-  rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size, sendbuf);
-  if (rv == -1) {
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        (NULL), ("Failed to send data over SHM"));
+    /* Make the memory readonly as of now as we've sent it to the other side
+     * We know it's not mapped for writing anywhere as we just mapped it for
+     * reading
+     */
+    rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size,
+        sendbuf);
     gst_buffer_unmap (sendbuf, &map);
-    goto error;
-  }
 
-  gst_buffer_unmap (sendbuf, &map);
+    if (rv == -1) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to send data over SHM"));
+      goto error;
+    }
+  }
 
   GST_OBJECT_UNLOCK (self);
 
@@ -41,6 +41,7 @@
 #include "gstshmsrc.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
 
@@ -61,10 +62,14 @@ enum
 
 struct GstShmBuffer
 {
+  /* NULL for buffers received as file descriptors, which have an id */
   char *buf;
+  int id;
   GstShmPipe *pipe;
 };
 
+static GQuark gst_shm_buffer_quark;
+
 
 GST_DEBUG_CATEGORY_STATIC (shmsrc_debug);
 #define GST_CAT_DEFAULT shmsrc_debug
@@ -147,6 +152,8 @@ gst_shm_src_class_init (GstShmSrcClass * klass)
       "Receive data from the shared memory sink",
       "Olivier Crete <olivier.crete@collabora.co.uk>");
 
+  gst_shm_buffer_quark = g_quark_from_static_string ("GstShmBuffer");
+
   GST_DEBUG_CATEGORY_INIT (shmsrc_debug, "shmsrc", 0, "Shared Memory Source");
 }
 
@@ -155,6 +162,7 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  self->fd_allocator = gst_fd_allocator_new ();
 }
 
 static void
@@ -164,6 +172,7 @@ gst_shm_src_finalize (GObject * object)
 
   gst_poll_free (self->poll);
   g_free (self->socket_path);
+  gst_object_unref (self->fd_allocator);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -307,10 +316,14 @@ free_buffer (gpointer data)
   g_return_if_fail (gsb->pipe != NULL);
   g_return_if_fail (gsb->pipe->src != NULL);
 
-  GST_LOG ("Freeing buffer %p", gsb->buf);
-
   GST_OBJECT_LOCK (gsb->pipe->src);
-  sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
+  if (gsb->buf) {
+    GST_LOG ("Freeing buffer %p", gsb->buf);
+    sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
+  } else {
+    GST_LOG ("Freeing fd buffer %d", gsb->id);
+    sp_client_recv_fd_finish (gsb->pipe->pipe, gsb->id);
+  }
   GST_OBJECT_UNLOCK (gsb->pipe->src);
 
   gst_shm_pipe_dec (gsb->pipe);
@@ -323,6 +336,7 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
   GstShmSrc *self = GST_SHM_SRC (psrc);
   gchar *buf = NULL;
+  ShmFdBuffer fd_buf = { -1 };
   int rv = 0;
   struct GstShmBuffer *gsb;
 
@@ -354,7 +368,7 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
       buf = NULL;
       GST_LOG_OBJECT (self, "Reading from pipe");
       GST_OBJECT_LOCK (self);
-      rv = sp_client_recv (self->pipe->pipe, &buf);
+      rv = sp_client_recv_fd (self->pipe->pipe, &buf, &fd_buf);
       GST_OBJECT_UNLOCK (self);
       if (rv < 0) {
         GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
@@ -362,17 +376,36 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
         return GST_FLOW_ERROR;
       }
     }
-  } while (buf == NULL);
-
-  GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
+  } while (buf == NULL && fd_buf.fd < 0);
 
   gsb = g_slice_new0 (struct GstShmBuffer);
   gsb->buf = buf;
+  gsb->id = fd_buf.id;
   gsb->pipe = self->pipe;
   gst_shm_pipe_inc (self->pipe);
 
-  *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      buf, rv, 0, rv, gsb, free_buffer);
+  if (buf) {
+    GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
+
+    *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        buf, rv, 0, rv, gsb, free_buffer);
+  } else {
+    GstMemory *mem;
+
+    GST_LOG_OBJECT (self, "Got fd buffer %d of size %d", fd_buf.id, rv);
+
+    /* the memory owns the file descriptor and acknowledges the buffer once
+     * it is freed */
+    mem = gst_fd_allocator_alloc (self->fd_allocator, fd_buf.fd,
+        fd_buf.offset + rv, GST_FD_MEMORY_FLAG_NONE);
+    gst_memory_resize (mem, fd_buf.offset, rv);
+    GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+        gst_shm_buffer_quark, gsb, free_buffer);
+
+    *outbuf = gst_buffer_new ();
+    gst_buffer_append_memory (*outbuf, mem);
+  }
 
   return GST_FLOW_OK;
 }
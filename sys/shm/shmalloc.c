@@ -33,19 +33,38 @@
 #include <string.h>
 #include <assert.h>
 
+/* Free blocks are kept in one list per size class, class n holding the
+ * blocks of 2^n to 2^(n+1)-1 bytes, so that allocating only has to look at
+ * one class, and freeing merges a block with its free neighbours right away
+ * instead of letting the space fragment. */
+#define SHM_ALLOC_NUM_CLASSES (sizeof (unsigned long) * 8)
+
 /* This is the allocated space to hold multiple blocks */
 struct _ShmAllocSpace
 {
   /* The total size of this space */
   size_t size;
 
-  /* chained list of the blocks contained in this space */
+  /* chained list of the blocks, free or not, covering this space in offset
+   * order */
   ShmAllocBlock *blocks;
+
+  /* chained lists of the free blocks of each size class */
+  ShmAllocBlock *free_blocks[SHM_ALLOC_NUM_CLASSES];
+  /* bit n is set if the list of class n is not empty */
+  unsigned long free_classes;
+
+  size_t used_size;
+  unsigned int n_used_blocks;
+  unsigned int n_free_blocks;
+  unsigned long n_allocs;
+  unsigned long n_failures;
 };
 
 /* A single block of data */
 struct _ShmAllocBlock
 {
+  /* 0 if the block is free */
   int use_count;
 
   /* Pointer back to the AllocSpace where this block is */
@@ -56,11 +75,83 @@ struct _ShmAllocBlock
   /* The size of the block */
   unsigned long size;
 
-  /* Pointer to the next block in the chain */
+  /* Pointers to the blocks before and after this one in the space */
+  ShmAllocBlock *prev;
   ShmAllocBlock *next;
+
+  /* Pointers to the other free blocks of the same size class */
+  ShmAllocBlock *prev_free;
+  ShmAllocBlock *next_free;
 };
 
 
+static unsigned int
+shm_alloc_space_size_class (unsigned long size)
+{
+  unsigned int size_class = 0;
+
+  while (size >>= 1)
+    size_class++;
+
+  return size_class;
+}
+
+static ShmAllocBlock *
+shm_alloc_space_block_new (ShmAllocSpace * self, unsigned long offset,
+    unsigned long size)
+{
+  ShmAllocBlock *block = spalloc_new (ShmAllocBlock);
+
+  memset (block, 0, sizeof (ShmAllocBlock));
+  block->space = self;
+  block->offset = offset;
+  block->size = size;
+
+  return block;
+}
+
+static void
+shm_alloc_space_add_free_block (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int size_class = shm_alloc_space_size_class (block->size);
+
+  block->prev_free = NULL;
+  block->next_free = self->free_blocks[size_class];
+  if (block->next_free)
+    block->next_free->prev_free = block;
+  self->free_blocks[size_class] = block;
+  self->free_classes |= 1UL << size_class;
+  self->n_free_blocks++;
+}
+
+static void
+shm_alloc_space_remove_free_block (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int size_class = shm_alloc_space_size_class (block->size);
+
+  if (block->prev_free)
+    block->prev_free->next_free = block->next_free;
+  else
+    self->free_blocks[size_class] = block->next_free;
+  if (block->next_free)
+    block->next_free->prev_free = block->prev_free;
+  if (!self->free_blocks[size_class])
+    self->free_classes &= ~(1UL << size_class);
+  self->n_free_blocks--;
+}
+
+/* Merges @block into the block before it, which must follow it directly */
+static void
+shm_alloc_space_merge_block (ShmAllocBlock * prev, ShmAllocBlock * block)
+{
+  prev->size += block->size;
+  prev->next = block->next;
+  if (block->next)
+    block->next->prev = prev;
+
+  spalloc_free (ShmAllocBlock, block);
+}
+
 ShmAllocSpace *
 shm_alloc_space_new (size_t size)
 {
@@ -70,13 +161,23 @@ shm_alloc_space_new (size_t size)
 
   self->size = size;
 
+  if (size > 0) {
+    self->blocks = shm_alloc_space_block_new (self, 0, size);
+    shm_alloc_space_add_free_block (self, self->blocks);
+  }
+
   return self;
 }
 
 void
 shm_alloc_space_free (ShmAllocSpace * self)
 {
-  assert (self && self->blocks == NULL);
+  assert (self && self->n_used_blocks == 0);
+
+  if (self->blocks) {
+    assert (self->blocks->next == NULL);
+    spalloc_free (ShmAllocBlock, self->blocks);
+  }
   spalloc_free (ShmAllocSpace, self);
 }
 
@@ -85,42 +186,53 @@ ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
 {
   ShmAllocBlock *block;
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
-  unsigned long prev_end_offset = 0;
-
-
-  for (item = self->blocks; item; item = item->next) {
-    unsigned long max_size = 0;
+  unsigned int size_class;
 
-    max_size = item->offset - prev_end_offset;
+  if (size == 0)
+    size = 1;
 
-    if (max_size >= size)
+  /* blocks of the same class may be too small, but looking at them first
+   * lets blocks of recurring sizes, like video frames, be reused as they
+   * are instead of splitting bigger ones */
+  size_class = shm_alloc_space_size_class (size);
+  for (block = self->free_blocks[size_class]; block; block = block->next_free) {
+    if (block->size >= size)
       break;
+  }
 
-    prev_end_offset = item->offset + item->size;
-    prev_item = item;
+  /* otherwise any block of a bigger class is big enough */
+  while (!block && ++size_class < SHM_ALLOC_NUM_CLASSES) {
+    if (self->free_classes & (1UL << size_class))
+      block = self->free_blocks[size_class];
   }
 
-  /* Return NULL if there is no big enough space, otherwise, there is space
-   * at the end */
-  assert (prev_end_offset <= self->size);
-  if (!item && self->size - prev_end_offset < size)
+  /* Return NULL if there is no big enough space */
+  if (!block) {
+    self->n_failures++;
     return NULL;
+  }
 
-  block = spalloc_new (ShmAllocBlock);
-  memset (block, 0, sizeof (ShmAllocBlock));
-  block->offset = prev_end_offset;
-  block->size = size;
-  block->use_count = 1;
-  block->space = self;
+  shm_alloc_space_remove_free_block (self, block);
 
-  if (prev_item)
-    prev_item->next = block;
-  else
-    self->blocks = block;
+  /* give the rest of the block back */
+  if (block->size > size) {
+    ShmAllocBlock *rest = shm_alloc_space_block_new (self,
+        block->offset + size, block->size - size);
+
+    rest->prev = block;
+    rest->next = block->next;
+    if (rest->next)
+      rest->next->prev = rest;
+    block->next = rest;
+    block->size = size;
+    shm_alloc_space_add_free_block (self, rest);
+  }
+
+  block->use_count = 1;
 
-  block->next = item;
+  self->used_size += block->size;
+  self->n_used_blocks++;
+  self->n_allocs++;
 
   return block;
 }
@@ -134,22 +246,26 @@ shm_alloc_space_alloc_block_get_offset (ShmAllocBlock * block)
 static void
 shm_alloc_space_free_block (ShmAllocBlock * block)
 {
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
   ShmAllocSpace *self = block->space;
+  ShmAllocBlock *prev = block->prev;
+  ShmAllocBlock *next = block->next;
 
-  for (item = self->blocks; item; item = item->next) {
-    if (item == block) {
-      if (prev_item)
-        prev_item->next = item->next;
-      else
-        self->blocks = item->next;
-      break;
-    }
-    prev_item = item;
+  self->used_size -= block->size;
+  self->n_used_blocks--;
+  block->use_count = 0;
+
+  if (prev && prev->use_count == 0) {
+    shm_alloc_space_remove_free_block (self, prev);
+    shm_alloc_space_merge_block (prev, block);
+    block = prev;
   }
 
-  spalloc_free (ShmAllocBlock, block);
+  if (next && next->use_count == 0) {
+    shm_alloc_space_remove_free_block (self, next);
+    shm_alloc_space_merge_block (block, next);
+  }
+
+  shm_alloc_space_add_free_block (self, block);
 }
 
 ShmAllocBlock *
@@ -158,8 +274,8 @@ shm_alloc_space_block_get (ShmAllocSpace * self, unsigned long offset)
   ShmAllocBlock *block = NULL;
 
   for (block = self->blocks; block; block = block->next) {
-    if (block->offset <= offset && (block->offset + block->size) > offset)
-      return block;
+    if (block->offset + block->size > offset)
+      return block->use_count > 0 ? block : NULL;
   }
 
   return NULL;
@@ -180,3 +296,32 @@ shm_alloc_space_block_dec (ShmAllocBlock * block)
   if (block->use_count <= 0)
     shm_alloc_space_free_block (block);
 }
+
+void
+shm_alloc_space_get_stats (ShmAllocSpace * self, ShmAllocStats * stats)
+{
+  ShmAllocBlock *block;
+  int size_class;
+
+  memset (stats, 0, sizeof (ShmAllocStats));
+
+  stats->size = self->size;
+  stats->used_size = self->used_size;
+  stats->n_used_blocks = self->n_used_blocks;
+  stats->n_free_blocks = self->n_free_blocks;
+  stats->n_allocs = self->n_allocs;
+  stats->n_failures = self->n_failures;
+
+  /* the largest free block is in the biggest non-empty class */
+  for (size_class = SHM_ALLOC_NUM_CLASSES - 1; size_class >= 0; size_class--) {
+    if (self->free_classes & (1UL << size_class))
+      break;
+  }
+  if (size_class >= 0) {
+    for (block = self->free_blocks[size_class]; block;
+        block = block->next_free) {
+      if (block->size > stats->largest_free_size)
+        stats->largest_free_size = block->size;
+    }
+  }
+}
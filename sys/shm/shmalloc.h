@@ -53,6 +53,21 @@ extern "C" {
 typedef struct _ShmAllocSpace ShmAllocSpace;
 typedef struct _ShmAllocBlock ShmAllocBlock;
 
+typedef struct _ShmAllocStats ShmAllocStats;
+
+/* Allocation statistics of a space. The space is fragmented when the largest
+ * free block is much smaller than the free size. */
+struct _ShmAllocStats
+{
+  size_t size;
+  size_t used_size;
+  size_t largest_free_size;
+  unsigned int n_used_blocks;
+  unsigned int n_free_blocks;
+  unsigned long n_allocs;
+  unsigned long n_failures;
+};
+
 ShmAllocSpace *shm_alloc_space_new (size_t size);
 void shm_alloc_space_free (ShmAllocSpace * self);
 
@@ -66,6 +81,8 @@ void shm_alloc_space_block_dec (ShmAllocBlock * block);
 ShmAllocBlock * shm_alloc_space_block_get (ShmAllocSpace * space,
     unsigned long offset);
 
+void shm_alloc_space_get_stats (ShmAllocSpace * self, ShmAllocStats * stats);
+
 
 #ifdef __cplusplus
 }
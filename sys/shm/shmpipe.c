@@ -67,7 +67,16 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: fd buffer
+ * offset in the file
+ * bufsize
+ * The file descriptor is passed along with the packet as SCM_RIGHTS and the
+ * area id is replaced by an id for the buffer
+ *
+ * type 6: ack fd buffer
+ * No payload, the area id is the id of the buffer
+ *
+ * Types 4 and 6 go from the client to the server
  * The rest are from the server to the client
  * The client should never write in the SHM
  */
@@ -80,7 +89,9 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_FD_BUFFER = 5,
+  COMMAND_ACK_FD_BUFFER = 6
 };
 
 typedef struct _ShmArea ShmArea;
@@ -108,7 +119,9 @@ struct _ShmBuffer
 {
   int use_count;
 
+  /* NULL for buffers passed as file descriptors, which have an id instead */
   ShmArea *shm_area;
+  int id;
   unsigned long offset;
   size_t size;
 
@@ -134,6 +147,7 @@ struct _ShmPipe
   ShmArea *shm_area;
 
   int next_area_id;
+  int next_buffer_id;
 
   ShmBuffer *buffers;
 
@@ -485,6 +499,43 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_with_fd (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int id, int passed_fd)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+
+  cb->type = type;
+  cb->area_id = id;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&control, 0, sizeof (control));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &passed_fd, sizeof (int));
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -639,31 +690,152 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+/* Sends the @size bytes at @offset in the file @fd, which stays owned by the
+ * caller, without copying them to the shm area. Returns the number of
+ * clients it has successfully been sent to */
+
+int
+sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned long offset,
+    size_t size, void *tag)
+{
+  ShmBuffer *sb;
+  ShmClient *client = NULL;
+  int i = 0;
+  int c = 0;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
+  memset (sb, 0, sizeof (ShmBuffer));
+  memset (sb->clients, -1, sizeof (int) * self->num_clients);
+  sb->id = ++self->next_buffer_id;
+  sb->offset = offset;
+  sb->size = size;
+  sb->num_clients = self->num_clients;
+  sb->tag = tag;
+
+  for (client = self->clients; client; client = client->next) {
+    struct CommandBuffer cb = { 0 };
+    cb.payload.buffer.offset = offset;
+    cb.payload.buffer.size = size;
+    if (!send_command_with_fd (client->fd, &cb, COMMAND_NEW_FD_BUFFER,
+            sb->id, fd))
+      continue;
+    sb->clients[i++] = client->fd;
+    c++;
+  }
+
+  if (c == 0) {
+    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
+    return 0;
+  }
+
+  sb->use_count = c;
+
+  sb->next = self->buffers;
+  self->buffers = sb;
+
+  return c;
+}
+
+/* Stores a file descriptor passed along with the command in @passed_fd, or
+ * closes it if @passed_fd is NULL */
 static int
-recv_command (int fd, struct CommandBuffer *cb)
+recv_command (int fd, struct CommandBuffer *cb, int *passed_fd)
 {
   int retval;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+  int flags = MSG_DONTWAIT;
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  if (passed_fd)
+    *passed_fd = -1;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  retval = recvmsg (fd, &msg, flags);
+  if (retval < 0)
+    msg.msg_controllen = 0;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN (sizeof (int))) {
+      int received_fd;
+
+      memcpy (&received_fd, CMSG_DATA (cmsg), sizeof (int));
+      if (passed_fd && *passed_fd < 0)
+        *passed_fd = received_fd;
+      else
+        close (received_fd);
+    }
+  }
 
-  retval = recv (fd, cb, sizeof (struct CommandBuffer), MSG_DONTWAIT);
   if (retval == sizeof (struct CommandBuffer)) {
     return 1;
   } else {
+    if (passed_fd && *passed_fd >= 0) {
+      close (*passed_fd);
+      *passed_fd = -1;
+    }
     return 0;
   }
 }
 
 long int
 sp_client_recv (ShmPipe * self, char **buf)
+{
+  ShmFdBuffer fd_buf;
+  long int retval;
+
+  retval = sp_client_recv_fd (self, buf, &fd_buf);
+
+  /* the caller can't handle buffers passed as file descriptors */
+  if (retval >= 0 && fd_buf.fd >= 0) {
+    close (fd_buf.fd);
+    sp_client_recv_fd_finish (self, fd_buf.id);
+    return -98;
+  }
+
+  return retval;
+}
+
+long int
+sp_client_recv_fd (ShmPipe * self, char **buf, ShmFdBuffer * fd_buf)
 {
   char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
+  int passed_fd;
   int retval;
 
-  if (!recv_command (self->main_socket, &cb))
+  fd_buf->fd = -1;
+
+  if (!recv_command (self->main_socket, &cb, &passed_fd))
     return -1;
 
+  if (passed_fd >= 0 && cb.type != COMMAND_NEW_FD_BUFFER) {
+    close (passed_fd);
+    passed_fd = -1;
+  }
+
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
@@ -709,6 +881,14 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_FD_BUFFER:
+      if (passed_fd < 0)
+        return -24;
+      fd_buf->fd = passed_fd;
+      fd_buf->offset = cb.payload.buffer.offset;
+      fd_buf->id = cb.area_id;
+      return cb.payload.buffer.size;
+
     default:
       return -99;
   }
@@ -722,20 +902,30 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   ShmBuffer *buf = NULL, *prev_buf = NULL;
   struct CommandBuffer cb;
 
-  if (!recv_command (client->fd, &cb))
+  if (!recv_command (client->fd, &cb, NULL))
     return -1;
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
 
       for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
+        if (buf->shm_area && buf->shm_area->id == cb.area_id &&
             buf->offset == cb.payload.ack_buffer.offset) {
           return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
         }
         prev_buf = buf;
       }
 
+      return -2;
+
+    case COMMAND_ACK_FD_BUFFER:
+
+      for (buf = self->buffers; buf; buf = buf->next) {
+        if (!buf->shm_area && buf->id == cb.area_id)
+          return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
+        prev_buf = buf;
+      }
+
       return -2;
     default:
       return -99;
@@ -768,6 +958,14 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
       self->shm_area->id);
 }
 
+int
+sp_client_recv_fd_finish (ShmPipe * self, int id)
+{
+  struct CommandBuffer cb = { 0 };
+
+  return send_command (self->main_socket, &cb, COMMAND_ACK_FD_BUFFER, id);
+}
+
 ShmPipe *
 sp_client_open (const char *path)
 {
@@ -883,8 +1081,10 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
-    sp_shm_area_dec (self, buf->shm_area);
+    if (buf->shm_area) {
+      shm_alloc_space_block_dec (buf->ablock);
+      sp_shm_area_dec (self, buf->shm_area);
+    }
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
     return 0;
   }
@@ -995,3 +1195,14 @@ sp_writer_get_max_buf_size (ShmPipe * self)
 
   return self->shm_area->shm_area_len;
 }
+
+void
+sp_writer_get_alloc_stats (ShmPipe * self, ShmAllocStats * stats)
+{
+  if (self->shm_area == NULL) {
+    memset (stats, 0, sizeof (ShmAllocStats));
+    return;
+  }
+
+  shm_alloc_space_get_stats (self->shm_area->allocspace, stats);
+}
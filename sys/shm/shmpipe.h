@@ -68,6 +68,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "shmalloc.h"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -77,6 +79,15 @@ typedef struct _ShmClient ShmClient;
 typedef struct _ShmPipe ShmPipe;
 typedef struct _ShmBlock ShmBlock;
 typedef struct _ShmBuffer ShmBuffer;
+typedef struct _ShmFdBuffer ShmFdBuffer;
+
+/* A buffer received as a file descriptor, to be acknowledged with its id */
+struct _ShmFdBuffer
+{
+  int fd;
+  unsigned long offset;
+  int id;
+};
 
 typedef void (*sp_buffer_free_callback) (void * tag, void * user_data);
 
@@ -97,9 +108,12 @@ int sp_writer_get_client_fd (ShmClient * client);
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
+int sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned long offset,
+    size_t size, void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
+void sp_writer_get_alloc_stats (ShmPipe * self, ShmAllocStats * stats);
 
 ShmClient * sp_writer_accept_client (ShmPipe * self);
 void sp_writer_close_client (ShmPipe *self, ShmClient * client,
@@ -115,6 +129,8 @@ void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+long int sp_client_recv_fd (ShmPipe * self, char **buf, ShmFdBuffer * fd_buf);
+int sp_client_recv_fd_finish (ShmPipe * self, int id);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
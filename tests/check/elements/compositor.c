@@ -30,6 +30,7 @@
 #endif
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
@@ -1740,6 +1741,162 @@ GST_START_TEST (test_obscured_skipped)
 
 GST_END_TEST;
 
+/* sink_0 is covered by sink_1 on its left half and sink_2 at @xpos2 */
+static void
+_test_obscured_by_two_pads (gint xpos2)
+{
+  GstElement *pipeline, *cfilter, *sink;
+  GstSample *sample;
+  GstPad *srcpad;
+  GError *err = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=c sink_2::xpos=%d ! "
+      "video/x-raw,width=40,height=40 ! appsink name=sink "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=40,height=40 ! "
+      "capsfilter name=cf0 ! c.sink_0 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=20,height=40 ! c.sink_1 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=20,height=40 ! c.sink_2",
+      xpos2);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  fail_unless (pipeline != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+
+  cfilter = gst_bin_get_by_name (GST_BIN (pipeline), "cf0");
+  srcpad = gst_element_get_static_pad (cfilter, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_obscured_pad_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (cfilter);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  do {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (sample)
+      gst_sample_unref (sample);
+  } while (sample != NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_obscured_by_several_pads)
+{
+  buffer_mapped = FALSE;
+  GST_INFO ("testing sink_0 covered by sink_1 and sink_2 together");
+  _test_obscured_by_two_pads (20);
+  fail_unless (buffer_mapped == FALSE);
+
+  buffer_mapped = FALSE;
+  GST_INFO ("testing sink_0 visible between sink_1 and sink_2");
+  _test_obscured_by_two_pads (22);
+  fail_unless (buffer_mapped == TRUE);
+}
+
+GST_END_TEST;
+
+/* sink_1 is opaque and covers the middle of sink_0, which then only gets its
+ * visible parts blended unless one of them has alpha 0.0 */
+static GstBuffer *
+_blend_covered_frame (const gchar * format, gint alpha0, gint alpha1)
+{
+  GstElement *bin, *appsink;
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GError *err = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=64,height=48 ! "
+      "compositor name=c max-threads=2 sink_0::alpha=%d sink_1::xpos=14 "
+      "sink_1::ypos=10 sink_1::alpha=%d ! "
+      "video/x-raw,format=%s,width=64,height=48 ! appsink name=sink "
+      "videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=%s,width=32,height=24 ! c.", format, alpha0,
+      alpha1, format, format);
+  bin = gst_parse_launch (desc, &err);
+  g_free (desc);
+  fail_unless (bin != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+
+  return buffer;
+}
+
+/* Blending only the visible parts of a partially covered pad must give the
+ * same pixels as blending it whole and then the covering pad over it. The
+ * expected frame is made of the sink_0 only output outside of sink_1, and of
+ * the sink_1 only output inside of it */
+GST_START_TEST (test_obscured_partially)
+{
+  static const gchar *formats[] = { "I420", "NV12", "xRGB" };
+  guint i, c, x, y;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstBuffer *culled, *bottom, *top;
+    GstVideoFrame culled_frame, bottom_frame, top_frame;
+    GstVideoInfo info;
+
+    culled = _blend_covered_frame (formats[i], 1, 1);
+    bottom = _blend_covered_frame (formats[i], 1, 0);
+    top = _blend_covered_frame (formats[i], 0, 1);
+
+    gst_video_info_set_format (&info,
+        gst_video_format_from_string (formats[i]), 64, 48);
+    fail_unless (gst_video_frame_map (&culled_frame, &info, culled,
+            GST_MAP_READ));
+    fail_unless (gst_video_frame_map (&bottom_frame, &info, bottom,
+            GST_MAP_READ));
+    fail_unless (gst_video_frame_map (&top_frame, &info, top, GST_MAP_READ));
+
+    for (c = 0; c < GST_VIDEO_INFO_N_COMPONENTS (&info); c++) {
+      const GstVideoFormatInfo *finfo = info.finfo;
+      gint x1 = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, c, 14);
+      gint y1 = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, c, 10);
+      gint x2 = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, c, 14 + 32);
+      gint y2 = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, c, 10 + 24);
+      gint pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (&culled_frame, c);
+
+      for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&culled_frame, c); y++) {
+        for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&culled_frame, c); x++) {
+          gboolean covered = x >= x1 && x < x2 && y >= y1 && y < y2;
+          GstVideoFrame *expected = covered ? &top_frame : &bottom_frame;
+          guint8 *p = GST_VIDEO_FRAME_COMP_DATA (&culled_frame, c) +
+              y * GST_VIDEO_FRAME_COMP_STRIDE (&culled_frame, c) + x * pstride;
+          guint8 *e = GST_VIDEO_FRAME_COMP_DATA (expected, c) +
+              y * GST_VIDEO_FRAME_COMP_STRIDE (expected, c) + x * pstride;
+
+          fail_unless_equals_int (*p, *e);
+        }
+      }
+    }
+
+    gst_video_frame_unmap (&culled_frame);
+    gst_video_frame_unmap (&bottom_frame);
+    gst_video_frame_unmap (&top_frame);
+    gst_buffer_unref (culled);
+    gst_buffer_unref (bottom);
+    gst_buffer_unref (top);
+  }
+}
+
+GST_END_TEST;
+
 static void
 _pipeline_eos (GstBus * bus, GstMessage * message, GstPipeline * bin)
 {
@@ -1834,6 +1991,72 @@ GST_START_TEST (test_repeat_after_eos)
 
 GST_END_TEST;
 
+static GstBuffer *
+_blend_frame_with_threads (const gchar * format, guint max_threads)
+{
+  GstElement *bin, *appsink;
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GError *err = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=I420,width=320,height=240 ! "
+      "compositor name=c max-threads=%u sink_1::xpos=37 sink_1::ypos=61 "
+      "sink_1::alpha=0.5 ! video/x-raw,format=%s,width=640,height=480 ! "
+      "appsink name=sink videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=I420,width=320,height=240 ! c.", max_threads,
+      format);
+  bin = gst_parse_launch (desc, &err);
+  g_free (desc);
+  fail_unless (bin != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+
+  return buffer;
+}
+
+/* Blending in parallel bands must give the same output as a single thread */
+GST_START_TEST (test_max_threads)
+{
+  static const gchar *formats[] = { "I420", "NV12", "AYUV", "BGRA" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstBuffer *single, *threaded;
+    GstMapInfo single_map, threaded_map;
+
+    single = _blend_frame_with_threads (formats[i], 1);
+    threaded = _blend_frame_with_threads (formats[i], 4);
+
+    gst_buffer_map (single, &single_map, GST_MAP_READ);
+    gst_buffer_map (threaded, &threaded_map, GST_MAP_READ);
+    fail_unless_equals_int (single_map.size, threaded_map.size);
+    fail_unless (memcmp (single_map.data, threaded_map.data,
+            single_map.size) == 0, "%s output differs when threaded",
+        formats[i]);
+    gst_buffer_unmap (single, &single_map);
+    gst_buffer_unmap (threaded, &threaded_map);
+
+    gst_buffer_unref (single);
+    gst_buffer_unref (threaded);
+  }
+}
+
+GST_END_TEST;
+
 /* Test that the GST_ELEMENT(vagg)->sinkpads GList is always sorted by zorder */
 GST_START_TEST (test_pad_z_order)
 {
@@ -2099,7 +2322,10 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_flush_start_flush_stop);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
+  tcase_add_test (tc_chain, test_obscured_by_several_pads);
+  tcase_add_test (tc_chain, test_obscured_partially);
   tcase_add_test (tc_chain, test_repeat_after_eos);
+  tcase_add_test (tc_chain, test_max_threads);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_0);
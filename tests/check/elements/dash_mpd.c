@@ -996,6 +996,154 @@ GST_START_TEST
 
 GST_END_TEST;
 
+/*
+ * Test that back to back S nodes of a SegmentTemplate are stored as one run,
+ * and that Representations share the SegmentTimeline they inherit
+ */
+GST_START_TEST (dash_mpdparser_segmentTemplate_segmentTimeline_runs)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstRepresentationNode *representation;
+  GstSegmentTimelineNode *segmentTimeline;
+  GstSNode *sNode;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\">"
+      "  <Period>"
+      "    <AdaptationSet>"
+      "      <SegmentTemplate media=\"$Number$.mp4\">"
+      "        <SegmentTimeline>"
+      "          <S t=\"0\" d=\"2\"/>"
+      "          <S d=\"2\" r=\"1\"/>"
+      "          <S t=\"6\" d=\"2\"/>"
+      "          <S t=\"10\" d=\"2\"/>"
+      "          <S d=\"3\"/>"
+      "        </SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"$Number$.mp4\"/>"
+      "      </Representation>"
+      "    </AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  segmentTimeline =
+      adaptationSet->SegmentTemplate->MultSegBaseType->SegmentTimeline;
+  assert_equals_int (g_queue_get_length (&segmentTimeline->S), 3);
+
+  /* 0, 2, 4 and 6 */
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 0);
+  assert_equals_uint64 (sNode->t, 0);
+  assert_equals_uint64 (sNode->d, 2);
+  assert_equals_int (sNode->r, 3);
+  /* gap before 10 */
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 1);
+  assert_equals_uint64 (sNode->t, 10);
+  assert_equals_uint64 (sNode->d, 2);
+  assert_equals_int (sNode->r, 0);
+  /* different duration */
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 2);
+  assert_equals_uint64 (sNode->d, 3);
+  assert_equals_int (sNode->r, 0);
+
+  representation = (GstRepresentationNode *)
+      adaptationSet->Representations->data;
+  fail_unless (representation->SegmentTemplate->MultSegBaseType->
+      SegmentTimeline == segmentTimeline);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
+/*
+ * Test that a run of merged S nodes crossing the end of the Period keeps
+ * the repetitions before it and only clips the last one
+ */
+GST_START_TEST (dash_mpdparser_segmentTemplate_segmentTimeline_run_period_end)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstMediaSegment *segment;
+  GstMediaFragmentInfo fragment;
+  GstFlowReturn flow;
+  guint i;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H0M7S\">"
+      "  <Period duration=\"P0Y0M0DT0H0M7S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <SegmentTemplate media=\"$Number$.mp4\">"
+      "        <SegmentTimeline>"
+      "          <S t=\"0\" d=\"2\" r=\"1\"/>"
+      "          <S d=\"2\" r=\"1\"/>"
+      "        </SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+
+  /* 0, 2 and 4 stay a run, the one at 6 is cut at 7 */
+  assert_equals_int (activeStream->segments->len, 2);
+  segment = g_ptr_array_index (activeStream->segments, 0);
+  assert_equals_int (segment->number, 1);
+  assert_equals_int (segment->repeat, 2);
+  assert_equals_uint64 (segment->start, 0);
+  assert_equals_uint64 (segment->duration, 2 * GST_SECOND);
+  segment = g_ptr_array_index (activeStream->segments, 1);
+  assert_equals_int (segment->number, 4);
+  assert_equals_int (segment->repeat, 0);
+  assert_equals_uint64 (segment->scale_start, 6);
+  assert_equals_uint64 (segment->start, 6 * GST_SECOND);
+  assert_equals_uint64 (segment->duration, 1 * GST_SECOND);
+
+  for (i = 0; i < 4; i++) {
+    ret = gst_mpd_client_get_next_fragment (mpdclient, 0, &fragment);
+    assert_equals_int (ret, TRUE);
+    assert_equals_uint64 (fragment.timestamp, 2 * i * GST_SECOND);
+    assert_equals_uint64 (fragment.duration, (i < 3 ? 2 : 1) * GST_SECOND);
+    gst_media_fragment_info_clear (&fragment);
+
+    flow = gst_mpd_client_advance_segment (mpdclient, activeStream, TRUE);
+    assert_equals_int (flow, i < 3 ? GST_FLOW_OK : GST_FLOW_EOS);
+  }
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing Period SegmentTemplate MultipleSegmentBaseType
  * BitstreamSwitching attributes
@@ -4975,6 +5123,101 @@ GST_START_TEST (dash_mpdparser_multiple_inherited_segmentURL)
 
 GST_END_TEST;
 
+/*
+ * Test that a manifest update shares the unchanged nodes with the previous
+ * manifest and only parses the changed ones
+ *
+ */
+#define UPDATE_MPD_TEMPLATE \
+  "<?xml version=\"1.0\"?>" \
+  "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\"" \
+  "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\"" \
+  "     type=\"dynamic\"" \
+  "     publishTime=\"%s\">" \
+  "  <Period id=\"p0\" start=\"PT0S\">" \
+  "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">" \
+  "      <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>" \
+  "      <Representation id=\"v1\" bandwidth=\"250000\"/>" \
+  "      <Representation id=\"v2\" bandwidth=\"500000\"/>" \
+  "    </AdaptationSet>" \
+  "    <AdaptationSet id=\"2\" mimeType=\"audio/mp4\">" \
+  "      <Representation id=\"a1\" bandwidth=\"64000\"/>" \
+  "      <Representation id=\"a2\" bandwidth=\"128000\"/>" \
+  "    </AdaptationSet>" \
+  "  </Period>" \
+  "  <Period id=\"p1\" start=\"PT60S\">" \
+  "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">" \
+  "      <SegmentTemplate media=\"$Number$.m4s\" duration=\"2\"/>" \
+  "      <Representation id=\"v1\" bandwidth=\"250000\"/>" \
+  "      <Representation id=\"v2\" bandwidth=\"500000\"/>" \
+  "    </AdaptationSet>" \
+  "    <AdaptationSet id=\"2\" mimeType=\"audio/mp4\">" \
+  "      <Representation id=\"a1\" bandwidth=\"%u\"/>" \
+  "      <Representation id=\"a2\" bandwidth=\"128000\"/>" \
+  "    </AdaptationSet>" \
+  "  </Period>" \
+  "</MPD>"
+
+GST_START_TEST (dash_mpdparser_update_reuse_nodes)
+{
+  GstPeriodNode *old_period, *new_period;
+  GstAdaptationSetNode *old_set, *new_set;
+  gchar *xml;
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+  GstMpdClient *new_client;
+
+  xml = g_strdup_printf (UPDATE_MPD_TEMPLATE, "2015-03-24T0:0:0", 64000);
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  g_free (xml);
+
+  /* same content but for the publish time and one Representation */
+  xml = g_strdup_printf (UPDATE_MPD_TEMPLATE, "2015-03-24T0:0:2", 96000);
+  new_client = gst_mpd_client_new ();
+  ret = gst_mpd_parse_update (new_client, mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+  g_free (xml);
+
+  /* the first Period did not change at all */
+  old_period = g_list_nth_data (mpdclient->mpd_node->Periods, 0);
+  new_period = g_list_nth_data (new_client->mpd_node->Periods, 0);
+  fail_unless (old_period == new_period);
+
+  /* the second one did, but its video AdaptationSet is the same */
+  old_period = g_list_nth_data (mpdclient->mpd_node->Periods, 1);
+  new_period = g_list_nth_data (new_client->mpd_node->Periods, 1);
+  fail_unless (old_period != new_period);
+  assert_equals_string (new_period->id, "p1");
+  fail_unless (g_list_nth_data (old_period->AdaptationSets, 0) ==
+      g_list_nth_data (new_period->AdaptationSets, 0));
+
+  /* in the audio one only the second Representation is the same */
+  old_set = g_list_nth_data (old_period->AdaptationSets, 1);
+  new_set = g_list_nth_data (new_period->AdaptationSets, 1);
+  fail_unless (old_set != new_set);
+  fail_unless (g_list_nth_data (old_set->Representations, 0) !=
+      g_list_nth_data (new_set->Representations, 0));
+  fail_unless (g_list_nth_data (old_set->Representations, 1) ==
+      g_list_nth_data (new_set->Representations, 1));
+  assert_equals_int (((GstRepresentationNode *)
+          g_list_nth_data (new_set->Representations, 0))->bandwidth, 96000);
+
+  /* Period p0 with its 2 AdaptationSets and 4 Representations, plus 3 + 1
+   * nodes of p1 */
+  assert_equals_int (new_client->reused_nodes, 11);
+  /* p1, its audio AdaptationSet and Representation a1 */
+  assert_equals_int (new_client->parsed_nodes, 3);
+
+  /* the shared nodes must survive the previous manifest */
+  gst_mpd_client_free (mpdclient);
+  assert_equals_string (((GstPeriodNode *) new_client->mpd_node->
+          Periods->data)->id, "p0");
+  gst_mpd_client_free (new_client);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple segmentURL
  *
@@ -5890,6 +6133,10 @@ dash_suite (void)
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline_s);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_segmentTemplate_segmentTimeline_runs);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_segmentTemplate_segmentTimeline_run_period_end);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_bitstreamSwitching);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_period_adaptationSet);
@@ -6002,6 +6249,7 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_update_reuse_nodes);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
   tcase_add_test (tc_negativeTests, dash_mpdparser_missing_xml);
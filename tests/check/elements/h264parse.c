@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -516,6 +517,228 @@ h264parse_packetized_suite (void)
   return s;
 }
 
+/* Appends @nal, given with a 4 byte start code, with a 4 byte start code or
+ * length prefix */
+static void
+append_nal (GByteArray * au, const guint8 * nal, guint size, gboolean avc)
+{
+  guint8 prefix[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+  if (avc)
+    GST_WRITE_UINT32_BE (prefix, size - 4);
+  g_byte_array_append (au, prefix, 4);
+  g_byte_array_append (au, nal + 4, size - 4);
+}
+
+static GstBuffer *
+au_to_buffer (GByteArray * au)
+{
+  guint size = au->len;
+
+  return gst_buffer_new_wrapped (g_byte_array_free (au, FALSE), size);
+}
+
+static GstBuffer *
+pull_and_check (GstHarness * h, GByteArray * expected)
+{
+  GstBuffer *buf;
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buf), expected->len);
+  fail_unless (gst_buffer_memcmp (buf, 0, expected->data,
+          expected->len) == 0);
+  g_byte_array_unref (expected);
+
+  return buf;
+}
+
+/* Pushes @au and returns the address of its data */
+static gconstpointer
+push_au (GstHarness * h, GByteArray * au)
+{
+  gconstpointer data;
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  buf = au_to_buffer (au);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  data = map.data;
+  gst_buffer_unmap (buf, &map);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  return data;
+}
+
+/* Pushes an AVC IDR AU and returns the address of its data */
+static gconstpointer
+push_avc_idr (GstHarness * h)
+{
+  GByteArray *au = g_byte_array_new ();
+
+  append_nal (au, h264_idrframe, sizeof (h264_idrframe), TRUE);
+
+  return push_au (h, au);
+}
+
+static GstHarness *
+setup_avc_to_bs_harness (gint config_interval)
+{
+  GstHarness *h;
+  GstBuffer *cdata;
+  GstCaps *caps;
+
+  h = gst_harness_new ("h264parse");
+  g_object_set (h->element, "config-interval", config_interval, NULL);
+
+  cdata = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      h264_avc_codec_data, sizeof (h264_avc_codec_data), 0,
+      sizeof (h264_avc_codec_data), NULL, NULL);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+  gst_harness_set_src_caps (h, caps);
+  gst_harness_set_sink_caps_str (h, SINK_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au");
+
+  return h;
+}
+
+static GByteArray *
+bs_idr_au (gboolean with_config)
+{
+  GByteArray *au = g_byte_array_new ();
+
+  append_nal (au, h264_aud, sizeof (h264_aud), FALSE);
+  if (with_config) {
+    append_nal (au, h264_sps, sizeof (h264_sps), FALSE);
+    append_nal (au, h264_pps, sizeof (h264_pps), FALSE);
+  }
+  append_nal (au, h264_idrframe, sizeof (h264_idrframe), FALSE);
+
+  return au;
+}
+
+/* Checks that the last memory of @buf is the @size bytes of input memory at
+ * @data, which the NAL prefixes were rewritten in */
+static void
+check_in_place (GstBuffer * buf, gconstpointer data, gsize size)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+
+  mem = gst_buffer_peek_memory (buf, gst_buffer_n_memory (buf) - 1);
+  fail_unless (gst_memory_map (mem, &map, GST_MAP_READ));
+  fail_unless (map.data == data);
+  fail_unless_equals_int (map.size, size);
+  gst_memory_unmap (mem, &map);
+}
+
+/* AVC AUs are converted by rewriting the length prefixes of the input, the
+ * SPS/PPS of the codec data are inserted before the first IDR */
+GST_START_TEST (test_parse_avc_to_bs_in_place)
+{
+  gconstpointer data;
+  GstHarness *h;
+  GstBuffer *buf;
+
+  h = setup_avc_to_bs_harness (0);
+
+  data = push_avc_idr (h);
+  buf = pull_and_check (h, bs_idr_au (TRUE));
+  check_in_place (buf, data, sizeof (h264_idrframe));
+  gst_buffer_unref (buf);
+
+  data = push_avc_idr (h);
+  buf = pull_and_check (h, bs_idr_au (FALSE));
+  fail_unless_equals_int (gst_buffer_n_memory (buf), 2);
+  check_in_place (buf, data, sizeof (h264_idrframe));
+  gst_buffer_unref (buf);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* With config-interval -1 the SPS/PPS are inserted before every IDR of the
+ * AUs converted in place */
+GST_START_TEST (test_parse_avc_to_bs_config_interval)
+{
+  gconstpointer data;
+  GstHarness *h;
+  GstBuffer *buf;
+  guint i;
+
+  h = setup_avc_to_bs_harness (-1);
+
+  for (i = 0; i < 3; i++) {
+    data = push_avc_idr (h);
+    buf = pull_and_check (h, bs_idr_au (TRUE));
+    check_in_place (buf, data, sizeof (h264_idrframe));
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Byte-stream AUs with 4 byte start codes are converted to AVC by
+ * rewriting the start codes of the input */
+GST_START_TEST (test_parse_bs_to_avc_in_place)
+{
+  GByteArray *au, *expected;
+  gconstpointer data;
+  GstHarness *h;
+  GstBuffer *buf;
+  guint i, size;
+
+  h = gst_harness_new ("h264parse");
+  gst_harness_set_src_caps_str (h, SRC_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au");
+  gst_harness_set_sink_caps_str (h, SINK_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au");
+
+  for (i = 0; i < 2; i++) {
+    au = g_byte_array_new ();
+    expected = g_byte_array_new ();
+    if (i == 0) {
+      append_nal (au, h264_sps, sizeof (h264_sps), FALSE);
+      append_nal (au, h264_pps, sizeof (h264_pps), FALSE);
+      append_nal (expected, h264_sps, sizeof (h264_sps), TRUE);
+      append_nal (expected, h264_pps, sizeof (h264_pps), TRUE);
+    }
+    append_nal (au, h264_idrframe, sizeof (h264_idrframe), FALSE);
+    append_nal (expected, h264_idrframe, sizeof (h264_idrframe), TRUE);
+
+    size = au->len;
+    data = push_au (h, au);
+    buf = pull_and_check (h, expected);
+    fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+    check_in_place (buf, data, size);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_conversion_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_avc_to_bs_in_place);
+  tcase_add_test (tc_chain, test_parse_avc_to_bs_config_interval);
+  tcase_add_test (tc_chain, test_parse_bs_to_avc_in_place);
+
+  return s;
+}
+
 
 /*
  * TODO:
@@ -614,5 +837,9 @@ main (int argc, char **argv)
   s = h264parse_packetized_suite ();
   nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_packetized.c");
 
+  ctx_suite = "h264parse_conversion";
+  s = h264parse_conversion_suite ();
+  nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_conversion.c");
+
   return nf;
 }
@@ -0,0 +1,157 @@
+/* GStreamer
+ *
+ * unit test for h265parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define SRC_CAPS_TMPL   "video/x-h265, parsed=(boolean)false"
+#define SINK_CAPS_TMPL  "video/x-h265, parsed=(boolean)true"
+
+/* Main profile 64x64 parameter sets and an IDR slice, with 4 byte start
+ * codes */
+static guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xf0, 0x24
+};
+
+static guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+  0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+  0x03, 0x00, 0x00, 0x03, 0x00, 0x1e, 0xa0, 0x20,
+  0x81, 0x05, 0x97, 0xe4, 0x93, 0x08, 0x20
+};
+
+static guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x71,
+  0x80, 0x12
+};
+
+static guint8 h265_idr[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x55,
+  0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86, 0x8d,
+  0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe, 0xc5,
+  0xcc, 0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6, 0xfd,
+  0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e, 0x35,
+  0x3c, 0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66
+};
+
+/* Appends @nal, given with a 4 byte start code, with a 4 byte start code or
+ * length prefix */
+static void
+append_nal (GByteArray * au, const guint8 * nal, guint size, gboolean hvc)
+{
+  guint8 prefix[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+  if (hvc)
+    GST_WRITE_UINT32_BE (prefix, size - 4);
+  g_byte_array_append (au, prefix, 4);
+  g_byte_array_append (au, nal + 4, size - 4);
+}
+
+/* Pushes @au and returns the address of its data */
+static gconstpointer
+push_au (GstHarness * h, GByteArray * au)
+{
+  gconstpointer data;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint size = au->len;
+
+  buf = gst_buffer_new_wrapped (g_byte_array_free (au, FALSE), size);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  data = map.data;
+  gst_buffer_unmap (buf, &map);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  return data;
+}
+
+/* Byte-stream AUs with 4 byte start codes are converted to HVC1 by
+ * rewriting the start codes of the input */
+GST_START_TEST (test_parse_bs_to_hvc1_in_place)
+{
+  GByteArray *au, *expected;
+  gconstpointer data;
+  GstHarness *h;
+  GstBuffer *buf;
+  GstMemory *mem;
+  GstMapInfo map;
+  guint i, size;
+
+  h = gst_harness_new ("h265parse");
+  gst_harness_set_src_caps_str (h, SRC_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au");
+  gst_harness_set_sink_caps_str (h, SINK_CAPS_TMPL
+      ", stream-format = (string) hvc1, alignment = (string) au");
+
+  for (i = 0; i < 2; i++) {
+    au = g_byte_array_new ();
+    expected = g_byte_array_new ();
+    if (i == 0) {
+      append_nal (au, h265_vps, sizeof (h265_vps), FALSE);
+      append_nal (au, h265_sps, sizeof (h265_sps), FALSE);
+      append_nal (au, h265_pps, sizeof (h265_pps), FALSE);
+      append_nal (expected, h265_vps, sizeof (h265_vps), TRUE);
+      append_nal (expected, h265_sps, sizeof (h265_sps), TRUE);
+      append_nal (expected, h265_pps, sizeof (h265_pps), TRUE);
+    }
+    append_nal (au, h265_idr, sizeof (h265_idr), FALSE);
+    append_nal (expected, h265_idr, sizeof (h265_idr), TRUE);
+
+    size = au->len;
+    data = push_au (h, au);
+
+    buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (buf), expected->len);
+    fail_unless (gst_buffer_memcmp (buf, 0, expected->data,
+            expected->len) == 0);
+    g_byte_array_unref (expected);
+
+    /* the output is the input memory */
+    fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+    mem = gst_buffer_peek_memory (buf, 0);
+    fail_unless (gst_memory_map (mem, &map, GST_MAP_READ));
+    fail_unless (map.data == data);
+    fail_unless_equals_int (map.size, size);
+    gst_memory_unmap (mem, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parse_suite (void)
+{
+  Suite *s = suite_create ("h265parse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_bs_to_hvc1_in_place);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parse);
@@ -726,6 +726,147 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+/* the fragment downloads of the prefetch threads run concurrently with the
+ * ones of the streaming thread */
+static GMutex prefetch_test_lock;
+static GCond prefetch_test_cond;
+
+static gboolean
+gst_hlsdemux_test_prefetch_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  gboolean ret;
+
+  g_mutex_lock (&prefetch_test_lock);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, user_data);
+  g_cond_broadcast (&prefetch_test_cond);
+  g_mutex_unlock (&prefetch_test_lock);
+
+  return ret;
+}
+
+static gboolean
+gst_hlsdemux_test_was_requested (const GstHlsDemuxTestCase * test_case,
+    const gchar * uri, guint * count)
+{
+  const GValue *requests;
+  guint i;
+
+  *count = 0;
+  requests = gst_structure_get_value (test_case->state, "requests");
+  if (requests == NULL)
+    return FALSE;
+
+  for (i = 0; i < gst_value_array_get_size (requests); i++) {
+    const GValue *uri_val = gst_value_array_get_value (requests, i);
+
+    if (g_strcmp0 (g_value_get_string (uri_val), uri) == 0)
+      (*count)++;
+  }
+
+  return *count > 0;
+}
+
+static GstFlowReturn
+gst_hlsdemux_test_prefetch_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  const GstHlsDemuxTestCase *test_case =
+      (const GstHlsDemuxTestCase *) user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+
+  /* don't deliver the first fragment before the following ones are being
+   * fetched, so that they can only come from a prefetch */
+  if (offset == 0 && g_str_has_suffix (input->uri, "/001.ts")) {
+    gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+    guint count;
+
+    g_mutex_lock (&prefetch_test_lock);
+    while (!gst_hlsdemux_test_was_requested (test_case,
+            "http://unit.test/003.ts", &count)) {
+      if (!g_cond_wait_until (&prefetch_test_cond, &prefetch_test_lock,
+              end_time)) {
+        g_mutex_unlock (&prefetch_test_lock);
+        fail ("Following fragments were not prefetched");
+        return GST_FLOW_ERROR;
+      }
+    }
+    g_mutex_unlock (&prefetch_test_lock);
+  }
+
+  return gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      user_data);
+}
+
+static void
+testPrefetchPreTest (GstAdaptiveDemuxTestEngine * engine, gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-fragments", 2, NULL);
+}
+
+/*
+ * Test a media manifest with several segments, with the following ones
+ * being prefetched while the current one is still downloading. Their data
+ * must come out once and in order.
+ */
+GST_START_TEST (testPrefetch)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  guint i, count;
+  TESTCASE_INIT_BOILERPLATE (0);
+
+  /* one continuous stream cut into the fragments */
+  mpeg_ts = generate_transport_stream (4 * segment_size);
+  for (i = 0; i < 4; i++)
+    inputTestData[i + 1].payload = mpeg_ts->data + i * segment_size;
+  outputTestData[0].expected_data = mpeg_ts->data;
+  engineTestData->output_streams =
+      g_list_append (engineTestData->output_streams, &outputTestData[0]);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_prefetch_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_prefetch_src_create;
+  engine_callbacks.pre_test = testPrefetchPreTest;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  /* every fragment was downloaded once, either directly or prefetched */
+  for (i = 1; i < 5; i++) {
+    fail_unless (gst_hlsdemux_test_was_requested (&hlsTestCase,
+            inputTestData[i].uri, &count));
+    fail_unless_equals_int (count, 1);
+  }
+
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -745,6 +886,7 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testSeekSnapAfterPosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapBeforePosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapAfterPosition);
+  tcase_add_test (tc_basicTest, testPrefetch);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
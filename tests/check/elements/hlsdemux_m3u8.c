@@ -701,6 +701,124 @@ GST_START_TEST (test_update_playlist)
 
 GST_END_TEST;
 
+static gchar *
+generate_live_playlist (const gchar * prefix, gint first, guint n_files)
+{
+  GString *s;
+  guint i;
+
+  s = g_string_new ("#EXTM3U\n#EXT-X-TARGETDURATION:8\n");
+  g_string_append_printf (s, "#EXT-X-MEDIA-SEQUENCE:%d\n", first);
+  for (i = 0; i < n_files; i++)
+    g_string_append_printf (s, "#EXTINF:8,\n%s%u.ts\n", prefix, first + i);
+
+  return g_string_free (s, FALSE);
+}
+
+GST_START_TEST (test_update_playlist_incremental)
+{
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file, *kept;
+  GstClockTime start;
+  gint64 sequence;
+  GList *l;
+  gint i;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live.m3u8", NULL, "live.m3u8");
+  fail_unless (gst_m3u8_update (pl, generate_live_playlist ("segment", 100,
+              10)));
+  kept = g_list_nth_data (pl->files, 5);
+  assert_equals_int64 (kept->sequence, 105);
+
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  sequence = file->sequence;
+  gst_m3u8_media_file_unref (file);
+
+  /* Slide the window by three files */
+  fail_unless (gst_m3u8_update (pl, generate_live_playlist ("segment", 103,
+              10)));
+  assert_equals_int (g_list_length (pl->files), 10);
+
+  /* Files of the previous playlist are taken over as they are */
+  fail_unless (g_list_nth_data (pl->files, 2) == kept);
+  file = g_list_last (pl->files)->data;
+  assert_equals_int64 (file->sequence, 112);
+  assert_equals_string (file->uri, "http://localhost/segment112.ts");
+  assert_equals_uint64 (file->duration, 8 * GST_SECOND);
+  for (i = 112, l = g_list_last (pl->files); l; l = l->prev, i--)
+    assert_equals_int64 (GST_M3U8_MEDIA_FILE (l->data)->sequence, i);
+  assert_equals_int (i, 102);
+
+  /* The current fragment is found again in the updated playlist */
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  assert_equals_int64 (file->sequence, sequence);
+  gst_m3u8_media_file_unref (file);
+
+  l = gst_m3u8_find_file_at_time (pl, 20 * GST_SECOND, &start);
+  fail_unless (l != NULL);
+  assert_equals_int64 (GST_M3U8_MEDIA_FILE (l->data)->sequence, 105);
+  assert_equals_uint64 (start, 16 * GST_SECOND);
+  fail_unless (gst_m3u8_find_file_at_time (pl, 80 * GST_SECOND, NULL) == NULL);
+
+  /* A known sequence number with a different URI is an error, and the
+   * previous playlist is kept */
+  fail_if (gst_m3u8_update (pl, generate_live_playlist ("other", 104, 10)));
+  assert_equals_int (g_list_length (pl->files), 10);
+  fail_unless (g_list_nth_data (pl->files, 2) == kept);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
+#define LARGE_PLAYLIST_FILES 10000
+#define LARGE_PLAYLIST_UPDATES 100
+
+GST_START_TEST (test_update_large_live_playlist)
+{
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  GTimer *timer;
+  GList *l;
+  gint i;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live.m3u8", NULL, "live.m3u8");
+
+  timer = g_timer_new ();
+  for (i = 0; i < LARGE_PLAYLIST_UPDATES; i++) {
+    fail_unless (gst_m3u8_update (pl, generate_live_playlist ("segment", i * 3,
+                LARGE_PLAYLIST_FILES)));
+
+    file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+    fail_unless (file != NULL);
+    gst_m3u8_media_file_unref (file);
+    gst_m3u8_advance_fragment (pl, TRUE);
+  }
+  GST_INFO ("%d updates of a %d files playlist took %.3f seconds",
+      LARGE_PLAYLIST_UPDATES, LARGE_PLAYLIST_FILES,
+      g_timer_elapsed (timer, NULL));
+  g_timer_destroy (timer);
+
+  assert_equals_int (g_list_length (pl->files), LARGE_PLAYLIST_FILES);
+  file = g_list_first (pl->files)->data;
+  assert_equals_int64 (file->sequence, (LARGE_PLAYLIST_UPDATES - 1) * 3);
+  file = g_list_last (pl->files)->data;
+  assert_equals_int64 (file->sequence,
+      (LARGE_PLAYLIST_UPDATES - 1) * 3 + LARGE_PLAYLIST_FILES - 1);
+
+  l = gst_m3u8_find_file_at_time (pl,
+      (LARGE_PLAYLIST_FILES / 2) * 8 * GST_SECOND + GST_SECOND, NULL);
+  fail_unless (l != NULL);
+  assert_equals_int64 (GST_M3U8_MEDIA_FILE (l->data)->sequence,
+      (LARGE_PLAYLIST_UPDATES - 1) * 3 + LARGE_PLAYLIST_FILES / 2);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_playlist_media_files)
 {
   GstHLSMasterPlaylist *master;
@@ -832,6 +950,43 @@ GST_START_TEST (test_get_next_fragment)
 
 GST_END_TEST;
 
+GST_START_TEST (test_peek_fragment)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *mf;
+
+  master = load_playlist (BYTE_RANGES_PLAYLIST);
+  pl = master->default_variant->m3u8;
+
+  mf = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  /* Peeking ahead doesn't change the current fragment */
+  mf = gst_m3u8_peek_fragment (pl, TRUE, 2);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 2000);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_peek_fragment (pl, TRUE, 1);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 1000);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  /* There are only four fragments */
+  fail_unless (gst_m3u8_peek_fragment (pl, TRUE, 4) == NULL);
+  fail_unless (gst_m3u8_peek_fragment (pl, FALSE, 1) == NULL);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_get_duration)
 {
   GstHLSMasterPlaylist *master;
@@ -1421,9 +1576,12 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
+  tcase_add_test (tc_m3u8, test_update_playlist_incremental);
+  tcase_add_test (tc_m3u8, test_update_large_live_playlist);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
+  tcase_add_test (tc_m3u8, test_peek_fragment);
   tcase_add_test (tc_m3u8, test_get_duration);
   tcase_add_test (tc_m3u8, test_get_target_duration);
   tcase_add_test (tc_m3u8, test_get_stream_for_bitrate);
@@ -0,0 +1,157 @@
+/* GStreamer
+ *
+ * unit test for intervideosink and intervideosrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define VIDEO_CAPS "video/x-raw, format = (string) I420, " \
+    "width = (int) 16, height = (int) 16, framerate = (fraction) 25/1"
+#define FRAME_SIZE (16 * 16 * 3 / 2)
+/* black in limited range I420 */
+#define BLACK 16
+
+static void
+push_frame (GstHarness * h, guint8 value)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, FRAME_SIZE, NULL);
+
+  gst_buffer_memset (buf, 0, value, FRAME_SIZE);
+  GST_BUFFER_PTS (buf) = (value - 1) * 40 * GST_MSECOND;
+  GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+static GstHarness *
+setup_src (void)
+{
+  GstHarness *h;
+
+  h = gst_harness_new ("intervideosrc");
+  /* start outputting black frames after repeating a frame twice */
+  g_object_set (h->element, "timeout", 80 * GST_MSECOND, NULL);
+  gst_harness_set_sink_caps_str (h, VIDEO_CAPS);
+  gst_harness_use_testclock (h);
+  gst_harness_play (h);
+
+  return h;
+}
+
+/* Lets the source output the frame it created last, and returns it once the
+ * source also created the next one */
+static void
+pull_frame (GstHarness * h, guint8 expected)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  fail_unless (gst_harness_crank_single_clock_wait (h));
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  fail_unless (gst_harness_wait_for_clock_id_waits (h, 1, 5));
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, FRAME_SIZE);
+  fail_unless_equals_int (map.data[0], expected);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+}
+
+static void
+check_stats (GstHarness * h, guint64 dropped, guint64 duplicated,
+    guint64 black)
+{
+  GstStructure *stats;
+  guint64 value;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+
+  fail_unless (gst_structure_get_uint64 (stats, "dropped", &value));
+  fail_unless_equals_uint64 (value, dropped);
+  fail_unless (gst_structure_get_uint64 (stats, "duplicated", &value));
+  fail_unless_equals_uint64 (value, duplicated);
+  fail_unless (gst_structure_get_uint64 (stats, "black", &value));
+  fail_unless_equals_uint64 (value, black);
+
+  gst_structure_free (stats);
+}
+
+/* Both sources see every frame of the channel. Each harness has its own
+ * clock, so they pick the newest frame instead of comparing times. */
+GST_START_TEST (test_two_sources)
+{
+  GstHarness *sink, *src1, *src2;
+
+  sink = gst_harness_new ("intervideosink");
+  g_object_set (sink->element, "sync", FALSE, NULL);
+  gst_harness_set_src_caps_str (sink, VIDEO_CAPS);
+
+  push_frame (sink, 1);
+  push_frame (sink, 2);
+  push_frame (sink, 3);
+
+  /* the first frames are the newest, the next ones repeat them */
+  src1 = setup_src ();
+  src2 = setup_src ();
+  pull_frame (src1, 3);
+  pull_frame (src2, 3);
+  check_stats (src1, 0, 1, 0);
+  check_stats (src2, 0, 1, 0);
+
+  /* frame 4 is replaced by frame 5 before either source reads it */
+  push_frame (sink, 4);
+  push_frame (sink, 5);
+
+  pull_frame (src2, 3);
+  pull_frame (src2, 5);
+  check_stats (src2, 1, 2, 0);
+
+  /* frame 5 is repeated until the timeout, then black frames follow */
+  pull_frame (src1, 3);
+  pull_frame (src1, 5);
+  pull_frame (src1, 5);
+  pull_frame (src1, 5);
+  pull_frame (src1, BLACK);
+  check_stats (src1, 1, 3, 2);
+
+  gst_harness_teardown (src1);
+  gst_harness_teardown (src2);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+static Suite *
+intervideo_suite (void)
+{
+  Suite *s = suite_create ("intervideo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_two_sources);
+
+  return s;
+}
+
+GST_CHECK_MAIN (intervideo);
@@ -803,6 +803,76 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+#define CBR_BITRATE 2000000
+#define CBR_N_BUFFERS 26
+
+GST_START_TEST (test_cbr)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstCaps *caps;
+  GstClockTime ts = 0;
+  guint64 n_bytes = 0, expected;
+  guint null_packets = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", (guint64) CBR_BITRATE, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < CBR_N_BUFFERS; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (1000);
+
+    gst_buffer_memset (inbuffer, 0, 0, 1000);
+    GST_BUFFER_PTS (inbuffer) = ts;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    if (i != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  while (buffers != NULL) {
+    GstBuffer *outbuffer = GST_BUFFER (buffers->data);
+    GstMapInfo map;
+    gsize offset;
+
+    buffers = g_list_remove (buffers, outbuffer);
+
+    gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+    fail_unless (map.size % 188 == 0);
+    for (offset = 0; offset < map.size; offset += 188) {
+      fail_unless_equals_int (map.data[offset], 0x47);
+      if ((GST_READ_UINT16_BE (map.data + offset + 1) & 0x1fff) == 0x1fff)
+        null_packets++;
+    }
+    n_bytes += map.size;
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+
+  /* the output is padded up to the end of the last frame at EOS */
+  expected = gst_util_uint64_scale (ts, CBR_BITRATE, 8 * GST_SECOND);
+  GST_LOG ("%" G_GUINT64_FORMAT " bytes, %u null packets, expected %"
+      G_GUINT64_FORMAT, n_bytes, null_packets, expected);
+  fail_unless (null_packets > 0);
+  fail_unless (n_bytes >= expected);
+  fail_unless (n_bytes < expected + 188);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +889,7 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_cbr);
 
   return s;
 }
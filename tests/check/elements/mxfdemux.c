@@ -21,13 +21,20 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include "mxfdemux.h"
 
 static GstPad *mysrcpad, *mysinkpad;
+/* upstream pulls, and the largest one */
+static guint64 n_pulls, bytes_pulled;
+static guint64 largest_pull_offset;
+static guint largest_pull_size;
 static GMainLoop *loop = NULL;
 static gboolean have_eos = FALSE;
 static gboolean have_data = FALSE;
+/* whether the memory of the essence was only referenced by its buffer */
+static gboolean have_writable_data = FALSE;
 
 static GstStaticPadTemplate mysrctemplate =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
@@ -72,6 +79,7 @@ _sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   fail_unless (GST_BUFFER_TIMESTAMP (buffer) == 0);
   fail_unless (GST_BUFFER_DURATION (buffer) == 200 * GST_MSECOND);
 
+  have_writable_data = gst_buffer_is_memory_range_writable (buffer, 0, -1);
   gst_buffer_unref (buffer);
 
   have_data = TRUE;
@@ -134,8 +142,17 @@ static GstFlowReturn
 _src_getrange (GstPad * pad, GstObject * parent, guint64 offset, guint length,
     GstBuffer ** buffer)
 {
-  if (offset + length > sizeof (mxf_file))
+  /* like filesrc, return what is left at the end */
+  if (offset >= sizeof (mxf_file))
     return GST_FLOW_EOS;
+  length = MIN (length, sizeof (mxf_file) - offset);
+
+  n_pulls++;
+  bytes_pulled += length;
+  if (length > largest_pull_size) {
+    largest_pull_offset = offset;
+    largest_pull_size = length;
+  }
 
   *buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
       (guint8 *) (mxf_file + offset), length, 0, length, NULL, NULL);
@@ -184,18 +201,21 @@ _create_src_pad_pull (void)
   return mysrcpad;
 }
 
-GST_START_TEST (test_pull)
+/* Demuxes the file in pull mode, optionally getting the stats before they
+ * are reset on stopping */
+static void
+run_pull (GstElement * mxfdemux, GstStructure ** stats)
 {
   GstStateChangeReturn sret;
-  GstElement *mxfdemux;
   GstPad *sinkpad;
 
   have_eos = FALSE;
   have_data = FALSE;
+  have_writable_data = FALSE;
+  n_pulls = bytes_pulled = 0;
+  largest_pull_offset = largest_pull_size = 0;
   loop = g_main_loop_new (NULL, FALSE);
 
-  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
-  fail_unless (mxfdemux != NULL);
   g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
   sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
   fail_unless (sinkpad != NULL);
@@ -219,17 +239,87 @@ GST_START_TEST (test_pull)
   fail_unless (have_eos == TRUE);
   fail_unless (have_data == TRUE);
 
+  if (stats) {
+    g_object_get (mxfdemux, "stats", stats, NULL);
+    fail_unless (*stats != NULL);
+  }
+
   gst_element_set_state (mxfdemux, GST_STATE_NULL);
   gst_pad_set_active (mysinkpad, FALSE);
   gst_pad_set_active (mysrcpad, FALSE);
 
-  gst_object_unref (mxfdemux);
   gst_object_unref (mysinkpad);
   gst_object_unref (mysrcpad);
   g_main_loop_unref (loop);
   loop = NULL;
 }
 
+GST_START_TEST (test_pull)
+{
+  GstElement *mxfdemux;
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+
+  run_pull (mxfdemux, NULL);
+
+  gst_object_unref (mxfdemux);
+}
+
+GST_END_TEST;
+
+/* The fill item at offset 4137 has a 20 byte key and length, followed by
+ * the largest value of the file */
+#define FILL_VALUE_OFFSET (4137 + 20)
+#define FILL_VALUE_SIZE 15838
+
+GST_START_TEST (test_pull_read_ahead)
+{
+  GstElement *mxfdemux;
+  GstStructure *stats;
+  guint64 pulls, hits, bytes;
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "read-ahead", 4096, NULL);
+
+  run_pull (mxfdemux, &stats);
+
+  fail_unless (gst_structure_get_uint64 (stats, "pulls", &pulls));
+  fail_unless (gst_structure_get_uint64 (stats, "read-ahead-hits", &hits));
+  fail_unless (gst_structure_get_uint64 (stats, "bytes-pulled", &bytes));
+  gst_structure_free (stats);
+
+  fail_unless_equals_uint64 (pulls, n_pulls);
+  fail_unless_equals_uint64 (bytes, bytes_pulled);
+  /* most keys, lengths and small values come from the blocks */
+  fail_unless (hits > pulls);
+
+  /* the fill value was pulled along with the header of the next packet */
+  fail_unless_equals_uint64 (largest_pull_offset, FILL_VALUE_OFFSET);
+  fail_unless (largest_pull_size >= FILL_VALUE_SIZE + 17);
+
+  gst_object_unref (mxfdemux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_read_ahead_large_value)
+{
+  GstElement *mxfdemux;
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+  /* the essence doesn't fit into a block and is pulled along with the next
+   * key and length, which must not be kept in the same memory */
+  g_object_set (mxfdemux, "read-ahead", (guint) sizeof (mxf_essence), NULL);
+
+  run_pull (mxfdemux, NULL);
+  fail_unless (have_writable_data);
+
+  gst_object_unref (mxfdemux);
+}
+
 GST_END_TEST;
 
 GST_START_TEST (test_push)
@@ -287,6 +377,236 @@ GST_START_TEST (test_push)
 
 GST_END_TEST;
 
+/* Prefix of the keys of generic container picture essence elements */
+static const guint8 picture_element_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
+  0x0d, 0x01, 0x03, 0x01, 0x15
+};
+
+static const guint8 body_partition_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x03
+};
+
+/* Returns the size of the key and length of the KLV packet at @offset */
+static guint
+read_klv_header (const guint8 * data, gsize size, gsize offset,
+    guint64 * length)
+{
+  guint slen, i;
+
+  fail_unless (offset + 17 <= size);
+  if (!(data[offset + 16] & 0x80)) {
+    *length = data[offset + 16];
+    return 17;
+  }
+
+  slen = data[offset + 16] & 0x7f;
+  fail_unless (slen <= 8 && offset + 17 + slen <= size);
+  *length = 0;
+  for (i = 0; i < slen; i++)
+    *length = (*length << 8) | data[offset + 17 + i];
+
+  return 17 + slen;
+}
+
+/* Returns the offsets of the picture essence elements of the file in
+ * stream order, and the number of its body partitions */
+static GArray *
+get_picture_offsets (const gchar * location, guint * n_body_partitions)
+{
+  GArray *offsets;
+  guint8 *data;
+  gsize size, offset = 0;
+  guint64 length;
+
+  fail_unless (g_file_get_contents (location, (gchar **) & data, &size,
+          NULL));
+  offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  *n_body_partitions = 0;
+
+  while (offset < size) {
+    const guint8 *key = data + offset;
+    guint header_size = read_klv_header (data, size, offset, &length);
+
+    if (memcmp (key, picture_element_key, sizeof (picture_element_key)) == 0) {
+      guint64 picture_offset = offset;
+
+      g_array_append_val (offsets, picture_offset);
+    } else if (memcmp (key, body_partition_pack_key,
+            sizeof (body_partition_pack_key)) == 0) {
+      (*n_body_partitions)++;
+    }
+
+    offset += header_size + length;
+  }
+  fail_unless_equals_uint64 (offset, size);
+  g_free (data);
+
+  return offsets;
+}
+
+static GArray *picture_offsets;
+static gboolean seeking;
+/* the first picture pulled after the seek, and the first one pushed */
+static gint first_pulled_picture;
+static GstClockTime first_pts;
+static guint n_buffers;
+
+static GstPadProbeReturn
+on_pull (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint i;
+
+  if (!seeking || first_pulled_picture != -1)
+    return GST_PAD_PROBE_OK;
+
+  for (i = 0; i < picture_offsets->len; i++) {
+    if (g_array_index (picture_offsets, guint64, i) == info->offset) {
+      first_pulled_picture = i;
+      break;
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  if (n_buffers == 0) {
+    first_pts = GST_BUFFER_PTS (buffer);
+    fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+  }
+  n_buffers++;
+}
+
+static void
+on_pad_added (GstElement * demux, GstPad * pad, GstBin * pipeline)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff), NULL);
+  gst_bin_add (pipeline, sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+static void
+run_pipeline (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+}
+
+GST_START_TEST (test_pull_seek_key_unit_partitions)
+{
+  GstElementFactory *factory;
+  GstElement *pipeline, *element;
+  GstPad *pad;
+  gchar *desc, *location;
+  guint n_body_partitions;
+  gint fd;
+
+  if ((factory = gst_element_factory_find ("x264enc")) == NULL)
+    return;
+  gst_object_unref (factory);
+  if ((factory = gst_element_factory_find ("h264parse")) == NULL)
+    return;
+  gst_object_unref (factory);
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+
+  /* A keyframe every 10 frames and a new body partition with its index
+   * table segments at the first keyframe after each second */
+  desc = g_strdup_printf ("videotestsrc num-buffers=250 ! "
+      "video/x-raw,framerate=25/1 ! "
+      "x264enc key-int-max=10 bframes=0 option-string=scenecut=0 ! "
+      "h264parse ! mxfmux partition-interval=1000000000 ! "
+      "filesink location=\"%s\"", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  picture_offsets = get_picture_offsets (location, &n_body_partitions);
+  fail_unless_equals_int (picture_offsets->len, 250);
+  fail_unless (n_body_partitions > 2);
+
+  desc = g_strdup_printf ("filesrc location=\"%s\" name=src ! "
+      "mxfdemux read-ahead=0 name=demux", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  element = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_signal_connect (element, "pad-added", G_CALLBACK (on_pad_added),
+      pipeline);
+  gst_object_unref (element);
+  element = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pad = gst_element_get_static_pad (element, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_BUFFER,
+      on_pull, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (element);
+
+  seeking = FALSE;
+  first_pulled_picture = -1;
+  first_pts = GST_CLOCK_TIME_NONE;
+  n_buffers = 0;
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* Frame 167 is in the partition starting with frame 150, the keyframe
+   * before it is frame 160 */
+  seeking = TRUE;
+  fail_unless (gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT |
+          GST_SEEK_FLAG_SNAP_BEFORE, GST_SEEK_TYPE_SET,
+          6 * GST_SECOND + 700 * GST_MSECOND, GST_SEEK_TYPE_NONE, -1));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  /* reading started at the essence element of the keyframe, which was
+   * pushed first */
+  fail_unless_equals_int (first_pulled_picture, 160);
+  fail_unless_equals_uint64 (first_pts, 6 * GST_SECOND + 400 * GST_MSECOND);
+  fail_unless_equals_int (n_buffers, 250 - 160);
+
+  g_array_free (picture_offsets, TRUE);
+  picture_offsets = NULL;
+  g_remove (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfdemux_suite (void)
 {
@@ -301,7 +621,10 @@ mxfdemux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
+  tcase_add_test (tc_chain, test_pull_read_ahead);
+  tcase_add_test (tc_chain, test_pull_read_ahead_large_value);
   tcase_add_test (tc_chain, test_push);
+  tcase_add_test (tc_chain, test_pull_seek_key_unit_partitions);
 
   return s;
 }
@@ -21,6 +21,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 static const gchar *
@@ -265,6 +266,258 @@ GST_START_TEST (test_h264_raw_audio)
 
 GST_END_TEST;
 
+/* Prefix of the keys of partition packs, followed by the kind of partition
+ * and its status */
+static const guint8 partition_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01
+};
+
+static const guint8 index_table_segment_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+};
+
+static const guint8 random_index_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x11, 0x01, 0x00
+};
+
+/* Returns the size of the key and length of the KLV packet at @offset */
+static guint
+read_klv_header (const guint8 * data, gsize size, gsize offset,
+    guint64 * length)
+{
+  guint slen, i;
+
+  fail_unless (offset + 17 <= size);
+  if (!(data[offset + 16] & 0x80)) {
+    *length = data[offset + 16];
+    return 17;
+  }
+
+  slen = data[offset + 16] & 0x7f;
+  fail_unless (slen <= 8 && offset + 17 + slen <= size);
+  *length = 0;
+  for (i = 0; i < slen; i++)
+    *length = (*length << 8) | data[offset + 17 + i];
+
+  return 17 + slen;
+}
+
+/* Checks the layout of a file with one body partition per second of essence,
+ * each but the first one starting with the index table segments of the
+ * previous one, and returns the number of partitions */
+static guint
+check_partitions (const gchar * location)
+{
+  GArray *partitions;
+  guint8 *data;
+  gsize size, offset = 0;
+  guint64 length = 0, prev_partition = 0;
+  guint header_size = 0, n_partitions, n_entries, i;
+
+  fail_unless (g_file_get_contents (location, (gchar **) & data, &size,
+          NULL));
+  partitions = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+  while (offset < size) {
+    const guint8 *key = data + offset;
+
+    header_size = read_klv_header (data, size, offset, &length);
+    fail_unless (offset + header_size + length <= size);
+
+    if (memcmp (key, partition_pack_key, sizeof (partition_pack_key)) == 0) {
+      const guint8 *pack = key + header_size;
+      guint64 index_byte_count = GST_READ_UINT64_BE (pack + 40);
+      gsize index_offset = offset + header_size + length +
+          GST_READ_UINT64_BE (pack + 32);
+
+      fail_unless (length >= 64);
+      /* header, body and footer partitions in that order */
+      if (partitions->len == 0)
+        fail_unless_equals_int (key[13], 0x02);
+      else if (key[13] != 0x04)
+        fail_unless_equals_int (key[13], 0x03);
+
+      fail_unless_equals_uint64 (GST_READ_UINT64_BE (pack + 8), offset);
+      fail_unless_equals_uint64 (GST_READ_UINT64_BE (pack + 16),
+          prev_partition);
+      prev_partition = offset;
+      g_array_append_val (partitions, prev_partition);
+
+      /* the first body partition only contains essence */
+      if (key[13] == 0x03 && partitions->len > 2) {
+        fail_unless (index_byte_count > 0);
+        fail_unless (GST_READ_UINT32_BE (pack + 48) != 0);
+      }
+
+      /* the index table segments follow right after the pack and the header
+       * metadata, if any */
+      while (index_byte_count > 0) {
+        fail_unless (memcmp (data + index_offset, index_table_segment_key,
+                sizeof (index_table_segment_key)) == 0);
+        header_size = read_klv_header (data, size, index_offset, &length);
+        fail_unless (header_size + length <= index_byte_count);
+        index_byte_count -= header_size + length;
+        index_offset += header_size + length;
+      }
+      header_size = read_klv_header (data, size, offset, &length);
+    } else if (memcmp (key, random_index_pack_key,
+            sizeof (random_index_pack_key)) == 0) {
+      break;
+    }
+
+    offset += header_size + length;
+  }
+
+  /* the random index pack is last and lists all partitions */
+  fail_unless (offset < size);
+  fail_unless_equals_uint64 (offset + header_size + length, size);
+  fail_unless_equals_uint64 (GST_READ_UINT32_BE (data + size - 4),
+      size - offset);
+  n_entries = (length - 4) / 12;
+  n_partitions = partitions->len;
+  fail_unless_equals_int (n_entries, n_partitions);
+  for (i = 0; i < n_entries; i++) {
+    const guint8 *entry = data + offset + header_size + i * 12;
+    guint32 body_sid = GST_READ_UINT32_BE (entry);
+
+    fail_unless_equals_uint64 (GST_READ_UINT64_BE (entry + 4),
+        g_array_index (partitions, guint64, i));
+    /* only body partitions contain essence */
+    if (i == 0 || i == n_entries - 1)
+      fail_unless_equals_int (body_sid, 0);
+    else
+      fail_unless (body_sid != 0);
+  }
+
+  g_array_free (partitions, TRUE);
+  g_free (data);
+
+  return n_partitions;
+}
+
+typedef struct
+{
+  guint n_video_buffers;
+  GstClockTime first_video_pts;
+} DemuxData;
+
+static void
+on_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    DemuxData * d)
+{
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+
+  if (gst_structure_has_name (s, "video/x-raw")) {
+    if (d->n_video_buffers == 0)
+      d->first_video_pts = GST_BUFFER_PTS (buffer);
+    d->n_video_buffers++;
+  }
+  gst_caps_unref (caps);
+}
+
+static void
+on_pad_added (GstElement * demux, GstPad * pad, GstBin * pipeline)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (on_handoff),
+      g_object_get_data (G_OBJECT (pipeline), "demux-data"));
+  gst_bin_add (pipeline, sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+/* Demuxes the file from @position on, which needs its index */
+static void
+demux_from (const gchar * location, GstClockTime position, DemuxData * d)
+{
+  GstElement *pipeline, *demux;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! mxfdemux name=demux",
+      location);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  d->n_video_buffers = 0;
+  d->first_video_pts = GST_CLOCK_TIME_NONE;
+  g_object_set_data (G_OBJECT (pipeline), "demux-data", d);
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (on_pad_added), pipeline);
+  gst_object_unref (demux);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, position));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_raw_video_raw_audio_partitions)
+{
+  DemuxData d;
+  gchar *pipeline, *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxfmux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+
+  /* A new body partition with index table segments every second */
+  pipeline = g_strdup_printf ("videotestsrc num-buffers=250 ! "
+      "video/x-raw,format=(string)v308,width=320,height=240,framerate=25/1 ! "
+      "mxfmux name=mux partition-interval=1000000000 ! "
+      "filesink location=\"%s\"  "
+      "audiotestsrc num-buffers=250 ! "
+      "audioconvert ! " "audio/x-raw,rate=48000,channels=2 ! " "mux. ",
+      location);
+
+  run_test (pipeline);
+  g_free (pipeline);
+
+  /* header, one body partition for each of the 10 seconds, footer */
+  fail_unless_equals_int (check_partitions (location), 12);
+
+  /* every frame is a keyframe, so the seek ends up exactly on a frame of
+   * the seventh body partition */
+  demux_from (location, 6 * GST_SECOND, &d);
+  fail_unless_equals_uint64 (d.first_video_pts, 6 * GST_SECOND);
+  fail_unless_equals_int (d.n_video_buffers, 250 - 6 * 25);
+
+  g_remove (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfmux_suite (void)
 {
@@ -276,6 +529,7 @@ mxfmux_suite (void)
 
   tcase_add_test (tc_chain, test_mpeg2);
   tcase_add_test (tc_chain, test_raw_video_raw_audio);
+  tcase_add_test (tc_chain, test_raw_video_raw_audio_partitions);
   tcase_add_test (tc_chain, test_raw_video_stride_transform);
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
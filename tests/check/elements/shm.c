@@ -26,6 +26,14 @@
 
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../../../sys/shm/shmpipe.h"
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -169,6 +177,132 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+#if defined (__linux__) && defined (SYS_memfd_create)
+GST_START_TEST (test_shm_fd_passing)
+{
+  GstAllocator *alloc;
+  GstBuffer *buf;
+  GstMemory *mem;
+  GstMapInfo map;
+  GstSegment segment;
+  int fd;
+
+  g_object_set (sink, "fd-passing", TRUE, NULL);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  fd = syscall (SYS_memfd_create, "shm-unit-test", 0);
+  fail_unless (fd >= 0);
+  fail_unless (ftruncate (fd, 4096) == 0);
+
+  alloc = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (alloc, fd, 4096, GST_FD_MEMORY_FLAG_NONE);
+  gst_object_unref (alloc);
+  gst_memory_resize (mem, 100, 1000);
+  fail_unless (gst_memory_map (mem, &map, GST_MAP_WRITE));
+  memset (map.data, 0xab, map.size);
+  gst_memory_unmap (mem, &map);
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  fail_unless (g_list_length (buffers) == 1);
+
+  /* the buffer was received as the memfd itself, not as a copy */
+  buf = buffers->data;
+  fail_unless (gst_buffer_get_size (buf) == 1000);
+  fail_unless (gst_is_fd_memory (gst_buffer_peek_memory (buf, 0)));
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless (map.data[0] == 0xab && map.data[999] == 0xab);
+  gst_buffer_unmap (buf, &map);
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+#endif
+
+#define check_alloc_stats(pipe,used,used_blocks,free_blocks,largest_free) \
+  G_STMT_START {                                                          \
+    ShmAllocStats stats;                                                  \
+    sp_writer_get_alloc_stats (pipe, &stats);                             \
+    fail_unless_equals_int (stats.size, 4096);                            \
+    fail_unless_equals_int (stats.used_size, used);                       \
+    fail_unless_equals_int (stats.n_used_blocks, used_blocks);            \
+    fail_unless_equals_int (stats.n_free_blocks, free_blocks);            \
+    fail_unless_equals_int (stats.largest_free_size, largest_free);       \
+  } G_STMT_END
+
+GST_START_TEST (test_shm_allocator)
+{
+  gchar *socket_path;
+  ShmPipe *pipe;
+  ShmBlock *a, *b, *c;
+  ShmAllocStats stats;
+
+  socket_path = g_build_filename (g_get_tmp_dir (), "shm-alloc-unit-test",
+      NULL);
+  pipe = sp_writer_create (socket_path, 4096, 0600);
+  g_free (socket_path);
+  fail_unless (pipe != NULL);
+  check_alloc_stats (pipe, 0, 0, 1, 4096);
+
+  a = sp_writer_alloc_block (pipe, 1000);
+  b = sp_writer_alloc_block (pipe, 1000);
+  c = sp_writer_alloc_block (pipe, 1000);
+  fail_unless (a != NULL && b != NULL && c != NULL);
+  fail_unless (sp_writer_block_get_buf (b) == sp_writer_block_get_buf (a) +
+      1000);
+  fail_unless (sp_writer_block_get_buf (c) == sp_writer_block_get_buf (a) +
+      2000);
+  check_alloc_stats (pipe, 3000, 3, 1, 1096);
+
+  /* 2096 bytes are free, but not in one piece */
+  sp_writer_free_block (b);
+  check_alloc_stats (pipe, 2000, 2, 2, 1096);
+  fail_unless (sp_writer_alloc_block (pipe, 2000) == NULL);
+
+  /* a block of the same size class is reused rather than splitting the
+   * bigger one at the end */
+  b = sp_writer_alloc_block (pipe, 900);
+  fail_unless (b != NULL);
+  fail_unless (sp_writer_block_get_buf (b) == sp_writer_block_get_buf (a) +
+      1000);
+  check_alloc_stats (pipe, 2900, 3, 2, 1096);
+
+  /* freed blocks are merged with their free neighbours, so the whole space
+   * is available again */
+  sp_writer_free_block (b);
+  check_alloc_stats (pipe, 2000, 2, 2, 1096);
+  sp_writer_free_block (a);
+  check_alloc_stats (pipe, 1000, 1, 2, 2000);
+  sp_writer_free_block (c);
+  check_alloc_stats (pipe, 0, 0, 1, 4096);
+
+  a = sp_writer_alloc_block (pipe, 4096);
+  fail_unless (a != NULL);
+  check_alloc_stats (pipe, 4096, 1, 0, 0);
+  fail_unless (sp_writer_alloc_block (pipe, 1) == NULL);
+  sp_writer_free_block (a);
+
+  sp_writer_get_alloc_stats (pipe, &stats);
+  fail_unless_equals_int (stats.n_allocs, 5);
+  fail_unless_equals_int (stats.n_failures, 2);
+
+  sp_writer_close (pipe, NULL, NULL);
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -179,6 +313,13 @@ shm_suite (void)
   tcase_add_checked_fixture (tc, setup_shm, NULL);
   tcase_add_test (tc, test_shm_sysmem_alloc);
   tcase_add_test (tc, test_shm_alloc);
+#if defined (__linux__) && defined (SYS_memfd_create)
+  tcase_add_test (tc, test_shm_fd_passing);
+#endif
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("shmpipe");
+  tcase_add_test (tc, test_shm_allocator);
   suite_add_tcase (s, tc);
 
   return s;
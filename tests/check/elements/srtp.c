@@ -31,6 +31,8 @@
 
 #include <gst/check/gstharness.h>
 
+#include <string.h>
+
 GST_START_TEST (test_create_and_unref)
 {
   GstElement *e;
@@ -207,6 +209,155 @@ GST_START_TEST (test_roc)
 
 GST_END_TEST;
 
+/* The 80 bit HMAC-SHA1 tag of the default policy, AES-128-ICM doesn't
+ * change the size of the payload */
+#define RTP_TRAILER_SIZE 10
+
+/* The payload depends on the SSRC and sequence number of the packet */
+static void
+fill_payload (guint8 * payload, guint32 ssrc, guint16 seqnum)
+{
+  guint i;
+
+  for (i = 0; i < 20; i++)
+    payload[i] = ssrc * 32 + seqnum + i;
+}
+
+static GstBuffer *
+create_rtp_buffer (guint32 ssrc, guint16 seqnum, gsize tail_room)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  buf = gst_buffer_new_allocate (NULL, 12 + 20 + tail_room, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0, map.size);
+  map.data[0] = 0x80;
+  map.data[1] = 8;
+  GST_WRITE_UINT16_BE (map.data + 2, seqnum);
+  GST_WRITE_UINT32_BE (map.data + 8, ssrc);
+  fill_payload (map.data + 12, ssrc, seqnum);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_set_size (buf, 12 + 20);
+
+  return buf;
+}
+
+GST_START_TEST (test_protect_list)
+{
+  GstHarness *h;
+  GstBufferList *list;
+  GstBuffer *key, *in_place, *buf;
+  GstStructure *stats;
+  const GValue *streams;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  key = gst_buffer_new_allocate (NULL, 30, NULL);
+  gst_buffer_memset (key, 0, 0x42, 30);
+  g_object_set (h->element, "key", key, NULL);
+  gst_buffer_unref (key);
+  gst_harness_set_src_caps_str (h, "application/x-rtp");
+
+  /* Two SSRCs, the first packet has just enough room for the trailer and
+   * the third one a byte too little */
+  list = gst_buffer_list_new ();
+  in_place = create_rtp_buffer (1, 0, RTP_TRAILER_SIZE);
+  gst_buffer_list_add (list, in_place);
+  gst_buffer_list_add (list, create_rtp_buffer (2, 0, 0));
+  gst_buffer_list_add (list, create_rtp_buffer (1, 1, RTP_TRAILER_SIZE - 1));
+  gst_buffer_list_add (list, create_rtp_buffer (2, 1, 0));
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  fail_unless_equals_int (gst_harness_buffers_received (h), 4);
+  for (i = 0; i < 4; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless_equals_int (gst_buffer_get_size (buf),
+        12 + 20 + RTP_TRAILER_SIZE);
+    if (i == 0)
+      fail_unless (buf == in_place);
+    gst_buffer_unref (buf);
+  }
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  streams = gst_structure_get_value (stats, "streams");
+  fail_unless_equals_int (gst_value_array_get_size (streams), 2);
+  gst_structure_free (stats);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static GstCaps *
+request_key_any_ssrc (GstElement * srtpdec, guint ssrc, GstBuffer * key)
+{
+  return gst_caps_new_simple ("application/x-srtp",
+      "srtp-key", GST_TYPE_BUFFER, key,
+      "srtp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtp-auth", G_TYPE_STRING, "hmac-sha1-80",
+      "srtcp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtcp-auth", G_TYPE_STRING, "hmac-sha1-80", NULL);
+}
+
+GST_START_TEST (test_protect_list_threads)
+{
+  GstHarness *h, *dec;
+  GstBufferList *list;
+  GstBuffer *key, *buf;
+  GstMapInfo map;
+  guint8 payload[20];
+  guint i;
+
+  h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  key = gst_buffer_new_allocate (NULL, 30, NULL);
+  gst_buffer_memset (key, 0, 0x42, 30);
+  g_object_set (h->element, "key", key, "n-threads", 4, NULL);
+  gst_harness_set_src_caps_str (h, "application/x-rtp");
+
+  dec = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  g_signal_connect (dec->element, "request-key",
+      G_CALLBACK (request_key_any_ssrc), key);
+  gst_harness_set_src_caps_str (dec, "application/x-srtp");
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 64; i++)
+    gst_buffer_list_add (list, create_rtp_buffer (i % 5, i / 5, 0));
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  /* The RTP header is not encrypted, the order must be unchanged */
+  fail_unless_equals_int (gst_harness_buffers_received (h), 64);
+  for (i = 0; i < 64; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless_equals_int (gst_buffer_get_size (buf),
+        12 + 20 + RTP_TRAILER_SIZE);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data + 2), i / 5);
+    fail_unless_equals_int (GST_READ_UINT32_BE (map.data + 8), i % 5);
+    fill_payload (payload, i % 5, i / 5);
+    fail_if (memcmp (map.data + 12, payload, 20) == 0);
+    gst_buffer_unmap (buf, &map);
+
+    /* Each SSRC was protected with its own session and decrypts to the
+     * original payload */
+    fail_unless_equals_int (gst_harness_push (dec, buf), GST_FLOW_OK);
+    buf = gst_harness_pull (dec);
+    fail_unless (buf != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (buf), 12 + 20);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (GST_READ_UINT32_BE (map.data + 8), i % 5);
+    fail_unless (memcmp (map.data + 12, payload, 20) == 0);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (dec);
+  gst_harness_teardown (h);
+  gst_buffer_unref (key);
+}
+
+GST_END_TEST;
+
 static Suite *
 srtp_suite (void)
 {
@@ -218,6 +369,8 @@ srtp_suite (void)
   tcase_add_test (tc_chain, test_create_and_unref);
   tcase_add_test (tc_chain, test_play);
   tcase_add_test (tc_chain, test_roc);
+  tcase_add_test (tc_chain, test_protect_list);
+  tcase_add_test (tc_chain, test_protect_list_threads);
 
   return s;
 }
@@ -0,0 +1,439 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#define TS_PACKET_SIZE 188
+#define PMT_PID 0x100
+#define ES_PID 0x101
+#define PMT_PID_2 0x200
+#define ES_PID_2 0x201
+
+/* PES payload bytes: 162 after the PES header in the first TS packet,
+ * which also carries a PCR, and 184 in each of the following ones */
+#define PES_PAYLOAD_SIZE(n_packets) (162 + ((n_packets) - 1) * 184)
+#define N_PES 3
+/* More TS packets than a buffer can hold memory blocks */
+#define LARGE_PES_PACKETS 64
+/* Detecting the packet size needs more than the first input buffer, so the
+ * first two are merged */
+#define MERGED_INPUT_SIZE (8 * TS_PACKET_SIZE)
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream=(boolean)true"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad, *mysinkpad;
+static GByteArray *received;
+static gboolean have_eos;
+
+static guint32
+mpeg_crc32 (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static void
+put_section (GByteArray * ts, guint16 pid, guint8 * section, guint len)
+{
+  guint8 packet[TS_PACKET_SIZE];
+
+  GST_WRITE_UINT32_BE (section + len - 4, mpeg_crc32 (section, len - 4));
+
+  memset (packet, 0xff, sizeof (packet));
+  packet[0] = 0x47;
+  packet[1] = 0x40 | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x10;
+  packet[4] = 0;                /* pointer field */
+  memcpy (packet + 5, section, len);
+
+  g_byte_array_append (ts, packet, sizeof (packet));
+}
+
+/* Writes PES packet @n over @n_packets TS packets on @pid. Unbounded PES
+ * packets have a length of 0 and end with the next one */
+static void
+put_pes (GByteArray * ts, guint16 pid, guint n, guint n_packets,
+    gboolean bounded, guint8 * cc)
+{
+  guint8 packet[TS_PACKET_SIZE];
+  guint64 pts = 90000 + n * 3000;
+  guint64 pcr = pts - 9000;
+  guint8 *p;
+  guint i, offset = 0;
+
+  /* First TS packet: PCR adaptation field and PES header */
+  packet[0] = 0x47;
+  packet[1] = 0x40 | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x30 | ((*cc)++ & 0xf);
+  packet[4] = 7;
+  packet[5] = 0x10;
+  packet[6] = pcr >> 25;
+  packet[7] = pcr >> 17;
+  packet[8] = pcr >> 9;
+  packet[9] = pcr >> 1;
+  packet[10] = ((pcr & 1) << 7) | 0x7e;
+  packet[11] = 0;
+
+  p = packet + 12;
+  p[0] = 0x00;
+  p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = 0xc0;
+  GST_WRITE_UINT16_BE (p + 4, bounded ? 8 + PES_PAYLOAD_SIZE (n_packets) : 0);
+  p[6] = 0x80;
+  p[7] = 0x80;
+  p[8] = 5;
+  p[9] = 0x21 | ((pts >> 29) & 0x0e);
+  p[10] = pts >> 22;
+  p[11] = ((pts >> 14) & 0xfe) | 1;
+  p[12] = pts >> 7;
+  p[13] = ((pts << 1) & 0xfe) | 1;
+  p += 14;
+
+  while (p < packet + TS_PACKET_SIZE)
+    *p++ = (n * 7 + offset++) & 0xff;
+  g_byte_array_append (ts, packet, sizeof (packet));
+
+  for (i = 1; i < n_packets; i++) {
+    packet[0] = 0x47;
+    packet[1] = pid >> 8;
+    packet[2] = pid & 0xff;
+    packet[3] = 0x10 | ((*cc)++ & 0xf);
+    for (p = packet + 4; p < packet + TS_PACKET_SIZE; p++)
+      *p = (n * 7 + offset++) & 0xff;
+    g_byte_array_append (ts, packet, sizeof (packet));
+  }
+
+  fail_unless_equals_int (offset, PES_PAYLOAD_SIZE (n_packets));
+}
+
+/* A single program with one MPEG audio stream */
+static GByteArray *
+create_ts (guint n_packets, gboolean bounded)
+{
+  GByteArray *ts = g_byte_array_new ();
+  guint8 pat[] = {
+    0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff,
+    0, 0, 0, 0
+  };
+  guint8 pmt[] = {
+    0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+    0x03, 0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+    0, 0, 0, 0
+  };
+  guint8 cc = 0;
+  guint i;
+
+  put_section (ts, 0, pat, sizeof (pat));
+  put_section (ts, PMT_PID, pmt, sizeof (pmt));
+  for (i = 0; i < N_PES; i++)
+    put_pes (ts, ES_PID, i, n_packets, bounded, &cc);
+
+  return ts;
+}
+
+/* Two programs with one MPEG audio stream each, whose PES packets are
+ * interleaved. Program 2 carries PES packets N_PES to 2 * N_PES - 1 */
+static GByteArray *
+create_two_program_ts (guint n_packets)
+{
+  GByteArray *ts = g_byte_array_new ();
+  guint8 pat[] = {
+    0x00, 0xb0, 17, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff,
+    0x00, 0x02, 0xe0 | (PMT_PID_2 >> 8), PMT_PID_2 & 0xff,
+    0, 0, 0, 0
+  };
+  guint8 pmt[] = {
+    0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+    0x03, 0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+    0, 0, 0, 0
+  };
+  guint8 pmt_2[] = {
+    0x02, 0xb0, 18, 0x00, 0x02, 0xc1, 0x00, 0x00,
+    0xe0 | (ES_PID_2 >> 8), ES_PID_2 & 0xff, 0xf0, 0x00,
+    0x03, 0xe0 | (ES_PID_2 >> 8), ES_PID_2 & 0xff, 0xf0, 0x00,
+    0, 0, 0, 0
+  };
+  guint8 cc = 0, cc_2 = 0;
+  guint i;
+
+  put_section (ts, 0, pat, sizeof (pat));
+  put_section (ts, PMT_PID, pmt, sizeof (pmt));
+  put_section (ts, PMT_PID_2, pmt_2, sizeof (pmt_2));
+  for (i = 0; i < N_PES; i++) {
+    put_pes (ts, ES_PID, i, n_packets, TRUE, &cc);
+    put_pes (ts, ES_PID_2, N_PES + i, n_packets, TRUE, &cc_2);
+  }
+
+  return ts;
+}
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_byte_array_append (received, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    have_eos = TRUE;
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+static GstElement *
+setup_demux (void)
+{
+  GstElement *demux;
+  GstCaps *caps;
+
+  received = g_byte_array_new ();
+  have_eos = FALSE;
+
+  demux = gst_check_setup_element ("tsdemux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added), NULL);
+
+  mysrcpad = gst_check_setup_src_pad (demux, &srctemplate);
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, sink_chain);
+  gst_pad_set_event_function (mysinkpad, sink_event);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (demux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_static_pad_template_get_caps (&srctemplate);
+  gst_check_setup_events (mysrcpad, demux, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  return demux;
+}
+
+/* Pushes the stream in chunks of 4 TS packets, so that PES packets are
+ * spread over several input buffers */
+static void
+push_ts (GByteArray * ts)
+{
+  guint offset;
+
+  for (offset = 0; offset < ts->len; offset += 4 * TS_PACKET_SIZE) {
+    guint size = MIN (4 * TS_PACKET_SIZE, ts->len - offset);
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+    gst_buffer_fill (buf, 0, ts->data + offset, size);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  fail_unless (have_eos);
+}
+
+static GByteArray *
+teardown_demux (GstElement * demux)
+{
+  fail_unless (gst_element_set_state (demux,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+
+  return received;
+}
+
+static GByteArray *
+demux_ts (GByteArray * ts, gboolean zero_copy, guint64 * bytes_copied)
+{
+  GstElement *demux = setup_demux ();
+
+  g_object_set (demux, "zero-copy-pes", zero_copy, NULL);
+  push_ts (ts);
+  g_object_get (demux, "bytes-copied", bytes_copied, NULL);
+
+  return teardown_demux (demux);
+}
+
+/* The payloads of PES packets @first to @first + N_PES - 1 */
+static GByteArray *
+create_expected (guint first, guint n_packets)
+{
+  GByteArray *expected = g_byte_array_new ();
+  guint i, j;
+
+  for (i = first; i < first + N_PES; i++) {
+    for (j = 0; j < PES_PAYLOAD_SIZE (n_packets); j++) {
+      guint8 b = (i * 7 + j) & 0xff;
+      g_byte_array_append (expected, &b, 1);
+    }
+  }
+
+  return expected;
+}
+
+static void
+check_output (GByteArray * output, GByteArray * expected)
+{
+  fail_unless_equals_int (output->len, expected->len);
+  fail_unless (memcmp (output->data, expected->data, expected->len) == 0);
+  g_byte_array_unref (output);
+}
+
+GST_START_TEST (test_zero_copy_pes)
+{
+  GByteArray *ts, *expected;
+  guint64 bytes_copied, zero_copy_bytes_copied;
+
+  ts = create_ts (6, TRUE);
+  expected = create_expected (0, 6);
+
+  /* Both modes output the exact PES payloads */
+  check_output (demux_ts (ts, FALSE, &bytes_copied), expected);
+  check_output (demux_ts (ts, TRUE, &zero_copy_bytes_copied), expected);
+
+  GST_DEBUG ("copied %" G_GUINT64_FORMAT " bytes, %" G_GUINT64_FORMAT
+      " in zero-copy mode", bytes_copied, zero_copy_bytes_copied);
+  fail_unless (bytes_copied >= expected->len + MERGED_INPUT_SIZE);
+  fail_unless_equals_uint64 (zero_copy_bytes_copied, MERGED_INPUT_SIZE);
+
+  g_byte_array_unref (ts);
+  g_byte_array_unref (expected);
+}
+
+GST_END_TEST;
+
+/* PES packets that don't fit into a buffer are copied like in the default
+ * mode, without collecting sub-buffers first */
+GST_START_TEST (test_zero_copy_large_pes)
+{
+  GByteArray *ts, *expected;
+  guint64 bytes_copied, zero_copy_bytes_copied;
+
+  expected = create_expected (0, LARGE_PES_PACKETS);
+
+  /* with a known size, the payload is copied once in both modes */
+  ts = create_ts (LARGE_PES_PACKETS, TRUE);
+  check_output (demux_ts (ts, FALSE, &bytes_copied), expected);
+  check_output (demux_ts (ts, TRUE, &zero_copy_bytes_copied), expected);
+  fail_unless_equals_uint64 (bytes_copied, expected->len + MERGED_INPUT_SIZE);
+  fail_unless_equals_uint64 (zero_copy_bytes_copied,
+      expected->len + MERGED_INPUT_SIZE);
+  g_byte_array_unref (ts);
+
+  /* without, the zero-copy mode switches to copying after 16 TS packets
+   * and then grows the same block as the default mode */
+  ts = create_ts (LARGE_PES_PACKETS, FALSE);
+  check_output (demux_ts (ts, FALSE, &bytes_copied), expected);
+  check_output (demux_ts (ts, TRUE, &zero_copy_bytes_copied), expected);
+  fail_unless (bytes_copied > expected->len + MERGED_INPUT_SIZE);
+  fail_unless_equals_uint64 (zero_copy_bytes_copied, bytes_copied);
+  g_byte_array_unref (ts);
+
+  g_byte_array_unref (expected);
+}
+
+GST_END_TEST;
+
+/* Packets of the program that is not demuxed are dropped before parsing */
+GST_START_TEST (test_program_pid_filter)
+{
+  GByteArray *ts, *expected;
+  GstElement *demux;
+  guint64 skipped_packets;
+
+  ts = create_two_program_ts (6);
+  expected = create_expected (N_PES, 6);
+
+  demux = setup_demux ();
+  g_object_set (demux, "program-number", 2, NULL);
+  push_ts (ts);
+
+  /* all the PES packets of program 1 were skipped */
+  g_object_get (demux, "skipped-packets", &skipped_packets, NULL);
+  fail_unless_equals_uint64 (skipped_packets, N_PES * 6);
+
+  /* and the counter starts over after a flush */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_flush_stop (TRUE)));
+  g_object_get (demux, "skipped-packets", &skipped_packets, NULL);
+  fail_unless_equals_uint64 (skipped_packets, 0);
+
+  check_output (teardown_demux (demux), expected);
+
+  g_byte_array_unref (ts);
+  g_byte_array_unref (expected);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_zero_copy_pes);
+  tcase_add_test (tc_chain, test_zero_copy_large_pes);
+  tcase_add_test (tc_chain, test_program_pid_filter);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
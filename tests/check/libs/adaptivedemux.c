@@ -0,0 +1,253 @@
+/* GStreamer
+ *
+ * unit test for the GstAdaptiveDemux bandwidth estimators
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemux.h>
+
+/* large enough to be used by all estimators */
+#define SAMPLE_SIZE 100000
+
+/* Demuxer without manifest, only moving from one fragment to the next one
+ * and remembering the bitrate it was asked to select */
+typedef struct
+{
+  GstAdaptiveDemux parent;
+
+  gboolean has_next_fragment;
+  guint64 selected_bitrate;
+} TestDemux;
+
+typedef struct
+{
+  GstAdaptiveDemuxClass parent_class;
+} TestDemuxClass;
+
+GType test_demux_get_type (void);
+G_DEFINE_TYPE (TestDemux, test_demux, GST_TYPE_ADAPTIVE_DEMUX);
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static gboolean
+test_demux_stream_has_next_fragment (GstAdaptiveDemuxStream * stream)
+{
+  return ((TestDemux *) stream->demux)->has_next_fragment;
+}
+
+static GstFlowReturn
+test_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
+{
+  return GST_FLOW_OK;
+}
+
+static gboolean
+test_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
+    guint64 bitrate)
+{
+  ((TestDemux *) stream->demux)->selected_bitrate = bitrate;
+
+  return FALSE;
+}
+
+static void
+test_demux_class_init (TestDemuxClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstAdaptiveDemuxClass *demux_class = GST_ADAPTIVE_DEMUX_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &sink_template);
+  gst_element_class_set_static_metadata (element_class,
+      "Test adaptive demuxer", "Codec/Demuxer/Adaptive",
+      "Moves from one fragment to the next one", "GStreamer");
+
+  demux_class->stream_has_next_fragment = test_demux_stream_has_next_fragment;
+  demux_class->stream_advance_fragment = test_demux_stream_advance_fragment;
+  demux_class->stream_select_bitrate = test_demux_stream_select_bitrate;
+}
+
+static void
+test_demux_init (TestDemux * demux)
+{
+  demux->has_next_fragment = TRUE;
+}
+
+static GstAdaptiveDemuxStream *
+setup_stream (GstAdaptiveDemuxBandwidthEstimator estimator, TestDemux ** demux)
+{
+  GstAdaptiveDemuxStream *stream;
+
+  *demux = g_object_new (test_demux_get_type (), "bandwidth-estimator",
+      estimator, "bitrate-limit", 1.0f, NULL);
+
+  stream = gst_adaptive_demux_stream_new (GST_ADAPTIVE_DEMUX (*demux),
+      gst_pad_new ("src_0", GST_PAD_SRC));
+  /* consider it exposed, or the demuxer would switch to it on advancing */
+  GST_ADAPTIVE_DEMUX (*demux)->streams =
+      GST_ADAPTIVE_DEMUX (*demux)->next_streams;
+  GST_ADAPTIVE_DEMUX (*demux)->next_streams = NULL;
+
+  return stream;
+}
+
+static void
+teardown_stream (TestDemux * demux)
+{
+  /* the streams are freed when resetting */
+  fail_unless (gst_element_set_state (GST_ELEMENT (demux),
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (GST_ELEMENT (demux),
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (demux);
+}
+
+/* Finishes a fragment of @size bytes downloaded at @bitrate in @seconds and
+ * returns the bandwidth estimate that is used for selecting the next one */
+static guint64
+finish_fragment (TestDemux * demux, GstAdaptiveDemuxStream * stream,
+    guint64 bitrate, guint64 size, gdouble seconds)
+{
+  demux->selected_bitrate = 0;
+
+  stream->last_bitrate = bitrate;
+  stream->fragment_bytes_downloaded = size;
+  stream->last_download_time = seconds * GST_SECOND;
+
+  fail_unless_equals_int (gst_adaptive_demux_stream_advance_fragment
+      (GST_ADAPTIVE_DEMUX (demux), stream, GST_SECOND), GST_FLOW_OK);
+  fail_unless (demux->selected_bitrate > 0);
+
+  return demux->selected_bitrate;
+}
+
+#define assert_bitrate(bitrate, expected) G_STMT_START { \
+  guint64 _b = (bitrate), _e = (expected); \
+  fail_unless (_b + _e / 1000 >= _e && _b <= _e + _e / 1000, \
+      "bitrate %" G_GUINT64_FORMAT " is not %" G_GUINT64_FORMAT, _b, _e); \
+} G_STMT_END
+
+GST_START_TEST (test_harmonic)
+{
+  GstAdaptiveDemuxStream *stream;
+  TestDemux *demux;
+  guint i;
+
+  stream = setup_stream (GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC,
+      &demux);
+
+  assert_bitrate (finish_fragment (demux, stream, 1000000, SAMPLE_SIZE, 0.8),
+      1000000);
+  /* a fast download only raises the estimate a bit */
+  assert_bitrate (finish_fragment (demux, stream, 4000000, SAMPLE_SIZE, 0.2),
+      1600000);
+  /* small downloads mostly measure the latency and are ignored */
+  assert_bitrate (finish_fragment (demux, stream, 100000, 1000, 0.08),
+      1600000);
+
+  /* older fragments leave the window */
+  for (i = 0; i < 9; i++)
+    finish_fragment (demux, stream, 2000000, SAMPLE_SIZE, 0.4);
+  assert_bitrate (finish_fragment (demux, stream, 2000000, SAMPLE_SIZE, 0.4),
+      2000000);
+
+  teardown_stream (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ewma)
+{
+  GstAdaptiveDemuxStream *stream;
+  TestDemux *demux;
+
+  stream = setup_stream (GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_EWMA, &demux);
+
+  assert_bitrate (finish_fragment (demux, stream, 2000000, SAMPLE_SIZE, 1.0),
+      2000000);
+  /* drops are followed by the fast average */
+  assert_bitrate (finish_fragment (demux, stream, 1000000, SAMPLE_SIZE, 1.0),
+      1414214);
+  /* small downloads and ones without download time are ignored */
+  assert_bitrate (finish_fragment (demux, stream, 100000, 1000, 0.08),
+      1414214);
+  assert_bitrate (finish_fragment (demux, stream, 100000, SAMPLE_SIZE, 0.0),
+      1414214);
+  /* rises are held back by the slow average */
+  assert_bitrate (finish_fragment (demux, stream, 4000000, SAMPLE_SIZE, 1.0),
+      2429708);
+
+  teardown_stream (demux);
+}
+
+GST_END_TEST;
+
+/* The estimate is only updated when moving on to another fragment */
+GST_START_TEST (test_no_update_on_eos)
+{
+  GstAdaptiveDemuxStream *stream;
+  TestDemux *demux;
+
+  stream = setup_stream (GST_ADAPTIVE_DEMUX_BANDWIDTH_ESTIMATOR_HARMONIC,
+      &demux);
+
+  assert_bitrate (finish_fragment (demux, stream, 1000000, SAMPLE_SIZE, 0.8),
+      1000000);
+
+  demux->has_next_fragment = FALSE;
+  demux->selected_bitrate = 0;
+  stream->last_bitrate = 100000;
+  stream->fragment_bytes_downloaded = SAMPLE_SIZE;
+  stream->last_download_time = 8 * GST_SECOND;
+  fail_unless_equals_int (gst_adaptive_demux_stream_advance_fragment
+      (GST_ADAPTIVE_DEMUX (demux), stream, GST_SECOND), GST_FLOW_EOS);
+  fail_unless_equals_int (demux->selected_bitrate, 0);
+  assert_bitrate (stream->current_download_rate, 1000000);
+
+  /* e.g. after seeking back */
+  demux->has_next_fragment = TRUE;
+  stream->last_ret = GST_FLOW_OK;
+  assert_bitrate (finish_fragment (demux, stream, 1000000, SAMPLE_SIZE, 0.8),
+      1000000);
+
+  teardown_stream (demux);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemux_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_harmonic);
+  tcase_add_test (tc_chain, test_ewma);
+  tcase_add_test (tc_chain, test_no_update_on_eos);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemux);
@@ -144,6 +144,17 @@ static guint8 slice_eoseq_slice[] = {
   0x00, 0x00, 0x00, 0x01, 0x0b
 };
 
+static guint8 h264_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x15,
+  0xec, 0xa4, 0xbf, 0x2e, 0x02, 0x20, 0x00, 0x00,
+  0x03, 0x00, 0x2e, 0xe6, 0xb2, 0x80, 0x01, 0xe2,
+  0xc5, 0xb2, 0xc0
+};
+
+static guint8 h264_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2
+};
+
 GST_START_TEST (test_h264_parse_slice_dpa)
 {
   GstH264ParserResult res;
@@ -211,6 +222,151 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+GST_START_TEST (test_h264_parse_slice_hdr_light)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice, light_slice;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+
+  res = gst_h264_parser_identify_nalu_unchecked (parser, h264_sps, 0,
+      sizeof (h264_sps), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (gst_h264_parser_parse_nal (parser, &nalu),
+      GST_H264_PARSER_OK);
+  res = gst_h264_parser_identify_nalu_unchecked (parser, h264_pps, 0,
+      sizeof (h264_pps), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (gst_h264_parser_parse_nal (parser, &nalu),
+      GST_H264_PARSER_OK);
+
+  res = gst_h264_parser_identify_nalu (parser, slice_eoseq_slice, 0,
+      sizeof (slice_eoseq_slice), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SLICE_IDR);
+
+  res = gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice, TRUE, TRUE);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  res = gst_h264_parser_parse_slice_hdr_light (parser, &nalu, &light_slice);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+
+  assert_equals_int (light_slice.first_mb_in_slice, slice.first_mb_in_slice);
+  assert_equals_int (light_slice.type, slice.type);
+  fail_unless (GST_H264_IS_I_SLICE (&light_slice));
+  fail_unless (light_slice.pps == slice.pps);
+  assert_equals_int (light_slice.frame_num, slice.frame_num);
+  assert_equals_int (light_slice.field_pic_flag, slice.field_pic_flag);
+  assert_equals_int (light_slice.bottom_field_flag, slice.bottom_field_flag);
+
+  /* the rest was not parsed */
+  fail_unless (slice.header_size > 0);
+  assert_equals_int (light_slice.header_size, 0);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* Escapes @size RBSP bytes of @rbsp into @nal and returns the NAL size */
+static guint
+h264_escape_rbsp (const guint8 * rbsp, guint size, guint8 * nal)
+{
+  guint i, n = 0, zeros = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros == 2 && rbsp[i] <= 0x03) {
+      nal[n++] = 0x03;
+      zeros = 0;
+    }
+    nal[n++] = rbsp[i];
+    zeros = rbsp[i] == 0x00 ? zeros + 1 : 0;
+  }
+
+  return n;
+}
+
+#define SEI_COUNT 2000
+#define SEI_PAYLOAD_SIZE 1500
+#define SEI_USER_DATA_UNREGISTERED 5
+
+GST_START_TEST (test_h264_parse_sei_emulation_prevention)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  GRand *rand = g_rand_new_with_seed (0x264);
+  guint8 *rbsp, *buf;
+  guint i, rbsp_size, buf_size, offset, n_epb = 0;
+  gint64 start_time;
+
+  /* SEI message with unregistered user data of SEI_PAYLOAD_SIZE bytes,
+   * a quarter of them zero */
+  rbsp = g_malloc (SEI_PAYLOAD_SIZE + 16);
+  buf = g_malloc (SEI_COUNT * (4 + 2 * (SEI_PAYLOAD_SIZE + 16)) + 4);
+
+  buf_size = 0;
+  for (i = 0; i < SEI_COUNT; i++) {
+    guint payload_size = SEI_PAYLOAD_SIZE, nal_size;
+
+    rbsp_size = 0;
+    rbsp[rbsp_size++] = 0x06;
+    rbsp[rbsp_size++] = SEI_USER_DATA_UNREGISTERED;
+    for (; payload_size >= 0xff; payload_size -= 0xff)
+      rbsp[rbsp_size++] = 0xff;
+    rbsp[rbsp_size++] = payload_size;
+    for (payload_size = 0; payload_size < SEI_PAYLOAD_SIZE; payload_size++) {
+      rbsp[rbsp_size++] = g_rand_int_range (rand, 0, 4) == 0 ?
+          0x00 : g_rand_int_range (rand, 0, 0x100);
+    }
+    /* rbsp_trailing_bits */
+    rbsp[rbsp_size++] = 0x80;
+
+    buf[buf_size++] = 0x00;
+    buf[buf_size++] = 0x00;
+    buf[buf_size++] = 0x01;
+    nal_size = h264_escape_rbsp (rbsp, rbsp_size, buf + buf_size);
+    n_epb += nal_size - rbsp_size;
+    buf_size += nal_size;
+  }
+  /* terminate the last NAL */
+  buf[buf_size++] = 0x00;
+  buf[buf_size++] = 0x00;
+  buf[buf_size++] = 0x01;
+  buf[buf_size++] = 0x0b;
+  fail_unless (n_epb > SEI_COUNT);
+
+  start_time = g_get_monotonic_time ();
+  offset = 0;
+  for (i = 0; i < SEI_COUNT; i++) {
+    GArray *messages;
+
+    res = gst_h264_parser_identify_nalu (parser, buf, offset, buf_size, &nalu);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    offset = nalu.offset + nalu.size;
+
+    assert_equals_int (nalu.type, GST_H264_NAL_SEI);
+    res = gst_h264_parser_parse_sei (parser, &nalu, &messages);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    assert_equals_int (messages->len, 1);
+    assert_equals_int (g_array_index (messages, GstH264SEIMessage,
+            0).payloadType, SEI_USER_DATA_UNREGISTERED);
+    g_array_free (messages, TRUE);
+  }
+  /* and nothing was mistaken for a start code */
+  assert_equals_int (offset, buf_size - 4);
+
+  GST_INFO ("parsed %u SEI NALs with %u emulation prevention bytes in %"
+      G_GINT64_FORMAT " us", SEI_COUNT, n_epb,
+      g_get_monotonic_time () - start_time);
+
+  g_free (buf);
+  g_free (rbsp);
+  g_rand_free (rand);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +377,8 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_slice_hdr_light);
+  tcase_add_test (tc_chain, test_h264_parse_sei_emulation_prevention);
 
   return s;
 }
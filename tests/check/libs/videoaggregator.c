@@ -0,0 +1,288 @@
+/* GStreamer
+ *
+ * unit test for GstVideoAggregator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/gstvideoaggregator.h>
+
+#define WIDTH 16
+#define HEIGHT 16
+
+/* Pad remembering the first converted pixel as seen when chaining up to
+ * prepare_frame() returns, and when aggregating */
+typedef struct
+{
+  GstVideoAggregatorConvertPad parent;
+
+  guint8 prepared_pixel[4];
+  guint8 aggregated_pixel[4];
+} TestPad;
+
+typedef struct
+{
+  GstVideoAggregatorConvertPadClass parent_class;
+} TestPadClass;
+
+GType test_pad_get_type (void);
+G_DEFINE_TYPE (TestPad, test_pad, GST_TYPE_VIDEO_AGGREGATOR_CONVERT_PAD);
+
+static gboolean
+test_pad_prepare_frame (GstVideoAggregatorPad * vpad,
+    GstVideoAggregator * vagg, GstBuffer * buffer,
+    GstVideoFrame * prepared_frame)
+{
+  TestPad *pad = (TestPad *) vpad;
+
+  if (!GST_VIDEO_AGGREGATOR_PAD_CLASS (test_pad_parent_class)->prepare_frame
+      (vpad, vagg, buffer, prepared_frame))
+    return FALSE;
+
+  memcpy (pad->prepared_pixel, GST_VIDEO_FRAME_PLANE_DATA (prepared_frame, 0),
+      4);
+
+  return TRUE;
+}
+
+static void
+test_pad_class_init (TestPadClass * klass)
+{
+  GST_VIDEO_AGGREGATOR_PAD_CLASS (klass)->prepare_frame =
+      test_pad_prepare_frame;
+}
+
+static void
+test_pad_init (TestPad * pad)
+{
+}
+
+typedef struct
+{
+  GstVideoAggregator parent;
+} TestVideoAggregator;
+
+typedef struct
+{
+  GstVideoAggregatorClass parent_class;
+} TestVideoAggregatorClass;
+
+GType test_video_aggregator_get_type (void);
+G_DEFINE_TYPE (TestVideoAggregator, test_video_aggregator,
+    GST_TYPE_VIDEO_AGGREGATOR);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("RGBA")));
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ RGBA, I420 }")));
+
+/* Outputs the frame of the first pad */
+static GstFlowReturn
+test_video_aggregator_aggregate_frames (GstVideoAggregator * vagg,
+    GstBuffer * outbuf)
+{
+  GstVideoAggregatorPad *vpad;
+  GstVideoFrame *prepared_frame, out_frame;
+  TestPad *pad;
+
+  GST_OBJECT_LOCK (vagg);
+  vpad = GST_ELEMENT (vagg)->sinkpads->data;
+  GST_OBJECT_UNLOCK (vagg);
+
+  prepared_frame = gst_video_aggregator_pad_get_prepared_frame (vpad);
+  fail_unless (prepared_frame != NULL);
+
+  pad = (TestPad *) vpad;
+  memcpy (pad->aggregated_pixel,
+      GST_VIDEO_FRAME_PLANE_DATA (prepared_frame, 0), 4);
+
+  fail_unless (gst_video_frame_map (&out_frame, &vagg->info, outbuf,
+          GST_MAP_WRITE));
+  fail_unless (gst_video_frame_copy (&out_frame, prepared_frame));
+  gst_video_frame_unmap (&out_frame);
+
+  return GST_FLOW_OK;
+}
+
+static void
+test_video_aggregator_class_init (TestVideoAggregatorClass * klass)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstVideoAggregatorClass *vagg_class = GST_VIDEO_AGGREGATOR_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &sink_template, test_pad_get_type ());
+  gst_element_class_set_static_metadata (element_class,
+      "Test video aggregator", "Filter/Editor/Video/Compositor",
+      "Outputs the frames of its first pad", "GStreamer");
+
+  vagg_class->aggregate_frames = test_video_aggregator_aggregate_frames;
+}
+
+static void
+test_video_aggregator_init (TestVideoAggregator * vagg)
+{
+}
+
+static GstBuffer *
+create_white_frame (guint n)
+{
+  GstVideoInfo info;
+  GstBuffer *buf;
+  gsize uv_offset;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, WIDTH, HEIGHT);
+  uv_offset = GST_VIDEO_INFO_PLANE_OFFSET (&info, 1);
+
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_memset (buf, 0, 235, uv_offset);
+  gst_buffer_memset (buf, uv_offset, 128,
+      GST_VIDEO_INFO_SIZE (&info) - uv_offset);
+
+  GST_BUFFER_PTS (buf) = n * 40 * GST_MSECOND;
+  GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+
+  return buf;
+}
+
+static GstHarness *
+setup_harness (gboolean convert_concurrently, TestPad ** pad)
+{
+  GstVideoAggregatorConvertPadClass *klass;
+  GstElement *vagg;
+  GstHarness *h;
+
+  klass = g_type_class_ref (test_pad_get_type ());
+  klass->convert_concurrently = convert_concurrently;
+  g_type_class_unref (klass);
+
+  vagg = g_object_new (test_video_aggregator_get_type (), NULL);
+  h = gst_harness_new_with_element (vagg, "sink_%u", "src");
+  gst_object_unref (vagg);
+
+  gst_harness_set_src_caps_str (h, "video/x-raw, format=I420, "
+      "width=16, height=16, framerate=25/1");
+  gst_harness_set_sink_caps_str (h, "video/x-raw, format=RGBA, "
+      "width=16, height=16, framerate=25/1");
+
+  *pad = (TestPad *) GST_PAD_PEER (h->srcpad);
+
+  return h;
+}
+
+static void
+check_white_output (GstHarness * h, TestPad * pad, guint n,
+    guint8 expected_alpha)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  fail_unless_equals_int (gst_harness_push (h, create_white_frame (n)),
+      GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless (map.data[0] > 0xf0);
+  fail_unless (map.data[1] > 0xf0);
+  fail_unless (map.data[2] > 0xf0);
+  fail_unless_equals_int (map.data[3], expected_alpha);
+  fail_unless (memcmp (pad->aggregated_pixel, map.data, 4) == 0);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+}
+
+/* Pads overriding prepare_frame() get the converted frame when chaining up
+ * returns, unless they allowed deferring the conversion */
+GST_START_TEST (test_prepare_frame_converted)
+{
+  GstHarness *h;
+  TestPad *pad;
+
+  h = setup_harness (FALSE, &pad);
+  check_white_output (h, pad, 0, 0xff);
+  fail_unless (memcmp (pad->prepared_pixel, pad->aggregated_pixel, 4) == 0);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* With convert_concurrently the conversion happens before aggregating */
+GST_START_TEST (test_convert_concurrently)
+{
+  GstHarness *h;
+  TestPad *pad;
+
+  h = setup_harness (TRUE, &pad);
+  check_white_output (h, pad, 0, 0xff);
+  check_white_output (h, pad, 1, 0xff);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A new converter-config is used from the next frame on */
+GST_START_TEST (test_converter_config_update)
+{
+  GstStructure *config;
+  GstHarness *h;
+  TestPad *pad;
+
+  h = setup_harness (FALSE, &pad);
+  check_white_output (h, pad, 0, 0xff);
+
+  config = gst_structure_new ("GstVideoConverter",
+      GST_VIDEO_CONVERTER_OPT_ALPHA_MODE, GST_TYPE_VIDEO_ALPHA_MODE,
+      GST_VIDEO_ALPHA_MODE_SET, GST_VIDEO_CONVERTER_OPT_ALPHA_VALUE,
+      G_TYPE_DOUBLE, 0.0, GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, 2,
+      NULL);
+  g_object_set (pad, "converter-config", config, NULL);
+  gst_structure_free (config);
+
+  check_white_output (h, pad, 1, 0x00);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+videoaggregator_suite (void)
+{
+  Suite *s = suite_create ("videoaggregator");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_prepare_frame_converted);
+  tcase_add_test (tc_chain, test_convert_concurrently);
+  tcase_add_test (tc_chain, test_converter_config_update);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videoaggregator);
@@ -56,6 +56,17 @@ pipe2 (int pipedes[2], int flags)
 }
 #endif
 
+/* file descriptors can only be passed over Unix sockets */
+static int
+socketpair_nonblock (int fds[2])
+{
+  if (socketpair (PF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    return -1;
+  if (fcntl (fds[0], F_SETFL, O_NONBLOCK) < 0)
+    return -1;
+  return fcntl (fds[1], F_SETFL, O_NONBLOCK);
+}
+
 /* This enum contains flags that are used to configure the setup that
  * test_base() will do internally */
 typedef enum
@@ -71,6 +82,8 @@ typedef enum
   TEST_FEATURE_ERROR_SINK = 0x80,       /* generates error message in the slave */
   TEST_FEATURE_LONG_DURATION = 0x100,   /* bigger num-buffers in {audio,video}testsrc */
   TEST_FEATURE_FILTER_SINK_CAPS = 0x200,        /* plugs capsfilter before fakesink */
+  TEST_FEATURE_FD_PASSING = 0x2000,     /* sends buffer data as memfds over sockets */
+  TEST_FEATURE_BUFFERS_IN_FLIGHT = 0x4000,      /* sets max-buffers-in-flight=4 */
 
   /* Source selection; Use only one of those, do not combine! */
   TEST_FEATURE_TEST_SOURCE = 0x400,
@@ -542,6 +555,18 @@ create_test_source (gboolean live, int fdina, int fdouta, int fdinv, int fdoutv,
   return pipeline;
 }
 
+static void
+setup_ipcpipelinesink (const GValue * v, gpointer user_data)
+{
+  GstElement *sink = g_value_get_object (v);
+  TestFeatures features = GPOINTER_TO_UINT (user_data);
+
+  if (features & TEST_FEATURE_FD_PASSING)
+    g_object_set (sink, "fd-passing", TRUE, NULL);
+  if (features & TEST_FEATURE_BUFFERS_IN_FLIGHT)
+    g_object_set (sink, "max-buffers-in-flight", 4, NULL);
+}
+
 static GstElement *
 create_source (TestFeatures features, int fdina, int fdouta, int fdinv,
     int fdoutv, test_data * td)
@@ -568,8 +593,17 @@ create_source (TestFeatures features, int fdina, int fdouta, int fdinv,
   td->two_streams = has_video;
   td->p = pipeline;
 
-  if (pipeline)
+  if (pipeline) {
+    GstIterator *it;
+
+    it = gst_bin_iterate_sinks (GST_BIN (pipeline));
+    while (gst_iterator_foreach (it, setup_ipcpipelinesink,
+            GUINT_TO_POINTER (features)))
+      gst_iterator_resync (it);
+    gst_iterator_free (it);
+
     gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, td);
+  }
 
   return pipeline;
 }
@@ -791,9 +825,14 @@ test_base (const char *name, TestFeatures features,
 
   weak_refs = NULL;
 
-  FAIL_IF (pipe2 (pipesfa, O_NONBLOCK) < 0);
+  if (features & TEST_FEATURE_FD_PASSING) {
+    FAIL_IF (socketpair_nonblock (pipesfa) < 0);
+    FAIL_IF (socketpair_nonblock (pipesfv) < 0);
+  } else {
+    FAIL_IF (pipe2 (pipesfa, O_NONBLOCK) < 0);
+    FAIL_IF (pipe2 (pipesfv, O_NONBLOCK) < 0);
+  }
   FAIL_IF (pipe2 (pipesba, O_NONBLOCK) < 0);
-  FAIL_IF (pipe2 (pipesfv, O_NONBLOCK) < 0);
   FAIL_IF (pipe2 (pipesbv, O_NONBLOCK) < 0);
   FAIL_IF (socketpair (PF_UNIX, SOCK_STREAM, 0, ctlsock) < 0);
 
@@ -2348,6 +2387,7 @@ typedef struct
 {
   gboolean got_buffer[2];
   gboolean got_eos[2];
+  gboolean got_non_fd_buffer[2];
 } end_of_stream_slave_data;
 
 static void
@@ -2379,7 +2419,14 @@ end_of_stream_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
   end_of_stream_slave_data *d = td->sd;
 
   if (GST_IS_BUFFER (info->data)) {
+    GstBuffer *buffer = info->data;
+
     d->got_buffer[pad2idx (pad, td->two_streams)] = TRUE;
+    /* the data of passed buffers is wrapped in a GstFdMemory */
+    if (gst_buffer_get_size (buffer) > 0 &&
+        (gst_buffer_n_memory (buffer) != 1 ||
+            !gst_memory_is_type (gst_buffer_peek_memory (buffer, 0), "fd")))
+      d->got_non_fd_buffer[pad2idx (pad, td->two_streams)] = TRUE;
   } else if (GST_IS_EVENT (info->data)) {
     if (GST_EVENT_TYPE (info->data) == GST_EVENT_EOS) {
       d->got_eos[pad2idx (pad, td->two_streams)] = TRUE;
@@ -2425,6 +2472,8 @@ check_success_sink_end_of_stream (gpointer user_data)
   for (idx = 0; idx < (td->two_streams ? 2 : 1); idx++) {
     FAIL_UNLESS (d->got_buffer[idx]);
     FAIL_UNLESS (d->got_eos[idx]);
+    if (td->features & TEST_FEATURE_FD_PASSING)
+      FAIL_IF (d->got_non_fd_buffer[idx]);
   }
 }
 
@@ -2527,6 +2576,48 @@ GST_START_TEST (test_live_av_2_end_of_stream)
 
 GST_END_TEST;
 
+GST_START_TEST (test_wavparse_fd_passing_end_of_stream)
+{
+  end_of_stream_master_data md = { 0 };
+  end_of_stream_slave_data sd = { {0}
+  };
+
+  TEST_BASE (TEST_FEATURE_WAV_SOURCE | TEST_FEATURE_FD_PASSING,
+      end_of_stream_source, setup_sink_end_of_stream,
+      check_success_source_end_of_stream, check_success_sink_end_of_stream,
+      NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_live_av_fd_passing_end_of_stream)
+{
+  end_of_stream_master_data md = { 0 };
+  end_of_stream_slave_data sd = { {0}
+  };
+
+  TEST_BASE (TEST_FEATURE_LIVE_AV_SOURCE | TEST_FEATURE_FD_PASSING,
+      end_of_stream_source, setup_sink_end_of_stream,
+      check_success_source_end_of_stream, check_success_sink_end_of_stream,
+      NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_wavparse_buffers_in_flight_end_of_stream)
+{
+  end_of_stream_master_data md = { 0 };
+  end_of_stream_slave_data sd = { {0}
+  };
+
+  TEST_BASE (TEST_FEATURE_WAV_SOURCE | TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      end_of_stream_source, setup_sink_end_of_stream,
+      check_success_source_end_of_stream, check_success_sink_end_of_stream,
+      NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
 /**** reverse playback test ****/
 
 typedef struct
@@ -5636,6 +5727,34 @@ GST_START_TEST (test_live_av_2_error_from_slave)
 
 GST_END_TEST;
 
+/* the failure is reported on a later buffer, and must not be reported again
+ * once the pipeline was restarted */
+GST_START_TEST (test_wavparse_buffers_in_flight_error_from_slave)
+{
+  error_from_slave_input_data id = { FALSE };
+  error_from_slave_master_data md = { 0 };
+
+  TEST_BASE (TEST_FEATURE_WAV_SOURCE | TEST_FEATURE_ERROR_SINK |
+      TEST_FEATURE_BUFFERS_IN_FLIGHT,
+      error_from_slave_source, setup_sink_error_from_slave,
+      check_success_source_error_from_slave, NULL, &id, &md, NULL);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_live_a_buffers_in_flight_error_from_slave)
+{
+  error_from_slave_input_data id = { FALSE };
+  error_from_slave_master_data md = { 0 };
+
+  TEST_BASE (TEST_FEATURE_LIVE_A_SOURCE | TEST_FEATURE_ERROR_SINK |
+      TEST_FEATURE_BUFFERS_IN_FLIGHT | TEST_FEATURE_FD_PASSING,
+      error_from_slave_source, setup_sink_error_from_slave,
+      check_success_source_error_from_slave, NULL, &id, &md, NULL);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_wavparse_slave_process_crash)
 {
   error_from_slave_input_data id = { TRUE };
@@ -5914,6 +6033,9 @@ ipcpipeline_suite (void)
     tcase_add_test (tc_chain, test_live_a_end_of_stream);
     tcase_add_test (tc_chain, test_live_av_end_of_stream);
     tcase_add_test (tc_chain, test_live_av_2_end_of_stream);
+    tcase_add_test (tc_chain, test_wavparse_fd_passing_end_of_stream);
+    tcase_add_test (tc_chain, test_live_av_fd_passing_end_of_stream);
+    tcase_add_test (tc_chain, test_wavparse_buffers_in_flight_end_of_stream);
   }
 
   /* reverse_playback tests issue a seek with negative rate,
@@ -6046,6 +6168,8 @@ ipcpipeline_suite (void)
     tcase_add_test (tc_chain, test_live_a_error_from_slave);
     tcase_add_test (tc_chain, test_live_av_error_from_slave);
     tcase_add_test (tc_chain, test_live_av_2_error_from_slave);
+    tcase_add_test (tc_chain, test_wavparse_buffers_in_flight_error_from_slave);
+    tcase_add_test (tc_chain, test_live_a_buffers_in_flight_error_from_slave);
   }
 
   /* slave_process_crash tests test that a crash of the slave
@@ -0,0 +1,136 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * Measures the compositor blending throughput for multiview layouts of
+ * 4, 9 and 16 inputs at 1080p and 4K, single threaded and with the
+ * given number of blending threads (default: one per CPU core).
+ *
+ * Usage: blend-benchmark [max-threads] [n-frames]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+static gdouble
+run_benchmark (guint width, guint height, guint n_inputs, guint max_threads,
+    guint n_frames)
+{
+  GString *desc;
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  GTimer *timer;
+  guint columns, i;
+  gdouble elapsed;
+
+  /* square grid of inputs each scaled to its cell */
+  for (columns = 1; columns * columns < n_inputs; columns++);
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "compositor name=comp max-threads=%u "
+      "background=black ! video/x-raw,format=I420,width=%u,height=%u ! "
+      "fakesink sync=false ", max_threads, width, height);
+
+  for (i = 0; i < n_inputs; i++) {
+    g_string_append_printf (desc, "videotestsrc num-buffers=%u pattern=ball "
+        "! video/x-raw,format=I420,width=%u,height=%u ! "
+        "comp.sink_%u ", n_frames, width / columns, height / columns, i);
+  }
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (!pipeline) {
+    g_printerr ("Could not create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  for (i = 0; i < n_inputs; i++) {
+    GstElement *comp = gst_bin_get_by_name (GST_BIN (pipeline), "comp");
+    gchar *name = g_strdup_printf ("sink_%u", i);
+    GstPad *pad = gst_element_get_static_pad (comp, name);
+
+    g_object_set (pad, "xpos", (i % columns) * (width / columns),
+        "ypos", (i / columns) * (height / columns), NULL);
+
+    gst_object_unref (pad);
+    gst_object_unref (comp);
+    g_free (name);
+  }
+
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+    elapsed = -1;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  g_timer_destroy (timer);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const guint sizes[][2] = { {1920, 1080}, {3840, 2160} };
+  static const guint inputs[] = { 4, 9, 16 };
+  guint max_threads = 0, n_frames = 300;
+  guint s, i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    max_threads = atoi (argv[1]);
+  if (argc > 2)
+    n_frames = atoi (argv[2]);
+
+  for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+    for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+      gdouble single, threaded;
+
+      single = run_benchmark (sizes[s][0], sizes[s][1], inputs[i], 1,
+          n_frames);
+      threaded = run_benchmark (sizes[s][0], sizes[s][1], inputs[i],
+          max_threads, n_frames);
+      if (single < 0 || threaded < 0)
+        return 1;
+
+      g_print ("%ux%u, %2u inputs: %7.1f fps single threaded, "
+          "%7.1f fps with max-threads=%u\n", sizes[s][0], sizes[s][1],
+          inputs[i], n_frames / single, n_frames / threaded, max_threads);
+    }
+  }
+
+  return 0;
+}
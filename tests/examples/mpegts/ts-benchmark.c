@@ -0,0 +1,146 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * Measures how many transport stream packets per second tsparse and
+ * tsdemux go through for the given file, with all programs and streams
+ * being parsed/demuxed into fakesinks.
+ *
+ * Usage: ts-benchmark <file.ts> [n-runs]
+ */
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+static void
+on_pad_added (GstElement * demux, GstPad * pad, GstBin * pipeline)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add (pipeline, sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static gdouble
+run_benchmark (const gchar * location, const gchar * element)
+{
+  gchar *desc;
+  GstElement *pipeline, *elem;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  GTimer *timer;
+  gdouble elapsed;
+
+  desc = g_strdup_printf ("filesrc location=\"%s\" blocksize=65536 ! "
+      "%s name=elem", location, element);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Could not create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  /* tsparse has an always src pad, tsdemux adds one per stream */
+  elem = gst_bin_get_by_name (GST_BIN (pipeline), "elem");
+  if (g_str_equal (element, "tsparse")) {
+    GstPad *srcpad = gst_element_get_static_pad (elem, "src");
+
+    on_pad_added (elem, srcpad, GST_BIN (pipeline));
+    gst_object_unref (srcpad);
+  } else {
+    g_signal_connect (elem, "pad-added", G_CALLBACK (on_pad_added),
+        pipeline);
+  }
+  gst_object_unref (elem);
+
+  timer = g_timer_new ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+    elapsed = -1;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  g_timer_destroy (timer);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const gchar *elements[] = { "tsparse", "tsdemux" };
+  GStatBuf st;
+  guint64 n_packets;
+  guint n_runs = 5, e, i;
+
+  gst_init (&argc, &argv);
+
+  if (argc < 2) {
+    g_printerr ("Usage: %s <file.ts> [n-runs]\n", argv[0]);
+    return 1;
+  }
+  if (argc > 2)
+    n_runs = atoi (argv[2]);
+
+  if (g_stat (argv[1], &st) != 0) {
+    g_printerr ("Could not stat %s\n", argv[1]);
+    return 1;
+  }
+  n_packets = st.st_size / 188;
+
+  for (e = 0; e < G_N_ELEMENTS (elements); e++) {
+    gdouble best = -1;
+
+    for (i = 0; i < n_runs; i++) {
+      gdouble elapsed = run_benchmark (argv[1], elements[e]);
+
+      if (elapsed < 0)
+        return 1;
+      if (best < 0 || elapsed < best)
+        best = elapsed;
+    }
+
+    g_print ("%s: %" G_GUINT64_FORMAT " packets, %10.0f packets/s "
+        "(%.1f Mbit/s)\n", elements[e], n_packets, n_packets / best,
+        st.st_size * 8 / best / 1000000);
+  }
+
+  return 0;
+}